@@ -0,0 +1,407 @@
+/*
+ * binderlat: worst-case binder call latency of a real-time caller against
+ * a loaded service.
+ *
+ * A service process becomes the binder context manager, runs a few looper
+ * threads and as many busy threads at normal priority as asked for.  A
+ * client process then makes synchronous calls to it from a thread of the
+ * chosen policy, sleeping between calls so that the looper threads go back
+ * to waiting.  Every round trip is timed, and every reply says which
+ * policy and priority the looper thread had while serving the call, so
+ * that priority inheritance can be checked as well as measured.
+ *
+ * Being the context manager, it cannot run beside servicemanager: stop
+ * the Android framework first, or run it on a bare system.
+ *
+ * Compile with the Android toolchain, which has <linux/binder.h>:
+ *
+ * arm-eabi-gcc -O2 -o binderlat binderlat.c -lpthread (or the NDK)
+ *
+ * Usage:
+ *
+ * binderlat [-p fifo|rr|iso|normal] [-r rtprio] [-n calls] [-i usecs]
+ *           [-w usecs] [-t threads] [-l busy threads]
+ *
+ * The defaults are 1000 SCHED_FIFO calls at priority 50, 1ms apart, each
+ * keeping the service busy for 100us, 2 looper threads and 4 busy threads.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <linux/binder.h>
+
+#ifndef SCHED_ISO
+#define SCHED_ISO	4
+#endif
+
+#define MAP_SIZE	(128 * 1024)
+#define CALL_CODE	1
+
+/* What the looper thread reports back */
+struct reply {
+	uint32_t policy;
+	int32_t prio;
+};
+
+static int policy = SCHED_FIFO;
+static int rtprio = 50;
+static int nr_calls = 1000;
+static int interval = 1000;
+static int work = 100;
+static int nr_loopers = 2;
+static int nr_busy = 4;
+
+static void fatal(const char *x)
+{
+	perror(x);
+	exit(1);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static const char *policy_name(int p)
+{
+	switch (p) {
+	case SCHED_OTHER:
+		return "normal";
+	case SCHED_FIFO:
+		return "fifo";
+	case SCHED_RR:
+		return "rr";
+	case SCHED_ISO:
+		return "iso";
+	}
+	return "other";
+}
+
+static int binder_open(void)
+{
+	int fd = open("/dev/binder", O_RDWR);
+
+	if (fd < 0)
+		fatal("/dev/binder");
+	if (mmap(NULL, MAP_SIZE, PROT_READ, MAP_PRIVATE, fd, 0) == MAP_FAILED)
+		fatal("mmap");
+	return fd;
+}
+
+static int binder_io(int fd, void *wbuf, size_t wsize, void *rbuf,
+		     size_t rsize)
+{
+	struct binder_write_read bwr;
+
+	bwr.write_buffer = (unsigned long)wbuf;
+	bwr.write_size = wsize;
+	bwr.write_consumed = 0;
+	bwr.read_buffer = (unsigned long)rbuf;
+	bwr.read_size = rsize;
+	bwr.read_consumed = 0;
+	while (ioctl(fd, BINDER_WRITE_READ, &bwr) < 0)
+		if (errno != EINTR)
+			fatal("BINDER_WRITE_READ");
+	return bwr.read_consumed;
+}
+
+/* Append a command and its argument to a write buffer */
+static size_t put(char *buf, size_t pos, uint32_t cmd, const void *arg,
+		  size_t len)
+{
+	memcpy(buf + pos, &cmd, sizeof(cmd));
+	memcpy(buf + pos + sizeof(cmd), arg, len);
+	return pos + sizeof(cmd) + len;
+}
+
+/*
+ * The service: answer every call with the policy and priority the serving
+ * thread had, after spinning for 'work' microseconds.
+ */
+static void *looper(void *arg)
+{
+	int fd = (long)arg;
+	char rbuf[256], wbuf[128];
+	size_t wpos = 0;
+	uint32_t cmd = BC_ENTER_LOOPER;
+
+	binder_io(fd, &cmd, sizeof(cmd), NULL, 0);
+	for (;;) {
+		int len = binder_io(fd, wbuf, wpos, rbuf, sizeof(rbuf));
+		char *p = rbuf;
+
+		wpos = 0;
+		while (p < rbuf + len) {
+			struct binder_transaction_data tr;
+			struct binder_ptr_cookie pc;
+			struct sched_param param;
+			struct reply reply;
+			uint64_t end;
+
+			memcpy(&cmd, p, sizeof(cmd));
+			p += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+			case BR_TRANSACTION_COMPLETE:
+			case BR_SPAWN_LOOPER:
+				break;
+			case BR_INCREFS:
+			case BR_ACQUIRE:
+				memcpy(&pc, p, sizeof(pc));
+				p += sizeof(pc);
+				wpos = put(wbuf, wpos, cmd == BR_INCREFS ?
+					   BC_INCREFS_DONE : BC_ACQUIRE_DONE,
+					   &pc, sizeof(pc));
+				break;
+			case BR_RELEASE:
+			case BR_DECREFS:
+				p += sizeof(pc);
+				break;
+			case BR_TRANSACTION:
+				memcpy(&tr, p, sizeof(tr));
+				p += sizeof(tr);
+
+				reply.policy = sched_getscheduler(0);
+				sched_getparam(0, &param);
+				reply.prio = param.sched_priority ?:
+					getpriority(PRIO_PROCESS, 0);
+				end = now_ns() + work * 1000ULL;
+				while (now_ns() < end)
+					;
+
+				wpos = put(wbuf, wpos, BC_FREE_BUFFER,
+					   &tr.data.ptr.buffer,
+					   sizeof(tr.data.ptr.buffer));
+				memset(&tr, 0, sizeof(tr));
+				tr.data_size = sizeof(reply);
+				tr.data.ptr.buffer = &reply;
+				wpos = put(wbuf, wpos, BC_REPLY, &tr, sizeof(tr));
+				/* send the reply while 'reply' is in scope */
+				binder_io(fd, wbuf, wpos, NULL, 0);
+				wpos = 0;
+				break;
+			default:
+				fprintf(stderr, "service: unexpected %08x\n",
+					cmd);
+				exit(1);
+			}
+		}
+	}
+	return NULL;
+}
+
+static void *busy(void *arg)
+{
+	for (;;)
+		;
+	return NULL;
+}
+
+static void service(int ready)
+{
+	pthread_t thread;
+	int fd = binder_open();
+	int i;
+
+	if (ioctl(fd, BINDER_SET_CONTEXT_MGR, 0) < 0)
+		fatal("BINDER_SET_CONTEXT_MGR (is servicemanager running?)");
+	for (i = 0; i < nr_busy; i++)
+		if (pthread_create(&thread, NULL, busy, NULL))
+			fatal("pthread_create");
+	for (i = 0; i < nr_loopers; i++)
+		if (pthread_create(&thread, NULL, looper, (void *)(long)fd))
+			fatal("pthread_create");
+	if (write(ready, "", 1) != 1)
+		fatal("write");
+	for (;;)
+		pause();
+}
+
+/* One synchronous call to the context manager */
+static void call(int fd, struct reply *reply)
+{
+	struct binder_transaction_data tr;
+	char rbuf[256], wbuf[128];
+	uint32_t cmd, seq = 0;
+	int done = 0;
+
+	memset(&tr, 0, sizeof(tr));
+	tr.target.handle = 0;
+	tr.code = CALL_CODE;
+	tr.data_size = sizeof(seq);
+	tr.data.ptr.buffer = &seq;
+	cmd = BC_TRANSACTION;
+	memcpy(wbuf, &cmd, sizeof(cmd));
+	memcpy(wbuf + sizeof(cmd), &tr, sizeof(tr));
+	binder_io(fd, wbuf, sizeof(cmd) + sizeof(tr), NULL, 0);
+
+	while (!done) {
+		int len = binder_io(fd, NULL, 0, rbuf, sizeof(rbuf));
+		char *p = rbuf;
+
+		while (p < rbuf + len) {
+			memcpy(&cmd, p, sizeof(cmd));
+			p += sizeof(cmd);
+			switch (cmd) {
+			case BR_NOOP:
+			case BR_TRANSACTION_COMPLETE:
+				break;
+			case BR_REPLY:
+				memcpy(&tr, p, sizeof(tr));
+				p += sizeof(tr);
+				memcpy(reply, tr.data.ptr.buffer, sizeof(*reply));
+				put(wbuf, 0, BC_FREE_BUFFER, &tr.data.ptr.buffer,
+				    sizeof(tr.data.ptr.buffer));
+				binder_io(fd, wbuf, sizeof(cmd) +
+					  sizeof(tr.data.ptr.buffer), NULL, 0);
+				done = 1;
+				break;
+			default:
+				fprintf(stderr, "client: call failed (%08x)\n",
+					cmd);
+				exit(1);
+			}
+		}
+	}
+}
+
+static int cmp(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void client(void)
+{
+	struct sched_param param = { .sched_priority = 0 };
+	struct timespec gap = { interval / 1000000,
+				(interval % 1000000) * 1000 };
+	uint64_t *lat, total = 0, start;
+	struct reply reply;
+	int fd = binder_open();
+	int i, inherited = 0;
+
+	if (policy == SCHED_FIFO || policy == SCHED_RR)
+		param.sched_priority = rtprio;
+	if (sched_setscheduler(0, policy, &param))
+		fatal("sched_setscheduler");
+
+	lat = malloc(nr_calls * sizeof(*lat));
+	if (!lat)
+		fatal("malloc");
+	for (i = 0; i < nr_calls; i++) {
+		nanosleep(&gap, NULL);
+		start = now_ns();
+		call(fd, &reply);
+		lat[i] = now_ns() - start;
+		total += lat[i];
+		if ((int)reply.policy == policy)
+			inherited++;
+		else if (!i)
+			printf("first call served as %s %d\n",
+			       policy_name(reply.policy), reply.prio);
+	}
+
+	qsort(lat, nr_calls, sizeof(*lat), cmp);
+	printf("%d calls as %s, %d us of work, %d busy threads\n", nr_calls,
+	       policy_name(policy), work, nr_busy);
+	printf("served as %s: %d of %d\n", policy_name(policy), inherited,
+	       nr_calls);
+	printf("latency us: min %llu avg %llu 99%% %llu max %llu\n",
+	       (unsigned long long)lat[0] / 1000,
+	       (unsigned long long)total / nr_calls / 1000,
+	       (unsigned long long)lat[nr_calls * 99 / 100] / 1000,
+	       (unsigned long long)lat[nr_calls - 1] / 1000);
+}
+
+static void usage(void)
+{
+	printf("binderlat [-p fifo|rr|iso|normal] [-r rtprio] [-n calls] "
+	       "[-i usecs] [-w usecs] [-t threads] [-l busy threads]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int pipefd[2];
+	pid_t pid;
+	char c;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "p:r:n:i:w:t:l:")) != -1) {
+		switch (opt) {
+		case 'p':
+			if (!strcmp(optarg, "fifo"))
+				policy = SCHED_FIFO;
+			else if (!strcmp(optarg, "rr"))
+				policy = SCHED_RR;
+			else if (!strcmp(optarg, "iso"))
+				policy = SCHED_ISO;
+			else if (!strcmp(optarg, "normal"))
+				policy = SCHED_OTHER;
+			else
+				usage();
+			break;
+		case 'r':
+			rtprio = atoi(optarg);
+			break;
+		case 'n':
+			nr_calls = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'w':
+			work = atoi(optarg);
+			break;
+		case 't':
+			nr_loopers = atoi(optarg);
+			break;
+		case 'l':
+			nr_busy = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (nr_calls < 1 || nr_loopers < 1 || interval < 0 || work < 0)
+		usage();
+
+	if (pipe(pipefd))
+		fatal("pipe");
+	pid = fork();
+	if (pid < 0)
+		fatal("fork");
+	if (!pid) {
+		close(pipefd[0]);
+		service(pipefd[1]);
+	}
+	close(pipefd[1]);
+	if (read(pipefd[0], &c, 1) != 1) {
+		waitpid(pid, NULL, 0);
+		return 1;
+	}
+
+	client();
+
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	return 0;
+}
@@ -0,0 +1,314 @@
+/*
+ * iosched-bench: foreground read latency against background writes, under
+ * each of several i/o schedulers in turn.
+ *
+ * Readers do random O_DIRECT reads over the first half of the device and
+ * time each one; writers do sequential O_DIRECT writes over the second
+ * half, at the i/o priority class given with -c (idle by default, the way
+ * a media scanner or a download would run).  Direct i/o is used so every
+ * request is issued by, and accounted to, the task that asked for it;
+ * buffered writes would reach the disk from pdflush instead.
+ *
+ * THE DEVICE'S CONTENTS ARE OVERWRITTEN.
+ *
+ * The device must go through an i/o scheduler: brd and loop hand bios
+ * straight to their driver and never reach one.  Use scsi_debug instead
+ * (a RAM disk behind the SCSI layer; delay=N makes each command take N
+ * jiffies, to look more like flash), or a real mmcblk device:
+ *
+ *	modprobe scsi_debug dev_size_mb=256 delay=0
+ *	iosched-bench /dev/sdb
+ *
+ * blktrace can run alongside to see the requests themselves: the start
+ * of each run is printed on stderr, with a second of quiet before it, so
+ * the blkparse output splits into runs easily, and btt gives queue (Q2D)
+ * and service (D2C) times per run.
+ *
+ * Compile by:
+ *
+ * gcc -O2 -o iosched-bench iosched-bench.c (and arm-eabi-gcc for the device)
+ *
+ * Usage:
+ *
+ * iosched-bench [-s sched,sched...] [-t seconds] [-r readers]
+ *	[-w writers] [-b read block] [-B write block] [-c class] device
+ *
+ * The defaults are flash, anticipatory, deadline and noop, 10 seconds,
+ * one reader of 4KB blocks and one writer of 64KB blocks.
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/fs.h>
+
+#define IOPRIO_CLASS_SHIFT	13
+#define IOPRIO_WHO_PROCESS	1
+#define MAX_SAMPLES		(1 << 18)
+#define MAX_TASKS		16
+
+struct result {
+	unsigned long long bytes;
+	unsigned long samples;
+	unsigned int lat_us[MAX_SAMPLES];
+};
+
+static const char *class_names[] = { "none", "rt", "be", "idle" };
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int set_scheduler(const char *dev, const char *sched)
+{
+	const char *name = strrchr(dev, '/');
+	char path[256];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), "/sys/block/%s/queue/scheduler",
+		 name ? name + 1 : dev);
+	fd = open(path, O_WRONLY);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	ret = write(fd, sched, strlen(sched));
+	close(fd);
+	return ret < 0 ? -1 : 0;
+}
+
+static int set_ioprio(int class, int data)
+{
+	return syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+		       class << IOPRIO_CLASS_SHIFT | data);
+}
+
+static void *aligned_buf(size_t size)
+{
+	void *buf;
+
+	if (posix_memalign(&buf, 4096, size))
+		return NULL;
+	memset(buf, 0x5a, size);
+	return buf;
+}
+
+static void reader(const char *dev, unsigned long long half, size_t block,
+		   double end, struct result *res, unsigned int seed)
+{
+	unsigned long long blocks = half / block, off;
+	void *buf = aligned_buf(block);
+	double start;
+	int fd;
+
+	fd = open(dev, O_RDONLY | O_DIRECT);
+	if (fd < 0 || !buf || !blocks) {
+		perror(dev);
+		exit(1);
+	}
+	set_ioprio(2, 4);
+	srandom(seed);
+	while (now() < end) {
+		off = ((unsigned long long)random() << 31 | random()) % blocks;
+		start = now();
+		if (pread(fd, buf, block, off * block) != (ssize_t)block) {
+			perror("read");
+			exit(1);
+		}
+		if (res->samples < MAX_SAMPLES)
+			res->lat_us[res->samples++] = (now() - start) * 1e6;
+		res->bytes += block;
+	}
+	exit(0);
+}
+
+static void writer(const char *dev, unsigned long long half, size_t block,
+		   double end, struct result *res, int class, int index)
+{
+	unsigned long long blocks = half / block, n;
+	void *buf = aligned_buf(block);
+	int fd;
+
+	fd = open(dev, O_WRONLY | O_DIRECT);
+	if (fd < 0 || !buf || !blocks) {
+		perror(dev);
+		exit(1);
+	}
+	if (set_ioprio(class, class == 3 ? 0 : 4))
+		perror("ioprio_set");
+	/* writers start spread over the second half */
+	for (n = blocks * index / MAX_TASKS; now() < end; n = (n + 1) % blocks) {
+		if (pwrite(fd, buf, block, half + n * block) !=
+		    (ssize_t)block) {
+			perror("write");
+			exit(1);
+		}
+		res->bytes += block;
+	}
+	exit(0);
+}
+
+static int cmp_uint(const void *a, const void *b)
+{
+	unsigned int x = *(const unsigned int *)a, y = *(const unsigned int *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void report(const char *sched, struct result *res, int readers,
+		   int writers, double secs)
+{
+	unsigned long long rbytes = 0, wbytes = 0;
+	unsigned long n = 0, i;
+	unsigned int *all;
+	double sum = 0;
+	int t;
+
+	for (t = 0; t < readers; t++) {
+		rbytes += res[t].bytes;
+		n += res[t].samples;
+	}
+	for (t = readers; t < readers + writers; t++)
+		wbytes += res[t].bytes;
+
+	all = malloc((n ? n : 1) * sizeof(*all));
+	for (t = 0, i = 0; t < readers; t++) {
+		memcpy(all + i, res[t].lat_us,
+		       res[t].samples * sizeof(*all));
+		i += res[t].samples;
+	}
+	qsort(all, n, sizeof(*all), cmp_uint);
+	for (i = 0; i < n; i++)
+		sum += all[i];
+
+	if (n)
+		printf("%-13s %8.0f %8.2f %8.2f %8.2f %8.2f %8.2f %8.1f %8.1f\n",
+		       sched, n / secs, sum / n / 1000, all[n / 2] / 1000.0,
+		       all[n * 95 / 100] / 1000.0, all[n * 99 / 100] / 1000.0,
+		       all[n - 1] / 1000.0, rbytes / secs / (1 << 20),
+		       wbytes / secs / (1 << 20));
+	else
+		printf("%-13s %8s %8s %8s %8s %8s %8s %8s %8.1f\n", sched,
+		       "-", "-", "-", "-", "-", "-", "-",
+		       wbytes / secs / (1 << 20));
+	free(all);
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"iosched-bench [-s sched,sched...] [-t seconds] [-r readers]\n"
+		"\t[-w writers] [-b read block] [-B write block] [-c class] "
+		"device\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	char *scheds = strdup("flash,anticipatory,deadline,noop"), *sched;
+	size_t rblock = 4096, wblock = 65536;
+	int readers = 1, writers = 1, class = 3, secs = 10;
+	unsigned long long size;
+	struct result *res;
+	const char *dev;
+	double end;
+	int c, fd, t, status;
+
+	while ((c = getopt(argc, argv, "s:t:r:w:b:B:c:")) != -1) {
+		switch (c) {
+		case 's':
+			scheds = optarg;
+			break;
+		case 't':
+			secs = atoi(optarg);
+			break;
+		case 'r':
+			readers = atoi(optarg);
+			break;
+		case 'w':
+			writers = atoi(optarg);
+			break;
+		case 'b':
+			rblock = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			wblock = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			for (class = 1; class < 4; class++)
+				if (!strcmp(optarg, class_names[class]))
+					break;
+			if (class == 4)
+				usage();
+			break;
+		default:
+			usage();
+		}
+	}
+	if (optind != argc - 1 || secs <= 0 || readers < 0 || writers < 0 ||
+	    readers + writers < 1 || readers + writers > MAX_TASKS ||
+	    rblock % 512 || wblock % 512 || !rblock || !wblock)
+		usage();
+	dev = argv[optind];
+
+	fd = open(dev, O_RDONLY);
+	if (fd < 0 || ioctl(fd, BLKGETSIZE64, &size) < 0) {
+		perror(dev);
+		return 1;
+	}
+	close(fd);
+
+	res = mmap(NULL, MAX_TASKS * sizeof(*res), PROT_READ | PROT_WRITE,
+		   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (res == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	printf("%d reader(s) of %zu bytes, %d %s writer(s) of %zu bytes, "
+	       "%d s each\n", readers, rblock, writers, class_names[class],
+	       wblock, secs);
+	printf("%-13s %8s %8s %8s %8s %8s %8s %8s %8s\n", "scheduler",
+	       "reads/s", "avg ms", "p50 ms", "p95 ms", "p99 ms", "max ms",
+	       "rd MB/s", "wr MB/s");
+
+	for (sched = strtok(scheds, ","); sched; sched = strtok(NULL, ",")) {
+		if (set_scheduler(dev, sched)) {
+			fprintf(stderr, "%s: can't select %s\n", dev, sched);
+			continue;
+		}
+		memset(res, 0, MAX_TASKS * sizeof(*res));
+		sync();
+		sleep(1);
+
+		fprintf(stderr, "%s: starting\n", sched);
+		end = now() + secs;
+		for (t = 0; t < readers + writers; t++) {
+			if (fork())
+				continue;
+			if (t < readers)
+				reader(dev, size / 2, rblock, end, &res[t], t);
+			else
+				writer(dev, size / 2, wblock, end, &res[t],
+				       class, t - readers);
+		}
+		while (wait(&status) > 0)
+			if (!WIFEXITED(status) || WEXITSTATUS(status))
+				return 1;
+
+		report(sched, res, readers, writers, secs);
+	}
+	return 0;
+}
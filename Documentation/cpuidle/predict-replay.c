@@ -0,0 +1,321 @@
+/*
+ * predict-replay: replay a recorded idle trace through the predict idle
+ * governor (drivers/cpuidle/governors/predict.c) and through the plain
+ * next-timer choice that arch_idle() makes on MSM, and compare how often
+ * each picks the wrong idle state.
+ *
+ * A choice is too deep when the cpu woke up before the state's target
+ * residency, so entering it cost more than it saved, and too shallow when
+ * the cpu stayed idle long enough for the next deeper state.  These are
+ * the same "mispredict" counts /proc/msm_pm_stats shows.
+ *
+ * To record a trace on MSM, set bit 7 (MSM_PM_DEBUG_IDLE_TRACE) of
+ * /sys/module/pm/parameters/debug_mask and save the kernel log; each idle
+ * period logs a line like
+ *
+ *	msm_pm_idle: state 2 timer 3906250 idle 1220703
+ *
+ * with the time to the next timer and the time actually spent idle, in
+ * nanoseconds.  Lines of just two numbers, timer and idle in nanoseconds,
+ * are read as well; anything else is skipped.
+ *
+ * Compile by:
+ *
+ * gcc -O2 -o predict-replay predict-replay.c
+ *
+ * Usage:
+ *
+ * predict-replay [-l latency us] [-s name:latency:residency ...] [trace]
+ *
+ * The default states are the ones pm.c registers, with the latencies
+ * board-init.c gives them; -s replaces them, shallowest first.  The trace
+ * is read from standard input if no file is given.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <getopt.h>
+
+#define MAX_STATES	8
+
+struct state {
+	char name[16];
+	unsigned int exit_latency;	/* us */
+	unsigned int target_residency;	/* us */
+};
+
+static struct state states[MAX_STATES] = {
+	{ "spin", 0, 0 },
+	{ "wfi", 0, 80 },
+	{ "ramp-down", 2000, 4000 },
+	{ "sleep", 0, 20000 },
+	{ "pc", 16000, 32000 },
+};
+static int nr_states = 5;
+static unsigned int latency_req = UINT_MAX;
+
+struct policy {
+	const char *name;
+	int (*select)(unsigned int next_timer_us);
+	void (*reflect)(unsigned int measured_us);
+	unsigned long entries[MAX_STATES];
+	unsigned long too_deep[MAX_STATES];
+	unsigned long too_shallow[MAX_STATES];
+	double idle_us[MAX_STATES];
+};
+
+/* The timer alone: the deepest state that fits before it expires */
+static int timer_select(unsigned int next_timer_us)
+{
+	int i;
+
+	for (i = 1; i < nr_states; i++) {
+		if (states[i].target_residency > next_timer_us)
+			break;
+		if (states[i].exit_latency > latency_req)
+			break;
+	}
+	return i - 1;
+}
+
+static void timer_reflect(unsigned int measured_us)
+{
+}
+
+/*
+ * The predict governor.  Keep this in sync with
+ * drivers/cpuidle/governors/predict.c.
+ */
+#define PREDICT_HISTORY		8
+#define PREDICT_MAX_US		1000000
+#define PREDICT_ONE		1024
+#define PREDICT_EARLY_LIMIT	(PREDICT_ONE / 2)
+#define PREDICT_DECAY_SHIFT	3
+
+static unsigned int intervals[PREDICT_HISTORY] = {
+	PREDICT_MAX_US, PREDICT_MAX_US, PREDICT_MAX_US, PREDICT_MAX_US,
+	PREDICT_MAX_US, PREDICT_MAX_US, PREDICT_MAX_US, PREDICT_MAX_US,
+};
+static int interval_ptr;
+static unsigned int early[MAX_STATES];
+
+static unsigned int predict_typical_interval(void)
+{
+	unsigned int thresh = UINT_MAX;
+	unsigned int max, avg;
+	unsigned long long sum, variance;
+	int i, divisor;
+
+again:
+	max = 0;
+	sum = 0;
+	divisor = 0;
+	for (i = 0; i < PREDICT_HISTORY; i++) {
+		if (intervals[i] <= thresh) {
+			sum += intervals[i];
+			divisor++;
+			if (intervals[i] > max)
+				max = intervals[i];
+		}
+	}
+	avg = sum / divisor;
+
+	variance = 0;
+	for (i = 0; i < PREDICT_HISTORY; i++) {
+		long long diff;
+
+		if (intervals[i] <= thresh) {
+			diff = (long long)intervals[i] - avg;
+			variance += diff * diff;
+		}
+	}
+	variance /= divisor;
+
+	if (((unsigned long long)avg * avg > variance * 36 &&
+	     divisor * 4 >= PREDICT_HISTORY * 3) || variance <= 400)
+		return avg;
+
+	if (divisor * 4 <= PREDICT_HISTORY * 3)
+		return UINT_MAX;
+
+	thresh = max - 1;
+	goto again;
+}
+
+static int predict_select(unsigned int next_timer_us)
+{
+	unsigned int predicted_us;
+	int i;
+
+	if (latency_req == 0)
+		return 0;
+
+	predicted_us = predict_typical_interval();
+	if (predicted_us > next_timer_us)
+		predicted_us = next_timer_us;
+
+	for (i = 1; i < nr_states; i++) {
+		if (states[i].target_residency > predicted_us)
+			break;
+		if (states[i].exit_latency > latency_req)
+			break;
+		if (early[i] > PREDICT_EARLY_LIMIT)
+			break;
+	}
+	return i - 1;
+}
+
+static void predict_reflect(unsigned int measured_us)
+{
+	int i;
+
+	if (measured_us > PREDICT_MAX_US)
+		measured_us = PREDICT_MAX_US;
+
+	intervals[interval_ptr++] = measured_us;
+	if (interval_ptr >= PREDICT_HISTORY)
+		interval_ptr = 0;
+
+	for (i = 0; i < nr_states; i++) {
+		early[i] -= early[i] >> PREDICT_DECAY_SHIFT;
+		if (measured_us < states[i].target_residency)
+			early[i] += PREDICT_ONE >> PREDICT_DECAY_SHIFT;
+	}
+}
+
+static struct policy policies[] = {
+	{ .name = "timer", .select = timer_select, .reflect = timer_reflect },
+	{ .name = "predict", .select = predict_select,
+	  .reflect = predict_reflect },
+};
+#define NR_POLICIES	(sizeof(policies) / sizeof(policies[0]))
+
+static void replay(struct policy *p, unsigned int next_timer_us,
+		   unsigned int idle_us)
+{
+	int i = p->select(next_timer_us);
+
+	p->entries[i]++;
+	p->idle_us[i] += idle_us;
+	if (idle_us < states[i].target_residency)
+		p->too_deep[i]++;
+	else if (i + 1 < nr_states &&
+		 states[i + 1].exit_latency <= latency_req &&
+		 idle_us >= states[i + 1].target_residency)
+		p->too_shallow[i]++;
+	p->reflect(idle_us);
+}
+
+static void report(struct policy *p, unsigned long periods)
+{
+	unsigned long deep = 0, shallow = 0;
+	int i;
+
+	printf("%s:\n", p->name);
+	printf("  %-12s %10s %10s %10s %12s\n",
+	       "state", "entries", "too deep", "too shal.", "idle ms");
+	for (i = 0; i < nr_states; i++) {
+		printf("  %-12s %10lu %10lu %10lu %12.1f\n", states[i].name,
+		       p->entries[i], p->too_deep[i], p->too_shallow[i],
+		       p->idle_us[i] / 1000);
+		deep += p->too_deep[i];
+		shallow += p->too_shallow[i];
+	}
+	printf("  mispredicted %.1f%% (%.1f%% too deep, %.1f%% too shallow)\n",
+	       100.0 * (deep + shallow) / periods, 100.0 * deep / periods,
+	       100.0 * shallow / periods);
+}
+
+static void parse_state(const char *arg)
+{
+	static int replaced;
+	struct state *s;
+
+	if (!replaced) {
+		nr_states = 0;
+		replaced = 1;
+	}
+	if (nr_states >= MAX_STATES) {
+		fprintf(stderr, "at most %d states\n", MAX_STATES);
+		exit(1);
+	}
+	s = &states[nr_states];
+	if (sscanf(arg, "%15[^:]:%u:%u", s->name, &s->exit_latency,
+		   &s->target_residency) != 3) {
+		fprintf(stderr, "bad state %s, want name:latency:residency\n",
+			arg);
+		exit(1);
+	}
+	nr_states++;
+}
+
+static void usage(void)
+{
+	printf("predict-replay [-l latency us] "
+	       "[-s name:latency:residency ...] [trace]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long periods = 0;
+	long long timer_ns, idle_ns;
+	unsigned int timer_us, idle_us;
+	char line[256];
+	const char *p;
+	FILE *f = stdin;
+	int c, state;
+	unsigned int i;
+
+	while ((c = getopt(argc, argv, "l:s:")) != -1) {
+		switch (c) {
+		case 'l':
+			latency_req = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			parse_state(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (nr_states < 1 || argc - optind > 1)
+		usage();
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (!f) {
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		p = strstr(line, "msm_pm_idle:");
+		if (p) {
+			if (sscanf(p, "msm_pm_idle: state %d timer %lld idle %lld",
+				   &state, &timer_ns, &idle_ns) != 3)
+				continue;
+		} else if (sscanf(line, "%lld %lld", &timer_ns, &idle_ns) != 2)
+			continue;
+		if (timer_ns < 0 || idle_ns < 0)
+			continue;
+
+		timer_us = timer_ns / 1000 > UINT_MAX ? UINT_MAX :
+			timer_ns / 1000;
+		idle_us = idle_ns / 1000 > UINT_MAX ? UINT_MAX :
+			idle_ns / 1000;
+		for (i = 0; i < NR_POLICIES; i++)
+			replay(&policies[i], timer_us, idle_us);
+		periods++;
+	}
+
+	if (!periods) {
+		fprintf(stderr, "no idle periods in the trace\n");
+		return 1;
+	}
+	printf("%lu idle periods\n", periods);
+	for (i = 0; i < NR_POLICIES; i++)
+		report(&policies[i], periods);
+	return 0;
+}
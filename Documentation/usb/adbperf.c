@@ -0,0 +1,225 @@
+/*
+ * adbperf: bulk throughput of the adb function (drivers/usb/gadget/f_adb.c),
+ * measured from both ends.
+ *
+ * The gadget end reads or writes /dev/android_adb in blocks of the given
+ * size; the host end talks to the adb interface directly through usbfs,
+ * the way the adb server would, and finds it by its class, subclass and
+ * protocol (0xff, 0x42, 1).  Each end prints how long the transfer took.
+ * "pull" sends from the gadget to the host, "push" the other way.
+ *
+ * Without a device, both ends can run on one Linux machine: build the
+ * android gadget as a module (CONFIG_USB_ANDROID=m) against dummy_hcd
+ * (CONFIG_USB_GADGET_DUMMY_HCD), load them, start the gadget end and then
+ * the host end on the usbfs node lsusb shows for the "Android" device.
+ * The adb server must not be running, or it owns the interface.
+ *
+ * Gadget writes of at least adb_zero_copy_min bytes are sent from the
+ * writer's pages when the buffer starts on a packet boundary; -a moves the
+ * buffer off the boundary, to measure the copying path instead.
+ *
+ * Compile by:
+ *
+ * gcc -O2 -o adbperf adbperf.c (and arm-eabi-gcc for the gadget end)
+ *
+ * Usage:
+ *
+ * adbperf -g [-s MB] [-b block] [-a offset] pull|push
+ * adbperf /dev/bus/usb/BBB/DDD [-s MB] [-b block] pull|push
+ *
+ * The defaults are 64MB in 16KB blocks, which is also the largest bulk
+ * transfer usbfs takes on 2.6.27 hosts.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/usbdevice_fs.h>
+#include <linux/usb/ch9.h>
+
+#define ADB_CLASS	0xff
+#define ADB_SUBCLASS	0x42
+#define ADB_PROTOCOL	1
+
+static int usb_fd = -1;
+static unsigned int ep_in, ep_out;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Reading a usbfs node gives the device descriptor followed by the
+ * descriptors of its configurations; find the adb interface in them.
+ */
+static int find_adb_interface(int fd)
+{
+	unsigned char desc[4096];
+	struct usb_interface_descriptor *intf;
+	struct usb_endpoint_descriptor *ep;
+	int len, pos, found = 0, ifnum = -1;
+
+	len = read(fd, desc, sizeof(desc));
+	if (len < USB_DT_DEVICE_SIZE)
+		return -1;
+
+	for (pos = USB_DT_DEVICE_SIZE; pos + 2 <= len && desc[pos];
+	     pos += desc[pos]) {
+		switch (desc[pos + 1]) {
+		case USB_DT_INTERFACE:
+			intf = (struct usb_interface_descriptor *)&desc[pos];
+			found = intf->bInterfaceClass == ADB_CLASS &&
+				intf->bInterfaceSubClass == ADB_SUBCLASS &&
+				intf->bInterfaceProtocol == ADB_PROTOCOL;
+			if (found)
+				ifnum = intf->bInterfaceNumber;
+			break;
+		case USB_DT_ENDPOINT:
+			ep = (struct usb_endpoint_descriptor *)&desc[pos];
+			if (!found || (ep->bmAttributes &
+				       USB_ENDPOINT_XFERTYPE_MASK) !=
+			    USB_ENDPOINT_XFER_BULK)
+				break;
+			if (ep->bEndpointAddress & USB_DIR_IN)
+				ep_in = ep->bEndpointAddress;
+			else
+				ep_out = ep->bEndpointAddress;
+			break;
+		}
+	}
+	if (ifnum < 0 || !ep_in || !ep_out)
+		return -1;
+	return ifnum;
+}
+
+static ssize_t usb_bulk(unsigned int ep, void *buf, size_t len)
+{
+	struct usbdevfs_bulktransfer bulk = {
+		.ep = ep,
+		.len = len,
+		.timeout = 5000,
+		.data = buf,
+	};
+
+	return ioctl(usb_fd, USBDEVFS_BULK, &bulk);
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"adbperf -g [-s MB] [-b block] [-a offset] pull|push\n"
+		"adbperf /dev/bus/usb/BBB/DDD [-s MB] [-b block] pull|push\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	long long total, done = 0;
+	size_t block = 16384, offset = 0, len;
+	const char *path = NULL;
+	int gadget = 0, pull, fd, c;
+	unsigned int ifnum;
+	double start, elapsed;
+	ssize_t ret;
+	void *mem;
+	char *buf;
+
+	total = 64LL << 20;
+	while ((c = getopt(argc, argv, "gs:b:a:")) != -1) {
+		switch (c) {
+		case 'g':
+			gadget = 1;
+			break;
+		case 's':
+			total = strtoll(optarg, NULL, 0) << 20;
+			break;
+		case 'b':
+			block = strtoul(optarg, NULL, 0);
+			break;
+		case 'a':
+			offset = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!gadget) {
+		if (optind >= argc)
+			usage();
+		path = argv[optind++];
+	}
+	if (optind != argc - 1 || !block || total <= 0)
+		usage();
+	if (!strcmp(argv[optind], "pull"))
+		pull = 1;
+	else if (!strcmp(argv[optind], "push"))
+		pull = 0;
+	else
+		usage();
+
+	if (posix_memalign(&mem, 4096, block + offset)) {
+		perror("posix_memalign");
+		return 1;
+	}
+	buf = (char *)mem + offset;
+	memset(buf, 0x5a, block);
+
+	if (gadget) {
+		fd = open("/dev/android_adb", O_RDWR);
+		if (fd < 0) {
+			perror("/dev/android_adb");
+			return 1;
+		}
+	} else {
+		fd = open(path, O_RDWR);
+		if (fd < 0) {
+			perror(path);
+			return 1;
+		}
+		c = find_adb_interface(fd);
+		if (c < 0) {
+			fprintf(stderr, "%s: no adb interface\n", path);
+			return 1;
+		}
+		ifnum = c;
+		if (ioctl(fd, USBDEVFS_CLAIMINTERFACE, &ifnum)) {
+			perror("claim interface");
+			return 1;
+		}
+		usb_fd = fd;
+	}
+
+	start = now();
+	while (done < total) {
+		len = total - done < (long long)block ?
+			(size_t)(total - done) : block;
+		/* the gadget writes when pulling, the host when pushing */
+		if (gadget)
+			ret = pull ? write(fd, buf, len) : read(fd, buf, len);
+		else
+			ret = pull ? usb_bulk(ep_in, buf, len) :
+				usb_bulk(ep_out, buf, len);
+		if (ret <= 0) {
+			fprintf(stderr, "%s after %lld bytes: %s\n",
+				(gadget ? pull : !pull) ? "write" : "read",
+				done, ret ? strerror(errno) : "no data");
+			return 1;
+		}
+		done += ret;
+	}
+	elapsed = now() - start;
+
+	printf("%s %s: %lld bytes in %.3f s, %.1f MB/s\n",
+	       gadget ? "gadget" : "host", pull ? "pull" : "push", done,
+	       elapsed, done / elapsed / (1 << 20));
+	return 0;
+}
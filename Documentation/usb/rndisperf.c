@@ -0,0 +1,554 @@
+/*
+ * rndisperf: throughput of RNDIS tethering (drivers/usb/gadget/f_rndis.c
+ * over u_ether.c), and how many packets each USB transfer carries.
+ *
+ * The host end stands in for the host's RNDIS driver: it talks to the
+ * gadget through usbfs, sends the INITIALIZE message and sets the packet
+ * filter, then moves packet messages over the bulk endpoints itself.  The
+ * gadget end sends or receives raw Ethernet frames on the network
+ * interface, with an ethertype of its own (0x88b5) so other traffic is
+ * easy to tell apart.  "pull" sends frames from the gadget to the host,
+ * "push" the other way.
+ *
+ * Pulling, the host end says how large a transfer it takes (-x, given to
+ * the gadget in INITIALIZE) and counts the frames in each transfer it
+ * gets, which shows how well the gadget batched them.  Pushing, it puts as
+ * many frames in each transfer as the gadget allowed in its INITIALIZE
+ * reply (-p takes fewer); the gadget's "ethtool -S usb0" counts them.
+ *
+ * Without a device, both ends can run on one Linux machine: build g_ether
+ * with RNDIS (CONFIG_USB_ETH=m, CONFIG_USB_ETH_RNDIS) against dummy_hcd
+ * (CONFIG_USB_GADGET_DUMMY_HCD), load them, bring usb0 up, then start the
+ * receiving end and after it the sending one.  The host end detaches
+ * rndis_host from the device if it is bound.
+ *
+ * Compile by:
+ *
+ * gcc -O2 -o rndisperf rndisperf.c (and arm-eabi-gcc for the gadget end)
+ *
+ * Usage:
+ *
+ * rndisperf -g [-i interface] [-s MB] [-l frame length] pull|push
+ * rndisperf /dev/bus/usb/BBB/DDD [-s MB] [-l frame length]
+ *	[-x max transfer] [-p packets per transfer] pull|push
+ *
+ * The defaults are 64MB in frames of 1514 bytes, and 16KB transfers.
+ * The receiving end stops after 2 seconds without frames.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <time.h>
+#include <endian.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <linux/usbdevice_fs.h>
+#include <linux/usb/ch9.h>
+
+#define PERF_ETHERTYPE		0x88b5
+#define IDLE_TIMEOUT		2000	/* ms */
+
+#define MSG_PACKET		0x00000001
+#define MSG_INIT		0x00000002
+#define MSG_SET			0x00000005
+#define OID_PACKET_FILTER	0x0001010e
+#define FILTER_ALL		0x0000002f	/* directed, (all) multicast,
+						 * broadcast, promiscuous */
+#define PACKET_HDR_LEN		44
+
+#define SEND_ENCAPSULATED	0x00
+#define GET_ENCAPSULATED	0x01
+
+static int usb_fd = -1;
+static unsigned int ctrl_intf, ep_in, ep_out, maxpacket = 512;
+
+/* what the gadget said in its INITIALIZE reply */
+static uint32_t max_pkts, max_xfer, align_shift;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t get_le32(const unsigned char *p)
+{
+	return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le32(unsigned char *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v >> 8;
+	p[2] = v >> 16;
+	p[3] = v >> 24;
+}
+
+/*
+ * Find the RNDIS control interface (CDC, ACM subclass, vendor protocol)
+ * and the bulk endpoints of the data interface after it.
+ */
+static int find_rndis(int fd, unsigned int *data_intf)
+{
+	unsigned char desc[4096];
+	struct usb_interface_descriptor *intf;
+	struct usb_endpoint_descriptor *ep;
+	int len, pos, state = 0;
+
+	len = read(fd, desc, sizeof(desc));
+	if (len < USB_DT_DEVICE_SIZE)
+		return -1;
+
+	for (pos = USB_DT_DEVICE_SIZE; pos + 2 <= len && desc[pos];
+	     pos += desc[pos]) {
+		switch (desc[pos + 1]) {
+		case USB_DT_INTERFACE:
+			intf = (struct usb_interface_descriptor *)&desc[pos];
+			if (state == 0 &&
+			    intf->bInterfaceClass == USB_CLASS_COMM &&
+			    intf->bInterfaceSubClass == 2 &&
+			    intf->bInterfaceProtocol == 0xff) {
+				ctrl_intf = intf->bInterfaceNumber;
+				state = 1;
+			} else if (state == 1 &&
+				   intf->bInterfaceClass == USB_CLASS_CDC_DATA) {
+				*data_intf = intf->bInterfaceNumber;
+				state = 2;
+			} else if (state == 2)
+				state = 3;
+			break;
+		case USB_DT_ENDPOINT:
+			ep = (struct usb_endpoint_descriptor *)&desc[pos];
+			if (state != 2 || (ep->bmAttributes &
+					   USB_ENDPOINT_XFERTYPE_MASK) !=
+			    USB_ENDPOINT_XFER_BULK)
+				break;
+			if (ep->bEndpointAddress & USB_DIR_IN) {
+				ep_in = ep->bEndpointAddress;
+			} else {
+				ep_out = ep->bEndpointAddress;
+				maxpacket = le16toh(ep->wMaxPacketSize);
+			}
+			break;
+		}
+	}
+	if (state < 2 || !ep_in || !ep_out)
+		return -1;
+	return 0;
+}
+
+static int claim(unsigned int ifnum)
+{
+	struct usbdevfs_ioctl cmd = {
+		.ifno = ifnum,
+		.ioctl_code = USBDEVFS_DISCONNECT,
+	};
+
+	/* fails harmlessly when no driver is bound */
+	ioctl(usb_fd, USBDEVFS_IOCTL, &cmd);
+	return ioctl(usb_fd, USBDEVFS_CLAIMINTERFACE, &ifnum);
+}
+
+static int control(int in, int request, void *buf, int len)
+{
+	struct usbdevfs_ctrltransfer ctrl = {
+		.bRequestType = (in ? USB_DIR_IN : USB_DIR_OUT) |
+			USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+		.bRequest = request,
+		.wIndex = ctrl_intf,
+		.wLength = len,
+		.timeout = 5000,
+		.data = buf,
+	};
+
+	return ioctl(usb_fd, USBDEVFS_CONTROL, &ctrl);
+}
+
+/* send a command, then poll for its completion message */
+static int rndis_command(unsigned char *msg, int len, unsigned char *resp)
+{
+	uint32_t type = get_le32(msg);
+	int tries, ret;
+
+	if (control(0, SEND_ENCAPSULATED, msg, len) < 0)
+		return -1;
+	for (tries = 0; tries < 100; tries++) {
+		ret = control(1, GET_ENCAPSULATED, resp, 1025);
+		if (ret >= 16 && get_le32(resp) == (type | 0x80000000) &&
+		    get_le32(resp + 8) == get_le32(msg + 8))
+			return get_le32(resp + 12) ? -1 : ret;
+		usleep(10000);
+	}
+	errno = ETIMEDOUT;
+	return -1;
+}
+
+static int rndis_init(uint32_t xfer_size)
+{
+	unsigned char msg[32], resp[1025];
+	int ret;
+
+	memset(msg, 0, sizeof(msg));
+	put_le32(msg, MSG_INIT);
+	put_le32(msg + 4, 24);
+	put_le32(msg + 8, 1);			/* RequestID */
+	put_le32(msg + 12, 1);			/* MajorVersion */
+	put_le32(msg + 16, 0);			/* MinorVersion */
+	put_le32(msg + 20, xfer_size);		/* MaxTransferSize */
+	ret = rndis_command(msg, 24, resp);
+	if (ret < 52)
+		return -1;
+	max_pkts = get_le32(resp + 36);
+	max_xfer = get_le32(resp + 40);
+	align_shift = get_le32(resp + 44);
+
+	memset(msg, 0, sizeof(msg));
+	put_le32(msg, MSG_SET);
+	put_le32(msg + 4, 32);
+	put_le32(msg + 8, 2);			/* RequestID */
+	put_le32(msg + 12, OID_PACKET_FILTER);
+	put_le32(msg + 16, 4);			/* InformationBufferLength */
+	put_le32(msg + 20, 20);			/* InformationBufferOffset */
+	put_le32(msg + 28, FILTER_ALL);
+	return rndis_command(msg, 32, resp) < 0 ? -1 : 0;
+}
+
+static ssize_t usb_bulk(unsigned int ep, void *buf, size_t len, int timeout)
+{
+	struct usbdevfs_bulktransfer bulk = {
+		.ep = ep,
+		.len = len,
+		.timeout = timeout,
+		.data = buf,
+	};
+
+	return ioctl(usb_fd, USBDEVFS_BULK, &bulk);
+}
+
+static void fill_frame(unsigned char *frame, size_t len)
+{
+	memset(frame, 0xff, ETH_ALEN);
+	memset(frame + ETH_ALEN, 0x02, ETH_ALEN);
+	frame[12] = PERF_ETHERTYPE >> 8;
+	frame[13] = PERF_ETHERTYPE & 0xff;
+	memset(frame + ETH_HLEN, 0x5a, len - ETH_HLEN);
+}
+
+static int is_perf_frame(const unsigned char *frame, size_t len)
+{
+	return len >= ETH_HLEN && frame[12] == PERF_ETHERTYPE >> 8 &&
+		frame[13] == (PERF_ETHERTYPE & 0xff);
+}
+
+/* transfers by the frames in them: 1, 2-3, 4-7, 8-15, 16 or more */
+static unsigned long hist[5];
+
+static void count_xfer(unsigned int frames)
+{
+	int i = 0;
+
+	while (frames > 1 && i < 4) {
+		frames >>= 1;
+		i++;
+	}
+	hist[i]++;
+}
+
+static void report(const char *who, const char *what, long long frames,
+		   long long bytes, double elapsed, unsigned long xfers)
+{
+	printf("%s %s: %lld frames, %lld bytes in %.3f s, %.1f MB/s\n",
+	       who, what, frames, bytes, elapsed, bytes / elapsed / (1 << 20));
+	if (!xfers)
+		return;
+	printf("%lu transfers, %.2f frames per transfer\n", xfers,
+	       (double)frames / xfers);
+	printf("frames per transfer: 1: %lu, 2-3: %lu, 4-7: %lu, 8-15: %lu, "
+	       "16+: %lu\n", hist[0], hist[1], hist[2], hist[3], hist[4]);
+}
+
+static int host_pull(long long total, uint32_t xfer_size)
+{
+	unsigned char *buf = malloc(xfer_size);
+	long long frames = 0, bytes = 0;
+	unsigned long xfers = 0;
+	double start = 0, last = 0;
+	uint32_t off, msg_len, data_off, data_len, n;
+	ssize_t ret;
+
+	while (bytes < total) {
+		ret = usb_bulk(ep_in, buf, xfer_size, IDLE_TIMEOUT);
+		if (ret < 0) {
+			if (errno == ETIMEDOUT)
+				break;
+			perror("bulk in");
+			return 1;
+		}
+		for (off = 0, n = 0; off + PACKET_HDR_LEN <= (uint32_t)ret;
+		     off += msg_len) {
+			if (get_le32(buf + off) != MSG_PACKET)
+				break;
+			msg_len = get_le32(buf + off + 4);
+			data_off = get_le32(buf + off + 8) + 8;
+			data_len = get_le32(buf + off + 12);
+			if (!msg_len || off + data_off + data_len > ret)
+				break;
+			if (is_perf_frame(buf + off + data_off, data_len)) {
+				n++;
+				bytes += data_len;
+			}
+		}
+		if (!n)
+			continue;
+		if (!frames)
+			start = now();
+		last = now();
+		frames += n;
+		xfers++;
+		count_xfer(n);
+	}
+	if (!frames) {
+		fprintf(stderr, "no frames\n");
+		return 1;
+	}
+	report("host", "pull", frames, bytes, last - start, xfers);
+	return 0;
+}
+
+static int host_push(long long total, size_t frame_len, uint32_t pkts)
+{
+	uint32_t align = 1 << align_shift, msg_len, len, n;
+	unsigned char *buf = malloc(max_xfer + 1);
+	long long frames = 0, bytes = 0;
+	unsigned long xfers = 0;
+	double start;
+
+	msg_len = (PACKET_HDR_LEN + frame_len + align - 1) & ~(align - 1);
+	if (!pkts || pkts > max_pkts)
+		pkts = max_pkts;
+	if (pkts > max_xfer / msg_len)
+		pkts = max_xfer / msg_len;
+	if (!pkts) {
+		fprintf(stderr, "frames don't fit in %u byte transfers\n",
+			max_xfer);
+		return 1;
+	}
+
+	memset(buf, 0, max_xfer + 1);
+	for (n = 0; n < pkts; n++) {
+		unsigned char *msg = buf + n * msg_len;
+
+		put_le32(msg, MSG_PACKET);
+		put_le32(msg + 4, msg_len);
+		put_le32(msg + 8, PACKET_HDR_LEN - 8);	/* DataOffset */
+		put_le32(msg + 12, frame_len);		/* DataLength */
+		fill_frame(msg + PACKET_HDR_LEN, frame_len);
+	}
+
+	start = now();
+	while (bytes < total) {
+		n = pkts;
+		if ((total - bytes) / frame_len < n)
+			n = (total - bytes + frame_len - 1) / frame_len;
+		/* a transfer must end in a short packet, there's no ZLP */
+		len = n * msg_len;
+		if (len % maxpacket == 0)
+			len++;
+		if (usb_bulk(ep_out, buf, len, 5000) < 0) {
+			perror("bulk out");
+			return 1;
+		}
+		frames += n;
+		bytes += (long long)n * frame_len;
+		xfers++;
+		count_xfer(n);
+	}
+	report("host", "push", frames, bytes, now() - start, xfers);
+	return 0;
+}
+
+static int packet_socket(const char *ifname, unsigned char *mac)
+{
+	struct sockaddr_ll sll;
+	struct ifreq ifr;
+	int fd;
+
+	fd = socket(AF_PACKET, SOCK_RAW, htons(PERF_ETHERTYPE));
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname, IFNAMSIZ - 1);
+	if (ioctl(fd, SIOCGIFINDEX, &ifr) < 0) {
+		perror(ifname);
+		return -1;
+	}
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(PERF_ETHERTYPE);
+	sll.sll_ifindex = ifr.ifr_ifindex;
+	if (bind(fd, (struct sockaddr *)&sll, sizeof(sll)) < 0) {
+		perror("bind");
+		return -1;
+	}
+	if (ioctl(fd, SIOCGIFHWADDR, &ifr) < 0) {
+		perror(ifname);
+		return -1;
+	}
+	memcpy(mac, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+	return fd;
+}
+
+static int gadget(const char *ifname, long long total, size_t frame_len,
+		  int pull)
+{
+	unsigned char frame[ETH_FRAME_LEN], mac[ETH_ALEN];
+	struct timeval tv = { IDLE_TIMEOUT / 1000, 0 };
+	long long frames = 0, bytes = 0;
+	double start = 0, last = 0;
+	ssize_t ret;
+	int fd;
+
+	fd = packet_socket(ifname, mac);
+	if (fd < 0)
+		return 1;
+
+	if (pull) {
+		fill_frame(frame, frame_len);
+		memcpy(frame + ETH_ALEN, mac, ETH_ALEN);
+		start = now();
+		while (bytes < total) {
+			ret = send(fd, frame, frame_len, 0);
+			if (ret < 0) {
+				if (errno == ENOBUFS) {
+					usleep(100);
+					continue;
+				}
+				perror("send");
+				return 1;
+			}
+			frames++;
+			bytes += ret;
+		}
+		report("gadget", "pull", frames, bytes, now() - start, 0);
+		return 0;
+	}
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	while (bytes < total) {
+		ret = recv(fd, frame, sizeof(frame), 0);
+		if (ret < 0) {
+			if (errno == EAGAIN && frames)
+				break;
+			if (errno == EAGAIN || errno == EINTR)
+				continue;
+			perror("recv");
+			return 1;
+		}
+		if (!frames)
+			start = now();
+		last = now();
+		frames++;
+		bytes += ret;
+	}
+	report("gadget", "push", frames, bytes, last - start, 0);
+	return 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"rndisperf -g [-i interface] [-s MB] [-l frame length] "
+		"pull|push\n"
+		"rndisperf /dev/bus/usb/BBB/DDD [-s MB] [-l frame length]\n"
+		"\t[-x max transfer] [-p packets per transfer] pull|push\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *ifname = "usb0", *path = NULL;
+	long long total = 64LL << 20;
+	size_t frame_len = ETH_FRAME_LEN;
+	uint32_t xfer_size = 16384, pkts = 0;
+	unsigned int data_intf = 0;
+	int is_gadget = 0, pull, c;
+
+	while ((c = getopt(argc, argv, "gi:s:l:x:p:")) != -1) {
+		switch (c) {
+		case 'g':
+			is_gadget = 1;
+			break;
+		case 'i':
+			ifname = optarg;
+			break;
+		case 's':
+			total = strtoll(optarg, NULL, 0) << 20;
+			break;
+		case 'l':
+			frame_len = strtoul(optarg, NULL, 0);
+			break;
+		case 'x':
+			xfer_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			pkts = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!is_gadget) {
+		if (optind >= argc)
+			usage();
+		path = argv[optind++];
+	}
+	if (optind != argc - 1 || total <= 0 || frame_len < ETH_ZLEN ||
+	    frame_len > ETH_FRAME_LEN || xfer_size < PACKET_HDR_LEN)
+		usage();
+	if (!strcmp(argv[optind], "pull"))
+		pull = 1;
+	else if (!strcmp(argv[optind], "push"))
+		pull = 0;
+	else
+		usage();
+
+	if (is_gadget)
+		return gadget(ifname, total, frame_len, pull);
+
+	usb_fd = open(path, O_RDWR);
+	if (usb_fd < 0) {
+		perror(path);
+		return 1;
+	}
+	if (find_rndis(usb_fd, &data_intf)) {
+		fprintf(stderr, "%s: no RNDIS interfaces\n", path);
+		return 1;
+	}
+	if (claim(ctrl_intf) || claim(data_intf)) {
+		perror("claim interface");
+		return 1;
+	}
+	if (rndis_init(xfer_size)) {
+		perror("RNDIS initialization");
+		return 1;
+	}
+	printf("gadget takes %u packets, %u bytes per transfer, "
+	       "aligned to %u\n", max_pkts, max_xfer, 1 << align_shift);
+
+	return pull ? host_pull(total, xfer_size) :
+		host_push(total, frame_len, pkts);
+}
@@ -0,0 +1,199 @@
+/*
+ * ashmembench: time ASHMEM_PIN and ASHMEM_UNPIN on regions with many
+ * unpinned ranges.
+ *
+ * Each thread creates its own ashmem region of the given size, maps and
+ * touches it, then repeatedly unpins every other page of it one page at
+ * a time, queries the pin status of each page, and pins them back.  This
+ * is what image caches do to their bitmaps, and it leaves the region with
+ * thousands of separate unpinned ranges.  The average cost of each ioctl
+ * is reported, per thread and overall; with more than one thread it also
+ * shows how much the threads get in each other's way.
+ *
+ * Compile by:
+ *
+ * gcc -O2 -o ashmembench ashmembench.c -lpthread
+ *
+ * Usage:
+ *
+ * ashmembench [-s region KB] [-i iterations] [-t threads]
+ *
+ * The defaults are a 16MB region, 10 iterations and one thread.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+#include <linux/types.h>
+
+/* From include/linux/ashmem.h, which is not exported to user space */
+struct ashmem_pin {
+	__u32 offset;
+	__u32 len;
+};
+
+#define __ASHMEMIOC		0x77
+#define ASHMEM_SET_SIZE		_IOW(__ASHMEMIOC, 3, size_t)
+#define ASHMEM_PIN		_IOW(__ASHMEMIOC, 7, struct ashmem_pin)
+#define ASHMEM_UNPIN		_IOW(__ASHMEMIOC, 8, struct ashmem_pin)
+#define ASHMEM_GET_PIN_STATUS	_IO(__ASHMEMIOC, 9)
+
+#define PAGE		4096
+
+enum { OP_UNPIN, OP_STATUS, OP_PIN, NR_OPS };
+
+static const char *op_name[NR_OPS] = { "unpin", "status", "pin" };
+
+struct worker {
+	pthread_t thread;
+	double usecs[NR_OPS];
+	unsigned long count[NR_OPS];
+};
+
+static size_t region_size = 16 << 20;
+static int iterations = 10;
+
+static void fatal(const char *x)
+{
+	perror(x);
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+/* Apply 'cmd' to every other page of the region, and time it */
+static void every_other_page(struct worker *w, int fd, int op, int cmd)
+{
+	struct ashmem_pin pin = { .len = PAGE };
+	double start = now();
+	int ret;
+
+	for (pin.offset = 0; pin.offset < region_size; pin.offset += 2 * PAGE) {
+		ret = ioctl(fd, cmd, &pin);
+		if (ret < 0)
+			fatal(op_name[op]);
+		if (op == OP_STATUS && ret != 0)
+			fprintf(stderr, "page %u still pinned\n",
+				pin.offset / PAGE);
+	}
+	w->usecs[op] += now() - start;
+	w->count[op] += region_size / (2 * PAGE);
+}
+
+static void *worker(void *arg)
+{
+	struct worker *w = arg;
+	char *map;
+	size_t i;
+	int fd, iter;
+
+	fd = open("/dev/ashmem", O_RDWR);
+	if (fd < 0)
+		fatal("/dev/ashmem");
+	if (ioctl(fd, ASHMEM_SET_SIZE, region_size) < 0)
+		fatal("ASHMEM_SET_SIZE");
+	map = mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   fd, 0);
+	if (map == MAP_FAILED)
+		fatal("mmap");
+	for (i = 0; i < region_size; i += PAGE)
+		map[i] = 1;
+
+	for (iter = 0; iter < iterations; iter++) {
+		every_other_page(w, fd, OP_UNPIN, ASHMEM_UNPIN);
+		every_other_page(w, fd, OP_STATUS, ASHMEM_GET_PIN_STATUS);
+		every_other_page(w, fd, OP_PIN, ASHMEM_PIN);
+	}
+
+	munmap(map, region_size);
+	close(fd);
+	return NULL;
+}
+
+static void report(const char *who, double *usecs, unsigned long *count)
+{
+	int op;
+
+	printf("%-10s", who);
+	for (op = 0; op < NR_OPS; op++)
+		printf(" %6s %8.2f us", op_name[op],
+		       count[op] ? usecs[op] / count[op] : 0.0);
+	printf("\n");
+}
+
+static void usage(void)
+{
+	printf("ashmembench [-s region KB] [-i iterations] [-t threads]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	double usecs[NR_OPS] = { 0 };
+	unsigned long count[NR_OPS] = { 0 };
+	struct worker *workers;
+	int nr_threads = 1;
+	char who[32];
+	double start;
+	int c, i, op;
+
+	while ((c = getopt(argc, argv, "s:i:t:")) != -1) {
+		switch (c) {
+		case 's':
+			region_size = strtoul(optarg, NULL, 0) << 10;
+			break;
+		case 'i':
+			iterations = atoi(optarg);
+			break;
+		case 't':
+			nr_threads = atoi(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+	region_size &= ~(size_t)(PAGE - 1);
+	if (region_size < 2 * PAGE || iterations < 1 || nr_threads < 1)
+		usage();
+
+	workers = calloc(nr_threads, sizeof(*workers));
+	if (!workers)
+		fatal("calloc");
+
+	printf("%d threads, %zu KB regions of %zu unpinned ranges, "
+	       "%d iterations\n", nr_threads, region_size >> 10,
+	       region_size / (2 * PAGE), iterations);
+
+	start = now();
+	for (i = 0; i < nr_threads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, worker,
+				   &workers[i]))
+			fatal("pthread_create");
+	}
+	for (i = 0; i < nr_threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		for (op = 0; op < NR_OPS; op++) {
+			usecs[op] += workers[i].usecs[op];
+			count[op] += workers[i].count[op];
+		}
+		if (nr_threads > 1) {
+			snprintf(who, sizeof(who), "thread %d", i);
+			report(who, workers[i].usecs, workers[i].count);
+		}
+	}
+	report("all", usecs, count);
+	printf("elapsed %.2f s\n", (now() - start) / 1e6);
+	return 0;
+}
@@ -0,0 +1,273 @@
+/*
+ * reclaimbench: put a machine under anon + page cache pressure and report
+ * what page reclaim had to do to keep up.
+ *
+ * An anonymous working set is allocated and kept referenced while a file
+ * larger than memory is streamed through the page cache.  The reclaim
+ * counters from /proc/vmstat and the CPU time used by kswapd are sampled
+ * before and after, so that kernels can be compared on the same load:
+ * the fewer pages scanned per page reclaimed, the better.
+ *
+ * Compile by:
+ *
+ * gcc -O2 -o reclaimbench reclaimbench.c
+ *
+ * Usage:
+ *
+ * reclaimbench [-a anon MB] [-f file MB] [-p passes] [-d directory]
+ *
+ * The defaults are 40% of MemTotal of anon memory and a file of twice
+ * MemTotal, read three times.  The file is created in the current
+ * directory unless -d is given, and removed afterwards.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <dirent.h>
+#include <getopt.h>
+#include <sys/mman.h>
+#include <sys/time.h>
+
+#define CHUNK		(1 << 20)
+#define PAGE		4096
+
+/* /proc/vmstat counters reported, summed over all zones */
+static const char *counters[] = {
+	"pgscan_kswapd",
+	"pgscan_direct",
+	"pgsteal",
+	"pgrefill",
+	"pgactivate",
+	"pgdeactivate",
+	"kswapd_steal",
+	"pageoutrun",
+	"allocstall",
+	"pswpout",
+};
+#define NR_COUNTERS (sizeof(counters) / sizeof(counters[0]))
+
+struct sample {
+	unsigned long long count[NR_COUNTERS];
+	unsigned long kswapd_ticks;
+	double time;
+};
+
+static void fatal(const char *x)
+{
+	perror(x);
+	exit(1);
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static unsigned long meminfo(const char *field)
+{
+	char line[128];
+	unsigned long val = 0;
+	size_t len = strlen(field);
+	FILE *f = fopen("/proc/meminfo", "r");
+
+	if (!f)
+		fatal("/proc/meminfo");
+	while (fgets(line, sizeof(line), f))
+		if (!strncmp(line, field, len) && line[len] == ':') {
+			val = strtoul(line + len + 1, NULL, 10);
+			break;
+		}
+	fclose(f);
+	return val;
+}
+
+/* utime + stime of every kswapd thread, in clock ticks */
+static unsigned long kswapd_ticks(void)
+{
+	DIR *dir = opendir("/proc");
+	struct dirent *de;
+	unsigned long total = 0;
+
+	if (!dir)
+		fatal("/proc");
+	while ((de = readdir(dir))) {
+		char path[300], buf[512], *p;
+		unsigned long utime, stime;
+		FILE *f;
+
+		if (de->d_name[0] < '0' || de->d_name[0] > '9')
+			continue;
+		snprintf(path, sizeof(path), "/proc/%s/stat", de->d_name);
+		f = fopen(path, "r");
+		if (!f)
+			continue;
+		p = fgets(buf, sizeof(buf), f);
+		fclose(f);
+		if (!p || !strstr(buf, "(kswapd"))
+			continue;
+		/* Fields 14 and 15, counted after the ")" ending the name */
+		p = strrchr(buf, ')');
+		if (p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u "
+				"%*u %*u %lu %lu", &utime, &stime) == 2)
+			total += utime + stime;
+	}
+	closedir(dir);
+	return total;
+}
+
+static void take_sample(struct sample *s)
+{
+	char name[64];
+	unsigned long long val;
+	unsigned int i;
+	FILE *f = fopen("/proc/vmstat", "r");
+
+	if (!f)
+		fatal("/proc/vmstat");
+	memset(s, 0, sizeof(*s));
+	while (fscanf(f, "%63s %llu", name, &val) == 2)
+		for (i = 0; i < NR_COUNTERS; i++)
+			if (!strncmp(name, counters[i], strlen(counters[i])))
+				s->count[i] += val;
+	fclose(f);
+	s->kswapd_ticks = kswapd_ticks();
+	s->time = now();
+}
+
+/* Reference every page of the anon working set */
+static void touch_anon(char *anon, size_t size, int write)
+{
+	volatile char *p;
+
+	for (p = anon; p < anon + size; p += PAGE) {
+		if (write)
+			*p = 1;
+		else
+			(void)*p;
+	}
+}
+
+static void write_file(int fd, size_t size, char *buf)
+{
+	size_t done;
+
+	memset(buf, 0x5a, CHUNK);
+	for (done = 0; done < size; done += CHUNK) {
+		if (write(fd, buf, CHUNK) != CHUNK)
+			fatal("write");
+	}
+	if (fsync(fd))
+		fatal("fsync");
+}
+
+/*
+ * Stream the file through the page cache once, touching the anon
+ * working set every 16MB so that it stays referenced.
+ */
+static double read_file(int fd, size_t size, char *buf, char *anon,
+			size_t anon_size)
+{
+	size_t done;
+	double start = now();
+
+	if (lseek(fd, 0, SEEK_SET))
+		fatal("lseek");
+	for (done = 0; done < size; done += CHUNK) {
+		if (read(fd, buf, CHUNK) != CHUNK)
+			fatal("read");
+		if (!(done & ((16 << 20) - 1)))
+			touch_anon(anon, anon_size, 0);
+	}
+	return size / (now() - start) / (1 << 20);
+}
+
+static void usage(void)
+{
+	printf("reclaimbench [-a anon MB] [-f file MB] [-p passes] "
+	       "[-d directory]\n");
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long memtotal = meminfo("MemTotal") >> 10;
+	size_t anon_mb = memtotal * 2 / 5;
+	size_t file_mb = memtotal * 2;
+	const char *dir = ".";
+	int passes = 3;
+	struct sample before, after;
+	char path[256], *anon, *buf;
+	size_t anon_size, file_size;
+	long hz = sysconf(_SC_CLK_TCK);
+	unsigned long long scanned, stolen;
+	unsigned int i;
+	int c, fd, pass;
+
+	while ((c = getopt(argc, argv, "a:f:p:d:")) != -1) {
+		switch (c) {
+		case 'a':
+			anon_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			file_mb = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			passes = atoi(optarg);
+			break;
+		case 'd':
+			dir = optarg;
+			break;
+		default:
+			usage();
+		}
+	}
+	if (!file_mb || passes < 1)
+		usage();
+
+	anon_size = anon_mb << 20;
+	file_size = file_mb << 20;
+	printf("MemTotal %lu MB, SwapTotal %lu MB: %zu MB anon, "
+	       "%zu MB file, %d passes\n", memtotal, meminfo("SwapTotal") >> 10,
+	       anon_mb, file_mb, passes);
+
+	buf = malloc(CHUNK);
+	anon = anon_size ? mmap(NULL, anon_size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) : NULL;
+	if (!buf || anon == MAP_FAILED)
+		fatal("allocating memory");
+	touch_anon(anon, anon_size, 1);
+
+	snprintf(path, sizeof(path), "%s/reclaimbench.%d", dir, getpid());
+	fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+		fatal(path);
+	unlink(path);
+	write_file(fd, file_size, buf);
+
+	take_sample(&before);
+	for (pass = 0; pass < passes; pass++)
+		printf("pass %d: %.1f MB/s\n", pass,
+		       read_file(fd, file_size, buf, anon, anon_size));
+	take_sample(&after);
+	close(fd);
+
+	for (i = 0; i < NR_COUNTERS; i++)
+		printf("%-14s %12llu\n", counters[i],
+		       after.count[i] - before.count[i]);
+
+	scanned = after.count[0] - before.count[0] +
+		  after.count[1] - before.count[1];
+	stolen = after.count[2] - before.count[2];
+	printf("scanned/stolen %12.2f\n",
+	       stolen ? (double)scanned / stolen : 0.0);
+	printf("kswapd cpu     %12.2f s\n",
+	       (double)(after.kswapd_ticks - before.kswapd_ticks) / hz);
+	printf("elapsed        %12.2f s\n", after.time - before.time);
+	return 0;
+}
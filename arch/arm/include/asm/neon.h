@@ -0,0 +1,50 @@
+/*
+ *  arch/arm/include/asm/neon.h
+ *
+ *  Kernel-mode NEON support.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+/*
+ * Copies and checksums at least this long go to the NEON versions
+ * when CONFIG_ARM_NEON_LIB is set (must be an ARM immediate).
+ */
+#define NEON_COPY_MIN	256
+#define NEON_CSUM_MIN	256
+
+#ifndef __ASSEMBLY__
+
+#include <linux/types.h>
+#include <asm/checksum.h>
+
+/*
+ * NEON may be used by the kernel between these two calls.  They
+ * disable preemption and must not be called from interrupt context.
+ */
+extern void kernel_neon_begin(void);
+extern void kernel_neon_end(void);
+
+#ifdef CONFIG_ARM_NEON_LIB
+/* Integer versions, also the fallback of the NEON entry points */
+extern void *__memcpy_arm(void *, const void *, __kernel_size_t);
+extern void __copy_page_arm(void *to, const void *from);
+extern __wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+extern __wsum __csum_partial_copy_arm(const void *src, void *dst,
+				      int len, __wsum sum);
+
+/* NEON versions, using the integer ones when NEON can't be used */
+extern void *memcpy_neon(void *, const void *, __kernel_size_t);
+extern void copy_page_neon(void *to, const void *from);
+extern __wsum csum_partial_neon(const void *buff, int len, __wsum sum);
+extern __wsum csum_partial_copy_neon(const void *src, void *dst,
+				     int len, __wsum sum);
+#endif
+
+#endif /* __ASSEMBLY__ */
+
+#endif /* __ASM_ARM_NEON_H */
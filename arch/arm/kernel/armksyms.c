@@ -19,6 +19,7 @@
 #include <asm/system.h>
 #include <asm/uaccess.h>
 #include <asm/ftrace.h>
+#include <asm/neon.h>
 
 /*
  * libgcc functions - functions that are used internally by the
@@ -183,6 +184,17 @@ EXPORT_SYMBOL(_find_next_bit_be);
 
 EXPORT_SYMBOL(copy_page);
 
+#ifdef CONFIG_ARM_NEON_LIB
+EXPORT_SYMBOL(__memcpy_arm);
+EXPORT_SYMBOL(__copy_page_arm);
+EXPORT_SYMBOL(__csum_partial_arm);
+EXPORT_SYMBOL(__csum_partial_copy_arm);
+EXPORT_SYMBOL(memcpy_neon);
+EXPORT_SYMBOL(copy_page_neon);
+EXPORT_SYMBOL(csum_partial_neon);
+EXPORT_SYMBOL(csum_partial_copy_neon);
+#endif
+
 #ifdef CONFIG_FTRACE
 EXPORT_SYMBOL(mcount);
 #endif
@@ -0,0 +1,224 @@
+/*
+ *  linux/arch/arm/lib/copy_bench.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *  Times memcpy, copy_page, csum_partial and csum_partial_copy_nocheck
+ *  over a range of sizes and prints MB/s for each to the kernel log.
+ *  With CONFIG_ARM_NEON_LIB the integer and NEON versions are timed
+ *  separately and their results are cross-checked first.
+ *
+ *	insmod copy_bench.ko [offset=<source misalignment>]
+ *
+ *  Loading always fails with -EAGAIN, so the module need not be removed.
+ */
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/mm.h>
+#include <linux/string.h>
+#include <linux/hrtimer.h>
+#include <net/checksum.h>
+
+#include <asm/div64.h>
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+
+#define BENCH_ORDER	4		/* 64K buffers */
+#define BENCH_BYTES	(4 << 20)	/* Bytes processed per measurement */
+#define BENCH_LINE	160
+
+static unsigned int offset;
+module_param(offset, uint, 0);
+MODULE_PARM_DESC(offset, "Misalignment of the source buffer (0-63)");
+
+static const unsigned int sizes[] = {
+	64, 128, 256, 512, 1024, 1500, 4096, 16384, 32768
+};
+
+static u8 *src, *dst;
+static __wsum sink;
+
+typedef void *(copy_fn)(void *, const void *, __kernel_size_t);
+typedef __wsum (csum_fn)(const void *, int, __wsum);
+typedef __wsum (csum_copy_fn)(const void *, void *, int, __wsum);
+typedef void (page_fn)(void *, const void *);
+
+/* MB/s (10^6 bytes) for bytes processed in ns */
+static unsigned long bench_rate(u64 bytes, s64 ns)
+{
+	bytes *= 1000;
+	if (ns <= 0)
+		return 0;
+	do_div(bytes, (u32)max_t(s64, ns / 1000, 1));
+	return (unsigned long)bytes / 1000;
+}
+
+static void bench_header(void)
+{
+	char line[BENCH_LINE];
+	int i, n;
+
+	n = snprintf(line, sizeof(line), "%-26s", "copy_bench: MB/s");
+	for (i = 0; i < ARRAY_SIZE(sizes); i++)
+		n += snprintf(line + n, sizeof(line) - n, " %6u", sizes[i]);
+	printk(KERN_INFO "%s\n", line);
+}
+
+/*
+ * Time one routine at every size: op 0 copies with cfn, 1 sums with
+ * sfn, 2 copies and sums with xfn.
+ */
+static void bench_sizes(const char *name, int op, copy_fn *cfn,
+			csum_fn *sfn, csum_copy_fn *xfn)
+{
+	char line[BENCH_LINE];
+	const u8 *s = src + offset;
+	unsigned int size, loops, j;
+	int i, n;
+	ktime_t t;
+	s64 ns;
+
+	n = snprintf(line, sizeof(line), "copy_bench: %-14s", name);
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		size = sizes[i];
+		loops = BENCH_BYTES / size;
+
+		t = ktime_get();
+		for (j = 0; j < loops; j++) {
+			if (op == 0)
+				cfn(dst, s, size);
+			else if (op == 1)
+				sink = sfn(s, size, sink);
+			else
+				sink = xfn(s, dst, size, sink);
+		}
+		ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+		n += snprintf(line + n, sizeof(line) - n, " %6lu",
+			      bench_rate((u64)loops * size, ns));
+	}
+	printk(KERN_INFO "%s\n", line);
+}
+
+static void bench_page(const char *name, page_fn *fn)
+{
+	unsigned int j, loops = BENCH_BYTES / PAGE_SIZE;
+	ktime_t t;
+	s64 ns;
+
+	t = ktime_get();
+	for (j = 0; j < loops; j++)
+		fn(dst + PAGE_SIZE * (j & 7), src + PAGE_SIZE * ((j + 1) & 7));
+	ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+	printk(KERN_INFO "copy_bench: %-14s %6lu\n", name,
+	       bench_rate((u64)loops * PAGE_SIZE, ns));
+}
+
+#ifdef CONFIG_ARM_NEON_LIB
+/* The NEON versions must give the same bytes and sums for any alignment */
+static int bench_check(void)
+{
+	unsigned int i, len, so, dof;
+	u8 *s, *d = dst + (PAGE_SIZE << BENCH_ORDER) / 2;
+	__wsum a, b;
+
+	for (i = 0; i < (PAGE_SIZE << BENCH_ORDER) / 2; i++)
+		src[i] = (u8)(i * 7 + (i >> 8));
+
+	for (len = 0; len <= 1600; len += (len < 80) ? 1 : 61) {
+		for (so = 0; so < 16; so++) {
+			for (dof = 0; dof < 16; dof += 3) {
+				s = src + so;
+
+				memset(dst, 0x5a, len + 32);
+				memset(d, 0x5a, len + 32);
+				__memcpy_arm(dst + dof, s, len);
+				memcpy_neon(d + dof, s, len);
+				if (memcmp(dst, d, len + 32))
+					goto mismatch;
+
+				a = __csum_partial_arm(s, len, 0x1234);
+				b = csum_partial_neon(s, len, 0x1234);
+				if (csum_fold(a) != csum_fold(b))
+					goto mismatch;
+
+				b = csum_partial_copy_neon(s, d + dof, len, 0);
+				if (csum_fold(__csum_partial_arm(s, len, 0)) !=
+				    csum_fold(b) || memcmp(d + dof, s, len))
+					goto mismatch;
+			}
+		}
+	}
+
+	__copy_page_arm(dst, src);
+	copy_page_neon(d, src);
+	if (memcmp(dst, d, PAGE_SIZE))
+		goto mismatch;
+
+	return 0;
+
+mismatch:
+	printk(KERN_ERR "copy_bench: NEON result differs (len %u src +%u "
+	       "dst +%u)\n", len, so, dof);
+	return -EIO;
+}
+#endif
+
+static int __init copy_bench_init(void)
+{
+	int err = -EAGAIN;
+
+	src = (u8 *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	dst = (u8 *)__get_free_pages(GFP_KERNEL, BENCH_ORDER);
+	if (!src || !dst) {
+		err = -ENOMEM;
+		goto out;
+	}
+	memset(src, 0x3c, PAGE_SIZE << BENCH_ORDER);
+	memset(dst, 0, PAGE_SIZE << BENCH_ORDER);
+	offset &= 63;
+
+	printk(KERN_INFO "copy_bench: source offset %u, NEON %s\n", offset,
+	       (elf_hwcap & HWCAP_NEON) ? "present" : "not present");
+
+#ifdef CONFIG_ARM_NEON_LIB
+	if (bench_check()) {
+		err = -EIO;
+		goto out;
+	}
+#endif
+
+	bench_header();
+#ifdef CONFIG_ARM_NEON_LIB
+	bench_sizes("memcpy", 0, __memcpy_arm, NULL, NULL);
+	bench_sizes("memcpy_neon", 0, memcpy_neon, NULL, NULL);
+	bench_sizes("csum", 1, NULL, __csum_partial_arm, NULL);
+	bench_sizes("csum_neon", 1, NULL, csum_partial_neon, NULL);
+	bench_sizes("csum_copy", 2, NULL, NULL, __csum_partial_copy_arm);
+	bench_sizes("csum_copy_neon", 2, NULL, NULL, csum_partial_copy_neon);
+	bench_page("copy_page", __copy_page_arm);
+	bench_page("copy_page_neon", copy_page_neon);
+#else
+	bench_sizes("memcpy", 0, memcpy, NULL, NULL);
+	bench_sizes("csum", 1, NULL, csum_partial, NULL);
+	bench_sizes("csum_copy", 2, NULL, NULL, csum_partial_copy_nocheck);
+	bench_page("copy_page", copy_page);
+#endif
+
+out:
+	if (src)
+		free_pages((unsigned long)src, BENCH_ORDER);
+	if (dst)
+		free_pages((unsigned long)dst, BENCH_ORDER);
+	return err;
+}
+
+module_init(copy_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("Memory copy and checksum benchmark");
@@ -0,0 +1,101 @@
+/*
+ *  linux/arch/arm/lib/neon_glue.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *  memcpy, copy_page, csum_partial and csum_partial_copy_nocheck
+ *  branch here for large enough requests.  The NEON versions are used
+ *  once vfp_init() has found NEON, and only outside interrupt context;
+ *  everything else goes back to the integer versions.
+ */
+#include <linux/kernel.h>
+#include <linux/hardirq.h>
+#include <net/checksum.h>
+
+#include <asm/hwcap.h>
+#include <asm/neon.h>
+
+/* Largest block handed to __csum_partial_neon() in one go */
+#define NEON_CSUM_CHUNK	(1 << 20)
+
+extern void __memcpy_neon(void *dst, const void *src, __kernel_size_t n);
+extern void __copy_page_neon(void *to, const void *from);
+extern u32 __csum_partial_neon(const void *buf, int len);
+
+static inline int neon_usable(void)
+{
+	return (elf_hwcap & HWCAP_NEON) && !in_interrupt();
+}
+
+void *memcpy_neon(void *dst, const void *src, __kernel_size_t n)
+{
+	if (!neon_usable())
+		return __memcpy_arm(dst, src, n);
+
+	kernel_neon_begin();
+	__memcpy_neon(dst, src, n);
+	kernel_neon_end();
+	return dst;
+}
+
+void copy_page_neon(void *to, const void *from)
+{
+	if (!neon_usable()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__copy_page_neon(to, from);
+	kernel_neon_end();
+}
+
+/*
+ * The NEON core wants a 16 byte aligned buffer and whole 64 byte
+ * blocks; the head and tail are summed by the integer code and the
+ * pieces combined according to their offset in the buffer.
+ */
+static __wsum csum_neon(const void *buff, int len, __wsum sum)
+{
+	const unsigned char *p = buff;
+	int off, blk;
+
+	off = min_t(int, (-(unsigned long)p) & 15, len);
+	sum = __csum_partial_arm(p, off, sum);
+
+	while (len - off >= 64) {
+		blk = min_t(int, (len - off) & ~63, NEON_CSUM_CHUNK);
+		sum = csum_block_add(sum,
+			(__force __wsum)__csum_partial_neon(p + off, blk), off);
+		off += blk;
+	}
+
+	return csum_block_add(sum, __csum_partial_arm(p + off, len - off, 0),
+			      off);
+}
+
+__wsum csum_partial_neon(const void *buff, int len, __wsum sum)
+{
+	if (!neon_usable())
+		return __csum_partial_arm(buff, len, sum);
+
+	kernel_neon_begin();
+	sum = csum_neon(buff, len, sum);
+	kernel_neon_end();
+	return sum;
+}
+
+__wsum csum_partial_copy_neon(const void *src, void *dst, int len, __wsum sum)
+{
+	if (!neon_usable())
+		return __csum_partial_copy_arm(src, dst, len, sum);
+
+	/* Sum the destination while it is still in the cache */
+	kernel_neon_begin();
+	__memcpy_neon(dst, src, len);
+	sum = csum_neon(dst, len, sum);
+	kernel_neon_end();
+	return sum;
+}
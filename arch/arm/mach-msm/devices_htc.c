@@ -251,6 +251,19 @@ static struct platform_device ram_console_device = {
 	.resource       = ram_console_resource,
 };
 
+static struct resource ram_trace_resource[] = {
+	{
+		.flags	= IORESOURCE_MEM,
+	}
+};
+
+static struct platform_device ram_trace_device = {
+	.name = "ram_trace",
+	.id = -1,
+	.num_resources  = ARRAY_SIZE(ram_trace_resource),
+	.resource       = ram_trace_resource,
+};
+
 void __init msm_add_mem_devices(struct msm_pmem_setting *setting)
 {
 	if (setting->pmem_size) {
@@ -289,6 +302,13 @@ void __init msm_add_mem_devices(struct msm_pmem_setting *setting)
 			+ setting->ram_console_size - 1;
 		platform_device_register(&ram_console_device);
 	}
+
+	if (setting->ram_trace_size) {
+		ram_trace_resource[0].start = setting->ram_trace_start;
+		ram_trace_resource[0].end = setting->ram_trace_start
+			+ setting->ram_trace_size - 1;
+		platform_device_register(&ram_trace_device);
+	}
 }
 
 #define PM_LIBPROG      0x30000061
@@ -31,6 +31,8 @@ struct msm_pmem_setting{
 	resource_size_t pmem_camera_size;
 	resource_size_t ram_console_start;
 	resource_size_t ram_console_size;
+	resource_size_t ram_trace_start;
+	resource_size_t ram_trace_size;
 };
 
 enum {
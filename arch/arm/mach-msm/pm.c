@@ -19,6 +19,7 @@
 #include <linux/module.h>
 #include <linux/kernel.h>
 #include <linux/clk.h>
+#include <linux/cpuidle.h>
 #include <linux/delay.h>
 #include <linux/init.h>
 #include <linux/pm.h>
@@ -53,6 +54,7 @@ enum {
 	MSM_PM_DEBUG_RESET_VECTOR = 1U << 4,
 	MSM_PM_DEBUG_SMSM_STATE = 1U << 5,
 	MSM_PM_DEBUG_IDLE = 1U << 6,
+	MSM_PM_DEBUG_IDLE_TRACE = 1U << 7,
 };
 static int msm_pm_debug_mask;
 module_param_named(debug_mask, msm_pm_debug_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
@@ -103,7 +105,6 @@ static uint32_t *msm_pm_reset_vector;
 static uint32_t msm_pm_max_sleep_time;
 static struct msm_pm_platform_data *msm_pm_modes;
 
-#ifdef CONFIG_MSM_IDLE_STATS
 enum msm_pm_time_stats_id {
 	MSM_PM_STAT_REQUESTED_IDLE,
 	MSM_PM_STAT_IDLE_SPIN,
@@ -118,6 +119,7 @@ enum msm_pm_time_stats_id {
 	MSM_PM_STAT_COUNT
 };
 
+#ifdef CONFIG_MSM_IDLE_STATS
 static struct msm_pm_time_stats {
 	const char *name;
 	int64_t first_bucket_time;
@@ -126,6 +128,8 @@ static struct msm_pm_time_stats {
 	int64_t max_time[CONFIG_MSM_IDLE_STATS_BUCKET_COUNT];
 	int count;
 	int64_t total_time;
+	int too_deep;		/* woke up before the state paid off */
+	int too_shallow;	/* stayed long enough for a deeper state */
 } msm_pm_stats[MSM_PM_STAT_COUNT] = {
 	[MSM_PM_STAT_REQUESTED_IDLE].name = "idle-request",
 	[MSM_PM_STAT_REQUESTED_IDLE].first_bucket_time =
@@ -190,6 +194,23 @@ static void msm_pm_add_stat(enum msm_pm_time_stats_id id, int64_t t)
 		msm_pm_stats[id].max_time[i] = t;
 }
 
+/*
+ * Account an idle period, and whether the state chosen for it turned out
+ * wrong: too deep if the cpu woke up before min_time, the time it takes
+ * the state to pay for its entry and exit, or too shallow if it stayed
+ * idle for at least deeper_min_time, which a deeper state allowed at the
+ * time needed (0 if there was none).
+ */
+static void msm_pm_add_idle_stat(enum msm_pm_time_stats_id id, int64_t t,
+	int64_t min_time, int64_t deeper_min_time)
+{
+	msm_pm_add_stat(id, t);
+	if (t < min_time)
+		msm_pm_stats[id].too_deep++;
+	else if (deeper_min_time && t >= deeper_min_time)
+		msm_pm_stats[id].too_shallow++;
+}
+
 static uint32_t msm_pm_sleep_limit = SLEEP_LIMIT_NONE;
 static DECLARE_BITMAP(msm_pm_clocks_no_tcxo_shutdown, NR_CLKS);
 #endif
@@ -460,42 +481,151 @@ void msm_pm_set_max_sleep_time(int64_t max_sleep_time_ns)
 }
 EXPORT_SYMBOL(msm_pm_set_max_sleep_time);
 
-void arch_idle(void)
+/*
+ * Sleep in idle is ruled out by idle wake locks and by interrupts that
+ * cannot wake the cpu from it.
+ */
+static int msm_pm_idle_sleep_allowed(void)
+{
+#ifdef CONFIG_HAS_WAKELOCK
+	if (has_wake_lock(WAKE_LOCK_IDLE))
+		return 0;
+#endif
+	return msm_irq_idle_sleep_allowed();
+}
+
+static uint32_t msm_pm_idle_sleep_limit(int latency_qos)
+{
+	struct msm_pm_platform_data *mode;
+
+	mode = &msm_pm_modes[MSM_PM_SLEEP_MODE_POWER_COLLAPSE];
+	if (mode->latency >= latency_qos)
+		return SLEEP_LIMIT_NO_TCXO_SHUTDOWN;
+	return SLEEP_LIMIT_NONE;
+}
+
+static int msm_pm_idle_spin(void)
+{
+	while (!msm_irq_pending())
+		udelay(1);
+	return MSM_PM_STAT_IDLE_SPIN;
+}
+
+static int msm_pm_idle_wfi(void)
+{
+	unsigned long saved_rate;
+	int exit_stat;
+
+	saved_rate = acpuclk_wait_for_irq();
+	if (msm_pm_debug_mask & MSM_PM_DEBUG_CLOCK)
+		printk(KERN_DEBUG "arch_idle: clk %ld -> swfi\n",
+			saved_rate);
+	if (saved_rate) {
+		msm_arch_idle();
+		exit_stat = MSM_PM_STAT_IDLE_WFI;
+	} else
+		exit_stat = msm_pm_idle_spin();
+	if (msm_pm_debug_mask & MSM_PM_DEBUG_CLOCK)
+		printk(KERN_DEBUG "msm_sleep: clk swfi -> %ld\n",
+			saved_rate);
+	if (saved_rate
+	    && acpuclk_set_rate(saved_rate, SETRATE_SWFI) < 0)
+		printk(KERN_ERR "msm_sleep(): clk_set_rate %ld "
+		       "failed\n", saved_rate);
+	return exit_stat;
+}
+
+static int msm_pm_idle_sleep(int sleep_mode, int64_t sleep_time,
+	uint32_t sleep_limit)
 {
 	int ret;
+	int exit_stat;
+#ifdef CONFIG_MSM_IDLE_STATS
+	DECLARE_BITMAP(clk_ids, NR_CLKS);
+
+	ret = msm_clock_require_tcxo(clk_ids, NR_CLKS);
+#elif defined(CONFIG_CLOCK_BASED_SLEEP_LIMIT)
+	ret = msm_clock_require_tcxo(NULL, 0);
+#endif
+
+#ifdef CONFIG_CLOCK_BASED_SLEEP_LIMIT
+	if (ret)
+		sleep_limit = SLEEP_LIMIT_NO_TCXO_SHUTDOWN;
+#endif
+
+	do_div(sleep_time, NSEC_PER_SEC / 32768);
+	if (sleep_time > 0x6DDD000) {
+		printk("sleep_time too big %lld\n", sleep_time);
+		sleep_time = 0x6DDD000;
+	}
+	ret = msm_sleep(sleep_mode, sleep_time, sleep_limit, 1);
+	switch (sleep_mode) {
+	case MSM_PM_SLEEP_MODE_POWER_COLLAPSE_SUSPEND:
+	case MSM_PM_SLEEP_MODE_POWER_COLLAPSE:
+		if (ret)
+			exit_stat = MSM_PM_STAT_IDLE_FAILED_POWER_COLLAPSE;
+		else {
+			exit_stat = MSM_PM_STAT_IDLE_POWER_COLLAPSE;
+#ifdef CONFIG_MSM_IDLE_STATS
+			msm_pm_sleep_limit = sleep_limit;
+			bitmap_copy(msm_pm_clocks_no_tcxo_shutdown,
+				clk_ids, NR_CLKS);
+#endif
+		}
+		break;
+	case MSM_PM_SLEEP_MODE_APPS_SLEEP:
+		if (ret)
+			exit_stat = MSM_PM_STAT_IDLE_FAILED_SLEEP;
+		else
+			exit_stat = MSM_PM_STAT_IDLE_SLEEP;
+		break;
+	default:
+		exit_stat = MSM_PM_STAT_IDLE_WFI;
+	}
+	return exit_stat;
+}
+
+/*
+ * Record an idle period for offline replay of the idle governor, see
+ * Documentation/cpuidle/predict-replay.c.
+ */
+static void msm_pm_idle_trace(int exit_stat, int64_t sleep_time, int64_t t)
+{
+	if (msm_pm_debug_mask & MSM_PM_DEBUG_IDLE_TRACE)
+		printk(KERN_DEBUG "msm_pm_idle: state %d timer %lld idle %lld\n",
+		       exit_stat, sleep_time, t);
+}
+
+void arch_idle(void)
+{
 	int spin;
 	int64_t sleep_time;
+	int64_t t1, t2;
 	int low_power = 0;
+	int exit_stat;
+	int64_t min_time = 0, deeper_min_time = 0;
 	struct msm_pm_platform_data *mode;
 #ifdef CONFIG_MSM_IDLE_STATS
-	DECLARE_BITMAP(clk_ids, NR_CLKS);
-	int64_t t1;
-	static int64_t t2;
-	int exit_stat;
+	static int64_t last_exit;
 #endif
 	int latency_qos = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
-	uint32_t sleep_limit = SLEEP_LIMIT_NONE;
+	uint32_t sleep_limit;
 	int allow_sleep =
 		msm_pm_idle_sleep_mode < MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT &&
-#ifdef CONFIG_HAS_WAKELOCK
-		!has_wake_lock(WAKE_LOCK_IDLE) &&
-#endif
-		msm_irq_idle_sleep_allowed();
+		msm_pm_idle_sleep_allowed();
 
 	if (!atomic_read(&msm_pm_init_done))
 		return;
 
 	sleep_time = msm_timer_enter_idle();
 
-#ifdef CONFIG_MSM_IDLE_STATS
 	t1 = ktime_to_ns(ktime_get());
-	msm_pm_add_stat(MSM_PM_STAT_NOT_IDLE, t1 - t2);
+#ifdef CONFIG_MSM_IDLE_STATS
+	msm_pm_add_stat(MSM_PM_STAT_NOT_IDLE, t1 - last_exit);
 	msm_pm_add_stat(MSM_PM_STAT_REQUESTED_IDLE, sleep_time);
 #endif
 
-	mode = &msm_pm_modes[MSM_PM_SLEEP_MODE_POWER_COLLAPSE];
-	if (mode->latency >= latency_qos)
-		sleep_limit = SLEEP_LIMIT_NO_TCXO_SHUTDOWN;
+	sleep_limit = msm_pm_idle_sleep_limit(latency_qos);
 
 	mode = &msm_pm_modes[MSM_PM_SLEEP_MODE_POWER_COLLAPSE_NO_XO_SHUTDOWN];
 	if (mode->latency >= latency_qos)
@@ -505,11 +635,7 @@ void arch_idle(void)
 		MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT];
 	if (mode->latency >= latency_qos) {
 		/* no time even for SWFI */
-		while (!msm_irq_pending())
-			udelay(1);
-#ifdef CONFIG_MSM_IDLE_STATS
-		exit_stat = MSM_PM_STAT_IDLE_SPIN;
-#endif
+		exit_stat = msm_pm_idle_spin();
 		goto abort_idle;
 	}
 
@@ -519,91 +645,206 @@ void arch_idle(void)
 	spin = msm_pm_idle_spin_time >> 10;
 	while (spin-- > 0) {
 		if (msm_irq_pending()) {
-#ifdef CONFIG_MSM_IDLE_STATS
 			exit_stat = MSM_PM_STAT_IDLE_SPIN;
-#endif
 			goto abort_idle;
 		}
 		udelay(1);
 	}
 	if (sleep_time < msm_pm_idle_sleep_min_time || !allow_sleep) {
-		unsigned long saved_rate;
-		saved_rate = acpuclk_wait_for_irq();
-		if (msm_pm_debug_mask & MSM_PM_DEBUG_CLOCK)
-			printk(KERN_DEBUG "arch_idle: clk %ld -> swfi\n",
-				saved_rate);
-		if (saved_rate) {
-			msm_arch_idle();
-#ifdef CONFIG_MSM_IDLE_STATS
-			exit_stat = MSM_PM_STAT_IDLE_WFI;
-#endif
-		} else {
-			while (!msm_irq_pending())
-				udelay(1);
+		exit_stat = msm_pm_idle_wfi();
+		if (allow_sleep)
+			deeper_min_time = msm_pm_idle_sleep_min_time;
+	} else {
+		low_power = 1;
+		exit_stat = msm_pm_idle_sleep(msm_pm_idle_sleep_mode,
+			sleep_time, sleep_limit);
+		min_time = msm_pm_idle_sleep_min_time;
+	}
+abort_idle:
+	msm_timer_exit_idle(low_power);
+	t2 = ktime_to_ns(ktime_get());
 #ifdef CONFIG_MSM_IDLE_STATS
-			exit_stat = MSM_PM_STAT_IDLE_SPIN;
+	last_exit = t2;
+	msm_pm_add_idle_stat(exit_stat, t2 - t1, min_time, deeper_min_time);
 #endif
-		}
-		if (msm_pm_debug_mask & MSM_PM_DEBUG_CLOCK)
-			printk(KERN_DEBUG "msm_sleep: clk swfi -> %ld\n",
-				saved_rate);
-		if (saved_rate
-		    && acpuclk_set_rate(saved_rate, SETRATE_SWFI) < 0)
-			printk(KERN_ERR "msm_sleep(): clk_set_rate %ld "
-			       "failed\n", saved_rate);
-  	} else {
+	msm_pm_idle_trace(exit_stat, sleep_time, t2 - t1);
+}
+
+#ifdef CONFIG_CPU_IDLE
+/*
+ * With cpuidle the states below are offered to the idle governor, which
+ * chooses between them instead of the fixed thresholds in arch_idle().
+ * Shallowest first; the sleep states hand their mode to msm_sleep().
+ */
+enum {
+	MSM_CPUIDLE_SPIN,
+	MSM_CPUIDLE_WFI,
+	MSM_CPUIDLE_RAMP_DOWN,
+	MSM_CPUIDLE_APPS_SLEEP,
+	MSM_CPUIDLE_POWER_COLLAPSE,
+	MSM_CPUIDLE_NR_STATES
+};
+
+static const struct {
+	const char *name;
+	const char *desc;
+	int sleep_mode;
+} msm_cpuidle_states[MSM_CPUIDLE_NR_STATES] = {
+	[MSM_CPUIDLE_SPIN] = { "spin", "busy wait",
+		MSM_PM_SLEEP_MODE_NR },
+	[MSM_CPUIDLE_WFI] = { "wfi", "SWFI",
+		MSM_PM_SLEEP_MODE_WAIT_FOR_INTERRUPT },
+	[MSM_CPUIDLE_RAMP_DOWN] = { "ramp-down", "clock ramp down and SWFI",
+		MSM_PM_SLEEP_MODE_RAMP_DOWN_AND_WAIT_FOR_INTERRUPT },
+	[MSM_CPUIDLE_APPS_SLEEP] = { "sleep", "apps sleep",
+		MSM_PM_SLEEP_MODE_APPS_SLEEP },
+	[MSM_CPUIDLE_POWER_COLLAPSE] = { "pc", "power collapse",
+		MSM_PM_SLEEP_MODE_POWER_COLLAPSE },
+};
+
+static struct cpuidle_driver msm_cpuidle_driver = {
+	.name = "msm_idle",
+	.owner = THIS_MODULE,
+};
+
+static struct cpuidle_device msm_cpuidle_device;
+
+/*
+ * The governor knows about latency limits but not about wake locks, the
+ * interrupts that are enabled or the idle_sleep_mode parameter: step
+ * down to the deepest state they still allow.
+ */
+static int msm_cpuidle_allowed_state(int idx)
+{
+	if (idx <= MSM_CPUIDLE_WFI)
+		return idx;
+	while (idx > MSM_CPUIDLE_WFI &&
+	       msm_cpuidle_states[idx].sleep_mode < msm_pm_idle_sleep_mode)
+		idx--;
+	if (idx > MSM_CPUIDLE_WFI && !msm_pm_idle_sleep_allowed())
+		idx = MSM_CPUIDLE_WFI;
+	return idx;
+}
+
+static int msm_cpuidle_enter(struct cpuidle_device *dev,
+	struct cpuidle_state *state)
+{
+	int idx = state - dev->states;
+	int latency_qos = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
+	int64_t sleep_time;
+	int64_t t1, t2;
+	int low_power = 0;
+	int exit_stat;
 #ifdef CONFIG_MSM_IDLE_STATS
-		ret = msm_clock_require_tcxo(clk_ids, NR_CLKS);
-#elif defined(CONFIG_CLOCK_BASED_SLEEP_LIMIT)
-		ret = msm_clock_require_tcxo(NULL, 0);
+	static int64_t last_exit;
+	struct cpuidle_state *deeper = NULL;
 #endif
 
-#ifdef CONFIG_CLOCK_BASED_SLEEP_LIMIT
-		if (ret)
-			sleep_limit = SLEEP_LIMIT_NO_TCXO_SHUTDOWN;
-#endif
+	local_irq_disable();
+	if (need_resched()) {
+		local_irq_enable();
+		return 0;
+	}
 
-		low_power = 1;
-		do_div(sleep_time, NSEC_PER_SEC / 32768);
-		if (sleep_time > 0x6DDD000) {
-			printk("sleep_time too big %lld\n", sleep_time);
-			sleep_time = 0x6DDD000;
-		}
-		ret = msm_sleep(msm_pm_idle_sleep_mode, sleep_time,
-			sleep_limit, 1);
+	idx = msm_cpuidle_allowed_state(idx);
+	state = dev->last_state = &dev->states[idx];
+
+	sleep_time = msm_timer_enter_idle();
+	t1 = ktime_to_ns(ktime_get());
 #ifdef CONFIG_MSM_IDLE_STATS
-		switch (msm_pm_idle_sleep_mode) {
-		case MSM_PM_SLEEP_MODE_POWER_COLLAPSE_SUSPEND:
-		case MSM_PM_SLEEP_MODE_POWER_COLLAPSE:
-			if (ret)
-				exit_stat =
-					MSM_PM_STAT_IDLE_FAILED_POWER_COLLAPSE;
-			else {
-				exit_stat = MSM_PM_STAT_IDLE_POWER_COLLAPSE;
-				msm_pm_sleep_limit = sleep_limit;
-				bitmap_copy(msm_pm_clocks_no_tcxo_shutdown,
-					clk_ids, NR_CLKS);
-			}
-			break;
-		case MSM_PM_SLEEP_MODE_APPS_SLEEP:
-			if (ret)
-				exit_stat = MSM_PM_STAT_IDLE_FAILED_SLEEP;
-			else
-				exit_stat = MSM_PM_STAT_IDLE_SLEEP;
-			break;
-		default:
-			exit_stat = MSM_PM_STAT_IDLE_WFI;
-		}
+	msm_pm_add_stat(MSM_PM_STAT_NOT_IDLE, t1 - last_exit);
+	msm_pm_add_stat(MSM_PM_STAT_REQUESTED_IDLE, sleep_time);
 #endif
+
+	switch (idx) {
+	case MSM_CPUIDLE_SPIN:
+		exit_stat = msm_pm_idle_spin();
+		break;
+	case MSM_CPUIDLE_WFI:
+		exit_stat = msm_pm_idle_wfi();
+		break;
+	default:
+		low_power = 1;
+		exit_stat = msm_pm_idle_sleep(msm_cpuidle_states[idx].sleep_mode,
+			sleep_time, msm_pm_idle_sleep_limit(latency_qos));
 	}
-abort_idle:
+
 	msm_timer_exit_idle(low_power);
-#ifdef CONFIG_MSM_IDLE_STATS
 	t2 = ktime_to_ns(ktime_get());
-	msm_pm_add_stat(exit_stat, t2 - t1);
+#ifdef CONFIG_MSM_IDLE_STATS
+	last_exit = t2;
+	if (idx + 1 < dev->state_count &&
+	    msm_cpuidle_allowed_state(idx + 1) > idx &&
+	    dev->states[idx + 1].exit_latency < latency_qos)
+		deeper = &dev->states[idx + 1];
+	msm_pm_add_idle_stat(exit_stat, t2 - t1,
+		(int64_t)state->target_residency * NSEC_PER_USEC,
+		deeper ? (int64_t)deeper->target_residency * NSEC_PER_USEC : 0);
 #endif
+	msm_pm_idle_trace(exit_stat, sleep_time, t2 - t1);
+	local_irq_enable();
+
+	t2 -= t1;
+	do_div(t2, NSEC_PER_USEC);
+	return t2;
 }
 
+/*
+ * Latencies come from the board's msm_pm_platform_data.  A sleep state
+ * has to last at least twice its latency, and at least as long as the
+ * idle_sleep_min_time parameter if it involves the modem, to pay off;
+ * SWFI pays off once the cpu would have stopped spinning in arch_idle().
+ */
+static void __init msm_cpuidle_init(void)
+{
+	struct cpuidle_device *dev = &msm_cpuidle_device;
+	struct msm_pm_platform_data *mode;
+	struct cpuidle_state *state;
+	int i;
+
+	if (cpuidle_register_driver(&msm_cpuidle_driver))
+		return;
+
+	for (i = 0; i < MSM_CPUIDLE_NR_STATES; i++) {
+		state = &dev->states[i];
+		strlcpy(state->name, msm_cpuidle_states[i].name,
+			CPUIDLE_NAME_LEN);
+		strlcpy(state->desc, msm_cpuidle_states[i].desc,
+			CPUIDLE_DESC_LEN);
+		state->flags = CPUIDLE_FLAG_TIME_VALID;
+		state->enter = msm_cpuidle_enter;
+		if (i == MSM_CPUIDLE_SPIN) {
+			state->flags |= CPUIDLE_FLAG_POLL;
+			continue;
+		}
+
+		mode = &msm_pm_modes[msm_cpuidle_states[i].sleep_mode];
+		state->exit_latency = mode->latency;
+		state->target_residency = max(mode->residency,
+			2 * mode->latency);
+		if (i == MSM_CPUIDLE_WFI)
+			state->target_residency = max_t(u32,
+				state->target_residency,
+				msm_pm_idle_spin_time / NSEC_PER_USEC);
+		if (i >= MSM_CPUIDLE_APPS_SLEEP)
+			state->target_residency = max_t(u32,
+				state->target_residency,
+				msm_pm_idle_sleep_min_time / NSEC_PER_USEC);
+	}
+	dev->state_count = MSM_CPUIDLE_NR_STATES;
+	dev->safe_state = &dev->states[MSM_CPUIDLE_WFI];
+
+	if (cpuidle_register_device(dev)) {
+		printk(KERN_ERR "msm_pm_init: cpuidle registration failed\n");
+		cpuidle_unregister_driver(&msm_cpuidle_driver);
+	}
+}
+#else
+static inline void msm_cpuidle_init(void)
+{
+}
+#endif /* CONFIG_CPU_IDLE */
+
 static int msm_pm_enter(suspend_state_t state)
 {
 	uint32_t sleep_limit;
@@ -899,6 +1140,13 @@ static int msm_pm_read_proc(
 			msm_pm_stats[off].min_time[i],
 			msm_pm_stats[off].max_time[i]);
 
+		if (off >= MSM_PM_STAT_IDLE_SPIN &&
+		    off <= MSM_PM_STAT_IDLE_FAILED_POWER_COLLAPSE)
+			SNPRINTF(p, count,
+				"  mispredict: %7d too deep, %7d too shallow\n",
+				msm_pm_stats[off].too_deep,
+				msm_pm_stats[off].too_shallow);
+
 		*start = (char *) 1;
 		*eof = (off + 1 >= ARRAY_SIZE(msm_pm_stats));
 	}
@@ -945,6 +1193,8 @@ static int msm_pm_write_proc(struct file *file, const char __user *buffer,
 			0, sizeof(msm_pm_stats[i].max_time));
 		msm_pm_stats[i].count = 0;
 		msm_pm_stats[i].total_time = 0;
+		msm_pm_stats[i].too_deep = 0;
+		msm_pm_stats[i].too_shallow = 0;
 	}
 
 	msm_pm_sleep_limit = SLEEP_LIMIT_NONE;
@@ -1021,6 +1271,7 @@ static int __init msm_pm_init(void)
 
 	atomic_set(&msm_pm_init_done, 1);
 	suspend_set_ops(&msm_pm_ops);
+	msm_cpuidle_init();
 
 #ifdef CONFIG_MSM_IDLE_STATS
 	d_entry = create_proc_entry("msm_pm_stats",
@@ -14,9 +14,11 @@
 #include <linux/signal.h>
 #include <linux/sched.h>
 #include <linux/init.h>
+#include <linux/hardirq.h>
 
 #include <asm/thread_notify.h>
 #include <asm/vfp.h>
+#include <asm/neon.h>
 
 #include "vfpinstr.h"
 #include "vfp.h"
@@ -312,6 +314,41 @@ void VFP_bounce(u32 trigger, u32 fpexc, struct pt_regs *regs)
 		vfp_raise_exceptions(exceptions, trigger, orig_fpscr, regs);
 }
 
+#ifdef CONFIG_NEON
+/*
+ * Kernel-mode NEON.  The VFP registers are switched lazily, so they
+ * may still hold some thread's state: save it to that thread and
+ * forget the owner, so the thread's next VFP instruction traps and
+ * reloads it.  Preemption stays disabled until kernel_neon_end(),
+ * and interrupt handlers must not use NEON at all.
+ */
+void kernel_neon_begin(void)
+{
+	unsigned int cpu;
+	u32 fpexc;
+
+	BUG_ON(in_interrupt());
+	cpu = get_cpu();
+
+	fpexc = fmrx(FPEXC) | FPEXC_EN;
+	fmxr(FPEXC, fpexc);
+
+	if (last_VFP_context[cpu]) {
+		vfp_save_state(last_VFP_context[cpu], fpexc);
+		last_VFP_context[cpu] = NULL;
+	}
+}
+EXPORT_SYMBOL(kernel_neon_begin);
+
+void kernel_neon_end(void)
+{
+	/* Disable again so the next user of VFP takes the lazy trap */
+	fmxr(FPEXC, fmrx(FPEXC) & ~FPEXC_EN);
+	put_cpu();
+}
+EXPORT_SYMBOL(kernel_neon_end);
+#endif
+
 static void vfp_enable(void *unused)
 {
 	u32 access = get_copro_access();
@@ -371,6 +408,21 @@ static int __init vfp_init(void)
 		 * in place; report VFP support to userspace.
 		 */
 		elf_hwcap |= HWCAP_VFP;
+
+		if (VFP_arch >= 2) {
+			elf_hwcap |= HWCAP_VFPv3;
+#ifdef CONFIG_NEON
+			/*
+			 * NEON needs the Advanced SIMD load/store, integer
+			 * and single precision parts (MVFR1), which are
+			 * only readable when the CPUID has the new format.
+			 */
+			if ((read_cpuid_id() & 0x000f0000) == 0x000f0000 &&
+			    (fmrx(MVFR1) & 0x000fff00) == 0x00011100) {
+				elf_hwcap |= HWCAP_NEON;
+			}
+#endif
+		}
 	}
 	return 0;
 }
@@ -0,0 +1,542 @@
+/*
+ *  Flash i/o scheduler.
+ *
+ *  For devices without seek times, such as eMMC, SD cards and mtdblock:
+ *  requests are kept in submission order per i/o priority class and data
+ *  direction, the highest class goes first and reads go before writes.
+ *  There is no anticipation and no sorting, neither pays off on flash.
+ *  Deadlines keep writes and the lower classes from starving.
+ *
+ *  Derived from the deadline scheduler,
+ *  Copyright (C) 2002 Jens Axboe <axboe@kernel.dk>
+ */
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/blkdev.h>
+#include <linux/elevator.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/init.h>
+#include <linux/compiler.h>
+#include <linux/rbtree.h>
+#include <linux/ioprio.h>
+#include <linux/iocontext.h>
+#include <linux/sched.h>
+
+/*
+ * See Documentation/block/flash-iosched.txt
+ */
+static const int read_expire = HZ / 4;	/* max time before a read is submitted. */
+static const int write_expire = 2 * HZ;	/* ditto for writes, these limits are SOFT! */
+static const int idle_expire = 5 * HZ;	/* ditto for the idle class, either way */
+static const int writes_starved = 2;	/* max times reads can starve a write */
+static const int idle_grace = HZ / 20;	/* quiet time before the idle class runs */
+
+/* queues are indexed by class, in the order they are served */
+enum {
+	FLASH_RT,
+	FLASH_BE,
+	FLASH_IDLE,
+	FLASH_CLASSES
+};
+
+static const char *flash_class_names[FLASH_CLASSES] = { "rt", "be", "idle" };
+
+#define RQ_CLASS(rq)		((unsigned long) (rq)->elevator_private)
+#define RQ_SET_CLASS(rq, c)	((rq)->elevator_private = (void *) (unsigned long) (c))
+
+struct flash_data {
+	struct request_queue *q;
+
+	/*
+	 * requests are on one fifo_list, and on the sort_list of their
+	 * class and direction: merges, back and front, look for their
+	 * neighbours there, so they never cross classes
+	 */
+	struct list_head fifo_list[FLASH_CLASSES][2];
+	struct rb_root sort_list[FLASH_CLASSES][2];
+
+	unsigned int starved;		/* times reads have starved writes */
+	int served_expired;		/* last request was dispatched late */
+	unsigned long last_busy;	/* last rt or be activity, in jiffies */
+
+	/* the idle class waits for idle_grace without rt or be activity */
+	struct timer_list idle_timer;
+	struct work_struct unplug_work;
+
+	/* requests dispatched, and how many of those had expired */
+	unsigned long dispatched[FLASH_CLASSES][2];
+	unsigned long expired[FLASH_CLASSES][2];
+
+	/*
+	 * settings that change how the i/o scheduler behaves
+	 */
+	int fifo_expire[2];
+	int idle_expire;
+	int writes_starved;
+	int idle_grace;
+	int front_merges;
+};
+
+#define RQ_RB_ROOT(fd, rq)	\
+	(&(fd)->sort_list[RQ_CLASS((rq))][rq_data_dir((rq))])
+
+/*
+ * The class the submitting task asked for with ioprio_set(), or the one
+ * its scheduling policy implies.  A priority carried by the bio wins.
+ */
+static int flash_task_class(struct request *rq)
+{
+	int ioprio = rq ? rq->ioprio : 0;
+	struct io_context *ioc = current->io_context;
+
+	if (!ioprio_valid(ioprio) && ioc)
+		ioprio = ioc->ioprio;
+
+	switch (ioprio_valid(ioprio) ? IOPRIO_PRIO_CLASS(ioprio) :
+				      task_nice_ioclass(current)) {
+	case IOPRIO_CLASS_RT:
+		return FLASH_RT;
+	case IOPRIO_CLASS_IDLE:
+		return FLASH_IDLE;
+	default:
+		return FLASH_BE;
+	}
+}
+
+static void
+flash_add_rq_rb(struct flash_data *fd, struct request *rq)
+{
+	struct rb_root *root = RQ_RB_ROOT(fd, rq);
+	struct request *__alias;
+
+retry:
+	__alias = elv_rb_add(root, rq);
+	if (unlikely(__alias)) {
+		/* same start sector: send the one queued first on its way */
+		rq_fifo_clear(__alias);
+		elv_rb_del(root, __alias);
+		elv_dispatch_add_tail(fd->q, __alias);
+		goto retry;
+	}
+}
+
+/*
+ * add rq to rbtree and the fifo of its class
+ */
+static void
+flash_add_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	const int data_dir = rq_data_dir(rq);
+	const int class = flash_task_class(rq);
+
+	RQ_SET_CLASS(rq, class);
+	if (class != FLASH_IDLE)
+		fd->last_busy = jiffies;
+
+	flash_add_rq_rb(fd, rq);
+
+	rq_set_fifo_time(rq, jiffies + (class == FLASH_IDLE ?
+				fd->idle_expire : fd->fifo_expire[data_dir]));
+	list_add_tail(&rq->queuelist, &fd->fifo_list[class][data_dir]);
+}
+
+/*
+ * remove rq from rbtree and fifo.
+ */
+static void flash_remove_request(struct request_queue *q, struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	rq_fifo_clear(rq);
+	elv_rb_del(RQ_RB_ROOT(fd, rq), rq);
+}
+
+static int
+flash_merge(struct request_queue *q, struct request **req, struct bio *bio)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *__rq;
+
+	/*
+	 * check for front merge
+	 */
+	if (fd->front_merges) {
+		sector_t sector = bio->bi_sector + bio_sectors(bio);
+
+		__rq = elv_rb_find(&fd->sort_list[flash_task_class(NULL)]
+						[bio_data_dir(bio)], sector);
+		if (__rq) {
+			BUG_ON(sector != __rq->sector);
+
+			if (elv_rq_merge_ok(__rq, bio)) {
+				*req = __rq;
+				return ELEVATOR_FRONT_MERGE;
+			}
+		}
+	}
+
+	return ELEVATOR_NO_MERGE;
+}
+
+static void flash_merged_request(struct request_queue *q,
+				 struct request *req, int type)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	/*
+	 * if the merge was a front merge, we need to reposition request
+	 */
+	if (type == ELEVATOR_FRONT_MERGE) {
+		elv_rb_del(RQ_RB_ROOT(fd, req), req);
+		flash_add_rq_rb(fd, req);
+	}
+}
+
+static void
+flash_merged_requests(struct request_queue *q, struct request *req,
+		      struct request *next)
+{
+	/*
+	 * if next expires before rq, assign its expire time to rq
+	 * and move into next position (next will be deleted) in fifo
+	 */
+	if (!list_empty(&req->queuelist) && !list_empty(&next->queuelist)) {
+		if (time_before(rq_fifo_time(next), rq_fifo_time(req))) {
+			list_move(&req->queuelist, &next->queuelist);
+			rq_set_fifo_time(req, rq_fifo_time(next));
+		}
+	}
+
+	/*
+	 * kill knowledge of next, this one is a goner
+	 */
+	flash_remove_request(q, next);
+}
+
+/*
+ * Don't let a bio join a request of another class: an idle class write
+ * would otherwise ride along in the best effort queue, or the other way.
+ */
+static int flash_allow_merge(struct request_queue *q, struct request *rq,
+			     struct bio *bio)
+{
+	return RQ_CLASS(rq) == flash_task_class(NULL);
+}
+
+static void flash_completed_request(struct request_queue *q,
+				    struct request *rq)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+
+	if (RQ_CLASS(rq) != FLASH_IDLE)
+		fd->last_busy = jiffies;
+}
+
+/*
+ * The oldest expired request of any class, or NULL
+ */
+static struct request *flash_expired_request(struct flash_data *fd)
+{
+	struct request *rq, *oldest = NULL;
+	int class, dir;
+
+	for (class = 0; class < FLASH_CLASSES; class++) {
+		for (dir = READ; dir <= WRITE; dir++) {
+			if (list_empty(&fd->fifo_list[class][dir]))
+				continue;
+			rq = rq_entry_fifo(fd->fifo_list[class][dir].next);
+			if (!time_after(jiffies, rq_fifo_time(rq)))
+				continue;
+			if (!oldest ||
+			    time_before(rq_fifo_time(rq), rq_fifo_time(oldest)))
+				oldest = rq;
+		}
+	}
+	return oldest;
+}
+
+static inline int flash_class_empty(struct flash_data *fd, int class)
+{
+	return list_empty(&fd->fifo_list[class][READ]) &&
+		list_empty(&fd->fifo_list[class][WRITE]);
+}
+
+/*
+ * flash_dispatch_requests selects the best request according to class,
+ * direction and expiry
+ */
+static int flash_dispatch_requests(struct request_queue *q, int force)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	struct request *rq;
+	int class, data_dir;
+	int reads, writes;
+
+	/*
+	 * An expired request goes first, but every other one at most, so
+	 * a backlog of them can't stall the higher classes in turn.
+	 */
+	rq = NULL;
+	if (!fd->served_expired)
+		rq = flash_expired_request(fd);
+	if (rq) {
+		class = RQ_CLASS(rq);
+		data_dir = rq_data_dir(rq);
+		fd->expired[class][data_dir]++;
+		fd->served_expired = 1;
+		goto dispatch_request;
+	}
+	fd->served_expired = 0;
+
+	for (class = 0; class < FLASH_CLASSES; class++)
+		if (!flash_class_empty(fd, class))
+			break;
+	if (class == FLASH_CLASSES)
+		return 0;
+
+	/*
+	 * the idle class only runs once nothing else has been going on for
+	 * a while, or it would get in the way of every other sync request
+	 */
+	if (class == FLASH_IDLE && !force &&
+	    time_before(jiffies, fd->last_busy + fd->idle_grace)) {
+		mod_timer(&fd->idle_timer, fd->last_busy + fd->idle_grace);
+		return 0;
+	}
+
+	reads = !list_empty(&fd->fifo_list[class][READ]);
+	writes = !list_empty(&fd->fifo_list[class][WRITE]);
+
+	if (reads && !(writes && fd->starved++ >= fd->writes_starved)) {
+		data_dir = READ;
+	} else {
+		/*
+		 * there are either no reads or writes have been starved
+		 */
+		fd->starved = 0;
+		data_dir = WRITE;
+	}
+	rq = rq_entry_fifo(fd->fifo_list[class][data_dir].next);
+
+dispatch_request:
+	if (class != FLASH_IDLE)
+		fd->last_busy = jiffies;
+	fd->dispatched[class][data_dir]++;
+
+	flash_remove_request(q, rq);
+	elv_dispatch_add_tail(q, rq);
+	return 1;
+}
+
+static int flash_queue_empty(struct request_queue *q)
+{
+	struct flash_data *fd = q->elevator->elevator_data;
+	int class;
+
+	for (class = 0; class < FLASH_CLASSES; class++)
+		if (!flash_class_empty(fd, class))
+			return 0;
+	return 1;
+}
+
+/*
+ * The idle class waited out its grace time: run the queue again, from
+ * kblockd since the driver's request_fn may not be called from a timer.
+ */
+static void flash_idle_timeout(unsigned long data)
+{
+	struct flash_data *fd = (struct flash_data *) data;
+
+	kblockd_schedule_work(&fd->unplug_work);
+}
+
+static void flash_work_handler(struct work_struct *work)
+{
+	struct flash_data *fd = container_of(work, struct flash_data,
+					     unplug_work);
+	struct request_queue *q = fd->q;
+	unsigned long flags;
+
+	spin_lock_irqsave(q->queue_lock, flags);
+	blk_start_queueing(q);
+	spin_unlock_irqrestore(q->queue_lock, flags);
+}
+
+static void flash_exit_queue(elevator_t *e)
+{
+	struct flash_data *fd = e->elevator_data;
+
+	del_timer_sync(&fd->idle_timer);
+	kblockd_flush_work(&fd->unplug_work);
+
+	BUG_ON(!flash_queue_empty(fd->q));
+
+	kfree(fd);
+}
+
+/*
+ * initialize elevator private data (flash_data).
+ */
+static void *flash_init_queue(struct request_queue *q)
+{
+	struct flash_data *fd;
+	int class;
+
+	fd = kmalloc_node(sizeof(*fd), GFP_KERNEL | __GFP_ZERO, q->node);
+	if (!fd)
+		return NULL;
+
+	fd->q = q;
+	for (class = 0; class < FLASH_CLASSES; class++) {
+		INIT_LIST_HEAD(&fd->fifo_list[class][READ]);
+		INIT_LIST_HEAD(&fd->fifo_list[class][WRITE]);
+		fd->sort_list[class][READ] = RB_ROOT;
+		fd->sort_list[class][WRITE] = RB_ROOT;
+	}
+	setup_timer(&fd->idle_timer, flash_idle_timeout, (unsigned long) fd);
+	INIT_WORK(&fd->unplug_work, flash_work_handler);
+	fd->last_busy = jiffies;
+
+	fd->fifo_expire[READ] = read_expire;
+	fd->fifo_expire[WRITE] = write_expire;
+	fd->idle_expire = idle_expire;
+	fd->writes_starved = writes_starved;
+	fd->idle_grace = idle_grace;
+	fd->front_merges = 1;
+	return fd;
+}
+
+/*
+ * sysfs parts below
+ */
+
+static ssize_t
+flash_var_show(int var, char *page)
+{
+	return sprintf(page, "%d\n", var);
+}
+
+static ssize_t
+flash_var_store(int *var, const char *page, size_t count)
+{
+	char *p = (char *) page;
+
+	*var = simple_strtol(p, &p, 10);
+	return count;
+}
+
+#define SHOW_FUNCTION(__FUNC, __VAR, __CONV)				\
+static ssize_t __FUNC(elevator_t *e, char *page)			\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data = __VAR;						\
+	if (__CONV)							\
+		__data = jiffies_to_msecs(__data);			\
+	return flash_var_show(__data, (page));				\
+}
+SHOW_FUNCTION(flash_read_expire_show, fd->fifo_expire[READ], 1);
+SHOW_FUNCTION(flash_write_expire_show, fd->fifo_expire[WRITE], 1);
+SHOW_FUNCTION(flash_idle_expire_show, fd->idle_expire, 1);
+SHOW_FUNCTION(flash_writes_starved_show, fd->writes_starved, 0);
+SHOW_FUNCTION(flash_idle_grace_show, fd->idle_grace, 1);
+SHOW_FUNCTION(flash_front_merges_show, fd->front_merges, 0);
+#undef SHOW_FUNCTION
+
+#define STORE_FUNCTION(__FUNC, __PTR, MIN, MAX, __CONV)			\
+static ssize_t __FUNC(elevator_t *e, const char *page, size_t count)	\
+{									\
+	struct flash_data *fd = e->elevator_data;			\
+	int __data;							\
+	int ret = flash_var_store(&__data, (page), count);		\
+	if (__data < (MIN))						\
+		__data = (MIN);						\
+	else if (__data > (MAX))					\
+		__data = (MAX);						\
+	if (__CONV)							\
+		*(__PTR) = msecs_to_jiffies(__data);			\
+	else								\
+		*(__PTR) = __data;					\
+	return ret;							\
+}
+STORE_FUNCTION(flash_read_expire_store, &fd->fifo_expire[READ], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_write_expire_store, &fd->fifo_expire[WRITE], 0, INT_MAX, 1);
+STORE_FUNCTION(flash_idle_expire_store, &fd->idle_expire, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_writes_starved_store, &fd->writes_starved, INT_MIN, INT_MAX, 0);
+STORE_FUNCTION(flash_idle_grace_store, &fd->idle_grace, 0, INT_MAX, 1);
+STORE_FUNCTION(flash_front_merges_store, &fd->front_merges, 0, 1, 0);
+#undef STORE_FUNCTION
+
+/* requests dispatched per class and direction, and how many late */
+static ssize_t flash_stats_show(elevator_t *e, char *page)
+{
+	struct flash_data *fd = e->elevator_data;
+	char *p = page;
+	int class;
+
+	p += sprintf(p, "class     reads    late    writes    late\n");
+	for (class = 0; class < FLASH_CLASSES; class++)
+		p += sprintf(p, "%-5s %9lu %7lu %9lu %7lu\n",
+			     flash_class_names[class],
+			     fd->dispatched[class][READ],
+			     fd->expired[class][READ],
+			     fd->dispatched[class][WRITE],
+			     fd->expired[class][WRITE]);
+	return p - page;
+}
+
+#define FD_ATTR(name) \
+	__ATTR(name, S_IRUGO|S_IWUSR, flash_##name##_show, \
+				      flash_##name##_store)
+
+static struct elv_fs_entry flash_attrs[] = {
+	FD_ATTR(read_expire),
+	FD_ATTR(write_expire),
+	FD_ATTR(idle_expire),
+	FD_ATTR(writes_starved),
+	FD_ATTR(idle_grace),
+	FD_ATTR(front_merges),
+	__ATTR(stats, S_IRUGO, flash_stats_show, NULL),
+	__ATTR_NULL
+};
+
+static struct elevator_type iosched_flash = {
+	.ops = {
+		.elevator_merge_fn = 		flash_merge,
+		.elevator_merged_fn =		flash_merged_request,
+		.elevator_merge_req_fn =	flash_merged_requests,
+		.elevator_allow_merge_fn =	flash_allow_merge,
+		.elevator_dispatch_fn =		flash_dispatch_requests,
+		.elevator_add_req_fn =		flash_add_request,
+		.elevator_completed_req_fn =	flash_completed_request,
+		.elevator_queue_empty_fn =	flash_queue_empty,
+		.elevator_former_req_fn =	elv_rb_former_request,
+		.elevator_latter_req_fn =	elv_rb_latter_request,
+		.elevator_init_fn =		flash_init_queue,
+		.elevator_exit_fn =		flash_exit_queue,
+	},
+
+	.elevator_attrs = flash_attrs,
+	.elevator_name = "flash",
+	.elevator_owner = THIS_MODULE,
+};
+
+static int __init flash_init(void)
+{
+	elv_register(&iosched_flash);
+
+	return 0;
+}
+
+static void __exit flash_exit(void)
+{
+	elv_unregister(&iosched_flash);
+}
+
+module_init(flash_init);
+module_exit(flash_exit);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("flash IO scheduler");
@@ -997,7 +997,7 @@ static const struct {
 #ifdef CONFIG_CRASH_DUMP
 	{12,"oldmem",    S_IRUSR | S_IWUSR | S_IRGRP, &oldmem_fops},
 #endif
-	{13, "mem_notify", S_IRUGO, &mem_notify_fops},
+	{13, "mem_notify", S_IRUGO | S_IWUGO, &mem_notify_fops},
 };
 
 static struct class *mem_class;
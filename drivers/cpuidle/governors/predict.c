@@ -0,0 +1,234 @@
+/*
+ * predict.c - the predict idle governor
+ *
+ * Picks the idle state from a prediction of how long the cpu will really
+ * stay idle, rather than from the next timer alone.  Interrupts wake the
+ * cpu long before its next timer often enough that entering the deepest
+ * state the timer allows wastes the cost of entering and leaving it.
+ *
+ * Two things are remembered per cpu:
+ *
+ *  - the last PREDICT_HISTORY idle periods.  If they agree with each other,
+ *    once the odd outliers are dropped, their average is the prediction;
+ *    otherwise the next timer is.
+ *
+ *  - for each state, how often recently an idle period was too short for
+ *    that state to pay off (its target residency).  A state that would
+ *    have lost more often than not is not entered, whatever the
+ *    prediction says.
+ *
+ * Documentation/cpuidle/predict-replay.c runs the same algorithm on
+ * recorded idle periods.
+ *
+ * This code is licenced under the GPL.
+ */
+
+#include <linux/kernel.h>
+#include <linux/cpuidle.h>
+#include <linux/pm_qos_params.h>
+#include <linux/time.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/tick.h>
+#include <asm/div64.h>
+
+#define PREDICT_HISTORY		8
+/* Idle periods are clamped to this, which keeps the variance in 64 bits */
+#define PREDICT_MAX_US		USEC_PER_SEC
+/* Early wakeup ratios are fixed point, out of PREDICT_ONE */
+#define PREDICT_ONE		1024
+#define PREDICT_EARLY_LIMIT	(PREDICT_ONE / 2)
+/* Each new idle period has a weight of 1 / (1 << PREDICT_DECAY_SHIFT) */
+#define PREDICT_DECAY_SHIFT	3
+
+struct predict_device {
+	unsigned int	next_timer_us;
+	unsigned int	predicted_us;
+
+	unsigned int	intervals[PREDICT_HISTORY];
+	int		interval_ptr;
+
+	/* how often each state recently woke up before it paid off */
+	unsigned int	early[CPUIDLE_STATE_MAX];
+};
+
+static DEFINE_PER_CPU(struct predict_device, predict_devices);
+
+/*
+ * Average of the recent idle periods, if they are consistent: either the
+ * standard deviation is small against the average, or it is small in
+ * absolute terms.  If not, the longest period is dropped as an outlier and
+ * the rest tried again, as long as at least three quarters of the history
+ * is left.  Returns UINT_MAX when there is no usable pattern.
+ */
+static unsigned int predict_typical_interval(struct predict_device *data)
+{
+	unsigned int thresh = UINT_MAX;
+	unsigned int max, avg;
+	u64 sum, variance;
+	int i, divisor;
+
+again:
+	max = 0;
+	sum = 0;
+	divisor = 0;
+	for (i = 0; i < PREDICT_HISTORY; i++) {
+		unsigned int value = data->intervals[i];
+
+		if (value <= thresh) {
+			sum += value;
+			divisor++;
+			if (value > max)
+				max = value;
+		}
+	}
+	do_div(sum, divisor);
+	avg = sum;
+
+	variance = 0;
+	for (i = 0; i < PREDICT_HISTORY; i++) {
+		unsigned int value = data->intervals[i];
+		s64 diff;
+
+		if (value <= thresh) {
+			diff = (s64)value - avg;
+			variance += diff * diff;
+		}
+	}
+	do_div(variance, divisor);
+
+	/* stddev <= avg / 6, or stddev <= 20us */
+	if (((u64)avg * avg > variance * 36 &&
+	     divisor * 4 >= PREDICT_HISTORY * 3) || variance <= 400)
+		return avg;
+
+	if (divisor * 4 <= PREDICT_HISTORY * 3)
+		return UINT_MAX;
+
+	thresh = max - 1;
+	goto again;
+}
+
+/**
+ * predict_select - selects the next idle state to enter
+ * @dev: the CPU
+ */
+static int predict_select(struct cpuidle_device *dev)
+{
+	struct predict_device *data = &__get_cpu_var(predict_devices);
+	int latency_req = pm_qos_requirement(PM_QOS_CPU_DMA_LATENCY);
+	u64 next_timer_ns;
+	int i;
+
+	/* Special case when user has set very strict latency requirement */
+	if (unlikely(latency_req == 0))
+		return 0;
+
+	next_timer_ns = ktime_to_ns(tick_nohz_get_sleep_length());
+	do_div(next_timer_ns, NSEC_PER_USEC);
+	data->next_timer_us = min_t(u64, next_timer_ns, UINT_MAX);
+
+	data->predicted_us = min(data->next_timer_us,
+				 predict_typical_interval(data));
+
+	/* find the deepest idle state that satisfies our constraints */
+	for (i = CPUIDLE_DRIVER_STATE_START + 1; i < dev->state_count; i++) {
+		struct cpuidle_state *s = &dev->states[i];
+
+		if (s->target_residency > data->predicted_us)
+			break;
+		if (s->exit_latency > latency_req)
+			break;
+		if (data->early[i] > PREDICT_EARLY_LIMIT)
+			break;
+	}
+
+	return i - 1;
+}
+
+/**
+ * predict_reflect - records how long the cpu actually stayed idle
+ * @dev: the CPU
+ *
+ * Every state's early wakeup ratio is updated, not just the one of the
+ * state that was entered: what matters is whether the period would have
+ * been long enough for it.  This also lets a state that stopped being
+ * entered because of its ratio come back once the wakeups space out.
+ */
+static void predict_reflect(struct cpuidle_device *dev)
+{
+	struct predict_device *data = &__get_cpu_var(predict_devices);
+	struct cpuidle_state *target = dev->last_state;
+	unsigned int measured_us;
+	int i;
+
+	/*
+	 * Without a residency measurement all we can assume is that the
+	 * cpu slept until its next timer.
+	 */
+	if (target && (target->flags & CPUIDLE_FLAG_TIME_VALID))
+		measured_us = cpuidle_get_last_residency(dev);
+	else
+		measured_us = data->next_timer_us;
+	measured_us = min_t(unsigned int, measured_us, PREDICT_MAX_US);
+
+	data->intervals[data->interval_ptr++] = measured_us;
+	if (data->interval_ptr >= PREDICT_HISTORY)
+		data->interval_ptr = 0;
+
+	for (i = 0; i < dev->state_count; i++) {
+		unsigned int early = data->early[i];
+
+		early -= early >> PREDICT_DECAY_SHIFT;
+		if (measured_us < dev->states[i].target_residency)
+			early += PREDICT_ONE >> PREDICT_DECAY_SHIFT;
+		data->early[i] = early;
+	}
+}
+
+/**
+ * predict_enable_device - scans a CPU's states and does setup
+ * @dev: the CPU
+ */
+static int predict_enable_device(struct cpuidle_device *dev)
+{
+	struct predict_device *data = &per_cpu(predict_devices, dev->cpu);
+	int i;
+
+	memset(data, 0, sizeof(struct predict_device));
+
+	/* Start out trusting the timer: no pattern, no early wakeups */
+	for (i = 0; i < PREDICT_HISTORY; i++)
+		data->intervals[i] = PREDICT_MAX_US;
+
+	return 0;
+}
+
+static struct cpuidle_governor predict_governor = {
+	.name =		"predict",
+	.rating =	30,
+	.enable =	predict_enable_device,
+	.select =	predict_select,
+	.reflect =	predict_reflect,
+	.owner =	THIS_MODULE,
+};
+
+/**
+ * init_predict - initializes the governor
+ */
+static int __init init_predict(void)
+{
+	return cpuidle_register_governor(&predict_governor);
+}
+
+/**
+ * exit_predict - exits the governor
+ */
+static void __exit exit_predict(void)
+{
+	cpuidle_unregister_governor(&predict_governor);
+}
+
+MODULE_LICENSE("GPL");
+module_init(init_predict);
+module_exit(exit_predict);
@@ -157,6 +157,7 @@ static int __init gpio_event_probe(struct platform_device *pdev)
 	if (event_info->power) {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 		ip->early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
+		ip->early_suspend.async = 1;
 		ip->early_suspend.suspend = gpio_event_suspend;
 		ip->early_suspend.resume = gpio_event_resume;
 		register_early_suspend(&ip->early_suspend);
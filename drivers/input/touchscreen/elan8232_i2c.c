@@ -672,6 +672,7 @@ static int ekt8232_probe(
 		ekt8232_ts_interrupt(client->irq, NULL);
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	ekt_data.early_suspend.level = EARLY_SUSPEND_LEVEL_BLANK_SCREEN + 1;
+	ekt_data.early_suspend.async = 1;
 	ekt_data.early_suspend.suspend = elan_ts_early_suspend;
 	ekt_data.early_suspend.resume = elan_ts_late_resume;
 	register_early_suspend(&ekt_data.early_suspend);
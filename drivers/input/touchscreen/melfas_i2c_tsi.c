@@ -418,7 +418,7 @@ static void __exit melfas_ts_exit(void)
 	if (melfas_wq)
 		destroy_workqueue(melfas_wq);
 }
-module_init(melfas_ts_init);
+module_init_async(melfas_ts_init);
 module_exit(melfas_ts_exit);
 
 MODULE_DESCRIPTION("Melfas Touchscreen Driver");
@@ -30,6 +30,7 @@
 #include <linux/proc_fs.h>
 #include <linux/rbtree.h>
 #include <linux/sched.h>
+#include <linux/security.h>
 #include <linux/uaccess.h>
 #include <linux/vmalloc.h>
 
@@ -236,6 +237,15 @@ struct binder_buffer {
 	uint8_t data[0];
 };
 
+/*
+ * A scheduling policy and its priority: the rt_priority for SCHED_FIFO and
+ * SCHED_RR, the nice value for the others.
+ */
+struct binder_priority {
+	unsigned int sched_policy;
+	int prio;
+};
+
 struct binder_proc {
 	struct hlist_node proc_node;
 	struct rb_root threads;
@@ -264,7 +274,7 @@ struct binder_proc {
 	int requested_threads;
 	int requested_threads_started;
 	int ready_threads;
-	long default_priority;
+	struct binder_priority default_priority;
 };
 
 enum {
@@ -305,8 +315,8 @@ struct binder_transaction {
 	struct binder_buffer *buffer;
 	unsigned int	code;
 	unsigned int	flags;
-	long	priority;
-	long	saved_priority;
+	struct binder_priority	priority;
+	struct binder_priority	saved_priority;
 	uid_t	sender_euid;
 };
 
@@ -452,6 +462,59 @@ out_unlock:
 	return -EBADF;
 }
 
+static inline int binder_is_rt_policy(unsigned int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static struct binder_priority binder_task_priority(struct task_struct *task)
+{
+	struct binder_priority p;
+
+	p.sched_policy = task->policy;
+	if (binder_is_rt_policy(p.sched_policy))
+		p.prio = task->rt_priority;
+	else
+		p.prio = task_nice(task);
+	return p;
+}
+
+/* The minimum priority of a node is a nice value for SCHED_NORMAL */
+static struct binder_priority binder_node_priority(struct binder_node *node)
+{
+	struct binder_priority p;
+
+	p.sched_policy = SCHED_NORMAL;
+	p.prio = clamp_t(int, node->min_priority, -20, 19);
+	return p;
+}
+
+/*
+ * Orders priorities across policies, lowest first: real-time by
+ * rt_priority, then SCHED_ISO, SCHED_NORMAL and SCHED_BATCH, and
+ * SCHED_IDLEPRIO, each of those by nice value.
+ */
+static int binder_priority_rank(struct binder_priority p)
+{
+	switch (p.sched_policy) {
+	case SCHED_FIFO:
+	case SCHED_RR:
+		return MAX_RT_PRIO - 1 - p.prio;
+	case SCHED_ISO:
+		return MAX_RT_PRIO + 20 + p.prio;
+	case SCHED_IDLEPRIO:
+		return MAX_RT_PRIO + 2 * PRIO_RANGE + 20 + p.prio;
+	default:
+		return MAX_RT_PRIO + PRIO_RANGE + 20 + p.prio;
+	}
+}
+
+static inline int binder_priority_above(struct binder_priority a,
+					struct binder_priority b)
+{
+	return binder_priority_rank(a) < binder_priority_rank(b);
+}
+
 static void binder_set_nice(long nice)
 {
 	long min_nice;
@@ -469,6 +532,56 @@ static void binder_set_nice(long nice)
 	binder_user_error("binder: %d RLIMIT_NICE not set\n", current->pid);
 }
 
+/*
+ * Move the current thread to 'desired'.  When it is inherited from another
+ * thread ('verify' set), the limits of this one still apply: a real-time
+ * priority is capped by RLIMIT_RTPRIO, and without any becomes SCHED_ISO,
+ * as BFS does for sched_setscheduler(); a nice value is capped by
+ * RLIMIT_NICE.  Restoring a priority the thread had before needs no checks.
+ */
+static void binder_set_priority(struct binder_priority desired, int verify)
+{
+	struct task_struct *task = current;
+	struct sched_param param = { .sched_priority = 0 };
+	unsigned int policy = desired.sched_policy;
+
+	if (binder_is_rt_policy(policy)) {
+		param.sched_priority = desired.prio;
+		if (verify && !has_capability(task, CAP_SYS_NICE)) {
+			unsigned long rlim_rtprio =
+				task->signal->rlim[RLIMIT_RTPRIO].rlim_cur;
+
+			if (!rlim_rtprio) {
+				policy = SCHED_ISO;
+				param.sched_priority = 0;
+			} else if (param.sched_priority > rlim_rtprio)
+				param.sched_priority = rlim_rtprio;
+			if ((binder_debug_mask & BINDER_DEBUG_PRIORITY_CAP) &&
+			    param.sched_priority != desired.prio)
+				printk(KERN_INFO "binder: %d: rt priority %d not "
+				       "allowed, use policy %u priority %d "
+				       "instead\n", task->pid, desired.prio,
+				       policy, param.sched_priority);
+		}
+	}
+
+	if (task->policy != policy ||
+	    (binder_is_rt_policy(policy) &&
+	     task->rt_priority != param.sched_priority)) {
+		if (sched_setscheduler_nocheck(task, policy, &param))
+			binder_user_error("binder: %d: failed to set policy "
+					  "%u priority %d\n", task->pid,
+					  policy, param.sched_priority);
+	}
+
+	if (binder_is_rt_policy(desired.sched_policy))
+		return;
+	if (verify)
+		binder_set_nice(desired.prio);
+	else
+		set_user_nice(task, desired.prio);
+}
+
 static size_t binder_buffer_size(
 	struct binder_proc *proc, struct binder_buffer *buffer)
 {
@@ -1283,7 +1396,7 @@ binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_set_priority(in_reply_to->saved_priority, 0);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("binder: %d:%d got reply transaction "
 				"with bad transaction stack,"
@@ -1406,7 +1519,7 @@ binder_transaction(struct binder_proc *proc, struct binder_thread *thread,
 	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
-	t->priority = task_nice(current);
+	t->priority = binder_task_priority(current);
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
 	if (t->buffer == NULL) {
@@ -2153,7 +2266,7 @@ retry:
 				proc->pid, thread->pid, thread->looper);
 			wait_event_interruptible(binder_user_error_wait, binder_stop_on_user_error < 2);
 		}
-		binder_set_nice(proc->default_priority);
+		binder_set_priority(proc->default_priority, 0);
 		if (non_block) {
 			if (!binder_has_proc_work(proc, thread))
 				ret = -EAGAIN;
@@ -2310,15 +2423,24 @@ retry:
 		BUG_ON(t->buffer == NULL);
 		if (t->buffer->target_node) {
 			struct binder_node *target_node = t->buffer->target_node;
+			struct binder_priority node_prio;
+
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
-			t->saved_priority = task_nice(current);
-			if (t->priority < target_node->min_priority &&
+			node_prio = binder_node_priority(target_node);
+			/*
+			 * A synchronous caller lends this thread its policy
+			 * and priority, real-time included, until the reply
+			 * restores the saved one.
+			 */
+			t->saved_priority = binder_task_priority(current);
+			if (binder_priority_above(t->priority, node_prio) &&
 			    !(t->flags & TF_ONE_WAY))
-				binder_set_nice(t->priority);
+				binder_set_priority(t->priority, 1);
 			else if (!(t->flags & TF_ONE_WAY) ||
-				 t->saved_priority > target_node->min_priority)
-				binder_set_nice(target_node->min_priority);
+				 binder_priority_above(node_prio,
+						       t->saved_priority))
+				binder_set_priority(node_prio, 1);
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = NULL;
@@ -2753,7 +2875,7 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
 	init_waitqueue_head(&proc->wait);
-	proc->default_priority = task_nice(current);
+	proc->default_priority = binder_task_priority(current);
 	mutex_lock(&binder_lock);
 	binder_stats.obj_created[BINDER_STAT_PROC]++;
 	hlist_add_head(&proc->proc_node, &binder_procs);
@@ -2911,12 +3033,13 @@ static int binder_release(struct inode *nodp, struct file *filp)
 
 static char *print_binder_transaction(char *buf, char *end, const char *prefix, struct binder_transaction *t)
 {
-	buf += snprintf(buf, end - buf, "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %ld r%d",
+	buf += snprintf(buf, end - buf, "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %u:%d r%d",
 			prefix, t->debug_id, t, t->from ? t->from->proc->pid : 0,
 			t->from ? t->from->pid : 0,
 			t->to_proc ? t->to_proc->pid : 0,
 			t->to_thread ? t->to_thread->pid : 0,
-			t->code, t->flags, t->priority, t->need_reply);
+			t->code, t->flags, t->priority.sched_policy,
+			t->priority.prio, t->need_reply);
 	if (buf >= end)
 		return buf;
 	if (t->buffer == NULL) {
@@ -73,6 +73,9 @@ struct pmem_data {
 	struct list_head region_list;
 	/* a linked list of data so we can access them for debugging */
 	struct list_head list;
+	/* bytes cleaned, invalidated and flushed for this client, indexed by
+	 * PMEM_CACHE_* - 1 */
+	atomic_long_t cache_bytes[PMEM_CACHE_NR_OPS];
 #if PMEM_DEBUG
 	int ref;
 #endif
@@ -331,6 +334,7 @@ static int pmem_open(struct inode *inode, struct file *file)
 	struct pmem_data *data;
 	int id = get_id(file);
 	int ret = 0;
+	int i;
 
 	DLOG("current %u file %p(%d)\n", current->pid, file, file_count(file));
 	/* setup file->private_data to indicate its unmapped */
@@ -348,6 +352,8 @@ static int pmem_open(struct inode *inode, struct file *file)
 	data->vma = NULL;
 	data->pid = 0;
 	data->master_file = NULL;
+	for (i = 0; i < PMEM_CACHE_NR_OPS; i++)
+		atomic_long_set(&data->cache_bytes[i], 0);
 #if PMEM_DEBUG
 	data->ref = 0;
 #endif
@@ -814,14 +820,41 @@ void flush_pmem_fd(int fd, unsigned long offset, unsigned long len)
 	fput_light(file, fput_needed);
 }
 
+/*
+ * Clean, invalidate or flush (PMEM_CACHE_*) 'len' bytes at 'offset' in the
+ * allocation of 'data', and account them to it.  The outer cache is
+ * indexed by physical address, which pmem knows without going through the
+ * ioremapped alias.
+ */
+static void pmem_cache_range(int id, struct pmem_data *data, unsigned int op,
+			     unsigned long offset, unsigned long len)
+{
+	void *vaddr = pmem_start_vaddr(id, data) + offset;
+	unsigned long paddr = pmem_start_addr(id, data) + offset;
+
+	switch (op) {
+	case PMEM_CACHE_CLEAN:
+		dmac_clean_range(vaddr, vaddr + len);
+		outer_clean_range(paddr, paddr + len);
+		break;
+	case PMEM_CACHE_INV:
+		dmac_inv_range(vaddr, vaddr + len);
+		outer_inv_range(paddr, paddr + len);
+		break;
+	case PMEM_CACHE_FLUSH:
+		dmac_flush_range(vaddr, vaddr + len);
+		outer_flush_range(paddr, paddr + len);
+		break;
+	}
+	atomic_long_add(len, &data->cache_bytes[op - 1]);
+}
+
 void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 {
 	struct pmem_data *data;
 	int id;
-	void *vaddr;
 	struct pmem_region_node *region_node;
 	struct list_head *elt;
-	void *flush_start, *flush_end;
 
 	if (!is_pmem_file(file) || !has_allocation(file)) {
 		return;
@@ -833,13 +866,10 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 		return;
 
 	down_read(&data->sem);
-	vaddr = pmem_start_vaddr(id, data);
 	/* if this isn't a submmapped file, flush the whole thing */
 	if (unlikely(!(data->flags & PMEM_FLAGS_CONNECTED))) {
-		dmac_flush_range(vaddr, vaddr + pmem_len(id, data));
-#ifdef CONFIG_CACHE_L2X0
-		outer_flush_range(__pa(vaddr),__pa(vaddr + pmem_len(id, data)));
-#endif
+		pmem_cache_range(id, data, PMEM_CACHE_FLUSH, 0,
+				 pmem_len(id, data));
 		goto end;
 	}
 	/* otherwise, flush the region of the file we are drawing */
@@ -848,12 +878,9 @@ void flush_pmem_file(struct file *file, unsigned long offset, unsigned long len)
 		if ((offset >= region_node->region.offset) &&
 		    ((offset + len) <= (region_node->region.offset +
 			region_node->region.len))) {
-			flush_start = vaddr + region_node->region.offset;
-			flush_end = flush_start + region_node->region.len;
-			dmac_flush_range(flush_start, flush_end);
-#ifdef CONFIG_CACHE_L2X0
-			outer_flush_range(__pa(flush_start),__pa(flush_end));
-#endif
+			pmem_cache_range(id, data, PMEM_CACHE_FLUSH,
+					 region_node->region.offset,
+					 region_node->region.len);
 			break;
 		}
 	}
@@ -861,6 +888,99 @@ end:
 	up_read(&data->sem);
 }
 
+static int pmem_in_regions(struct pmem_data *data, unsigned long offset,
+			   unsigned long len)
+{
+	struct pmem_region_node *region_node;
+
+	list_for_each_entry(region_node, &data->region_list, list)
+		if (offset >= region_node->region.offset &&
+		    offset + len <= region_node->region.offset +
+				    region_node->region.len)
+			return 1;
+	return 0;
+}
+
+/*
+ * Do one rectangle of a PMEM_CACHE_OP.  Lines less than a cache line apart
+ * are cleaned or flushed as one range, as the gaps between them would have
+ * been touched anyway.  They are never invalidated as one: that would
+ * throw away whatever the CPU wrote to the gaps.
+ *
+ * Caller must hold data->sem.
+ */
+static int pmem_cache_rect(int id, struct pmem_data *data, unsigned int op,
+			   struct pmem_cache_rect *rect)
+{
+	unsigned long len = pmem_len(id, data);
+	unsigned long span, line;
+
+	if (!rect->width || !rect->height)
+		return 0;
+	if (rect->height == 1)
+		rect->stride = rect->width;
+	if (rect->width > len || rect->stride < rect->width ||
+	    rect->height - 1 > (len - rect->width) / rect->stride)
+		return -EINVAL;
+	span = (rect->height - 1) * rect->stride + rect->width;
+	if (rect->offset > len || span > len - rect->offset)
+		return -EINVAL;
+	/* a connected file may only touch the regions mapped for it */
+	if ((data->flags & PMEM_FLAGS_CONNECTED) &&
+	    !pmem_in_regions(data, rect->offset, span))
+		return -EINVAL;
+
+	if (op != PMEM_CACHE_INV &&
+	    rect->stride - rect->width < L1_CACHE_BYTES) {
+		pmem_cache_range(id, data, op, rect->offset, span);
+		return 0;
+	}
+
+	for (line = 0; line < rect->height; line++)
+		pmem_cache_range(id, data, op,
+				 rect->offset + line * rect->stride,
+				 rect->width);
+	return 0;
+}
+
+static int pmem_cache_op(struct file *file, unsigned long arg)
+{
+	struct pmem_data *data = (struct pmem_data *)file->private_data;
+	struct pmem_cache_rect *rects;
+	struct pmem_cache_op op;
+	int id = get_id(file);
+	int i, ret = 0;
+
+	if (copy_from_user(&op, (void __user *)arg, sizeof(op)))
+		return -EFAULT;
+	if (!op.op || op.op > PMEM_CACHE_NR_OPS ||
+	    op.nr_rects > PMEM_CACHE_MAX_RECTS)
+		return -EINVAL;
+	if (!has_allocation(file))
+		return -EINVAL;
+	if (!pmem[id].cached || !op.nr_rects)
+		return 0;
+
+	/* copy them all first: faulting with data->sem held could deadlock
+	 * against remap, which takes the mmap_sem first */
+	rects = kmalloc(op.nr_rects * sizeof(*rects), GFP_KERNEL);
+	if (!rects)
+		return -ENOMEM;
+	if (copy_from_user(rects, (void __user *)op.rects,
+			   op.nr_rects * sizeof(*rects))) {
+		ret = -EFAULT;
+		goto out;
+	}
+
+	down_read(&data->sem);
+	for (i = 0; i < op.nr_rects && !ret; i++)
+		ret = pmem_cache_rect(id, data, op.op, &rects[i]);
+	up_read(&data->sem);
+out:
+	kfree(rects);
+	return ret;
+}
+
 static int pmem_connect(unsigned long connect, struct file *file)
 {
 	struct pmem_data *data = (struct pmem_data *)file->private_data;
@@ -1188,6 +1308,9 @@ static long pmem_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		DLOG("connect\n");
 		return pmem_connect(arg, file);
 		break;
+	case PMEM_CACHE_OP:
+		DLOG("cache op\n");
+		return pmem_cache_op(file, arg);
 	default:
 		if (pmem[id].ioctl)
 			return pmem[id].ioctl(file, cmd, arg);
@@ -1216,7 +1339,8 @@ static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 
 	DLOG("debug open\n");
 	n = scnprintf(buffer, debug_bufmax,
-		      "pid #: mapped regions (offset, len) (offset,len)...\n");
+		      "pid #: mapped regions (offset, len) (offset,len)... "
+		      "cache bytes clean/inv/flush\n");
 
 	down(&pmem[id].data_list_sem);
 	list_for_each(elt, &pmem[id].data_list) {
@@ -1232,7 +1356,10 @@ static ssize_t debug_read(struct file *file, char __user *buf, size_t count,
 					region_node->region.offset,
 					region_node->region.len);
 		}
-		n += scnprintf(buffer + n, debug_bufmax - n, "\n");
+		n += scnprintf(buffer + n, debug_bufmax - n, "%lu/%lu/%lu\n",
+			atomic_long_read(&data->cache_bytes[PMEM_CACHE_CLEAN - 1]),
+			atomic_long_read(&data->cache_bytes[PMEM_CACHE_INV - 1]),
+			atomic_long_read(&data->cache_bytes[PMEM_CACHE_FLUSH - 1]));
 		up_read(&data->sem);
 	}
 	up(&pmem[id].data_list_sem);
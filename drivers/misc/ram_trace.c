@@ -0,0 +1,679 @@
+/* drivers/misc/ram_trace.c
+ *
+ * Scheduling, interrupt, wakelock and suspend events in a RAM buffer that
+ * survives a reboot, next to ram_console.  The events come from the
+ * markers the sched_switch tracer uses and those in kernel/irq and
+ * kernel/power; after a hang or a watchdog reset the last few thousand
+ * of them can be read from /proc/last_trace.
+ *
+ * The buffer is split per cpu, and each cpu only writes its own part
+ * with interrupts disabled, so recording takes no lock.  Each part is a
+ * ring of ECC blocks of 16 byte records; a block's Reed-Solomon parity,
+ * the same code ram_console uses, is computed when the block is full,
+ * and a small per-cpu header, also protected, records which block is
+ * being filled.  That block is read back without correction.
+ *
+ * This software is licensed under the terms of the GNU General Public
+ * License version 2, as published by the Free Software Foundation, and
+ * may be copied, distributed, and modified under those terms.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+#include <linux/sched.h>
+#include <linux/marker.h>
+#include <linux/rslib.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/jiffies.h>
+#include <asm/io.h>
+
+#ifdef CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION
+#define ECC_BLOCK_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_DATA_SIZE
+#define ECC_SIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_ECC_SIZE
+#define ECC_SYMSIZE CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_SYMBOL_SIZE
+#define ECC_POLY CONFIG_ANDROID_RAM_CONSOLE_ERROR_CORRECTION_POLYNOMIAL
+#else
+/* ram_console's defaults */
+#define ECC_BLOCK_SIZE 128
+#define ECC_SIZE 16
+#define ECC_SYMSIZE 8
+#define ECC_POLY 0x11d
+#endif
+
+enum {
+	RAM_TRACE_SWITCH = 1,
+	RAM_TRACE_IRQ_ENTRY,
+	RAM_TRACE_IRQ_EXIT,
+	RAM_TRACE_WAKE_LOCK,
+	RAM_TRACE_WAKE_UNLOCK,
+	RAM_TRACE_EARLY_SUSPEND,
+	RAM_TRACE_LATE_RESUME,
+	RAM_TRACE_SUSPEND_ENTER,
+	RAM_TRACE_SUSPEND_EXIT,
+	RAM_TRACE_NAME = 0xff,	/* name of the wakelock just before */
+};
+
+enum {
+	TRACE_SWITCH = 1U << 0,
+	TRACE_IRQ = 1U << 1,
+	TRACE_WAKELOCK = 1U << 2,
+	TRACE_SUSPEND = 1U << 3,
+};
+static int trace_mask = TRACE_SWITCH | TRACE_IRQ | TRACE_WAKELOCK |
+			TRACE_SUSPEND;
+module_param_named(trace_mask, trace_mask, int, S_IRUGO | S_IWUSR | S_IWGRP);
+
+/* type is written last: a zero type is an unused or unfinished record */
+struct ram_trace_record {
+	uint8_t     type;
+	uint8_t     flags;
+	uint16_t    arg16;
+	uint32_t    arg;
+	uint64_t    time;	/* sched_clock() */
+};
+
+struct ram_trace_name {
+	uint8_t     type;
+	char        name[15];
+};
+
+struct ram_trace_buffer {
+	uint32_t    sig;
+	uint32_t    nr_cpus;
+	uint32_t    blocks;	/* per cpu */
+	uint32_t    block_size;
+};
+
+struct ram_trace_cpu {
+	uint32_t    sig;
+	uint32_t    block;	/* being filled */
+};
+
+#define RAM_TRACE_SIG (0x43525442) /* BTRC */
+#define RECORDS_PER_BLOCK (ECC_BLOCK_SIZE / sizeof(struct ram_trace_record))
+
+/* a record of the last boot, with its wakelock name if any */
+struct ram_trace_old {
+	struct ram_trace_record rec;
+	int cpu;
+	char name[16];
+};
+
+static struct ram_trace_buffer *ram_trace_buffer;
+static struct ram_trace_cpu *ram_trace_cpu;
+static struct ram_trace_record *ram_trace_data;
+static uint8_t *ram_trace_par_buffer;
+static unsigned int ram_trace_nr_cpus;
+static unsigned int ram_trace_blocks;
+static struct rs_control *ram_trace_rs_decoder;
+static int ram_trace_corrected_bytes;
+static int ram_trace_bad_blocks;
+static DEFINE_PER_CPU(unsigned int, ram_trace_pos);
+
+static struct ram_trace_old *ram_trace_old;
+static size_t ram_trace_old_count;
+
+static void ram_trace_encode_rs8(uint8_t *data, size_t len, uint8_t *ecc)
+{
+	int i;
+	uint16_t par[ECC_SIZE];
+	/* Initialize the parity buffer */
+	memset(par, 0, sizeof(par));
+	encode_rs8(ram_trace_rs_decoder, data, len, par, 0);
+	for (i = 0; i < ECC_SIZE; i++)
+		ecc[i] = par[i];
+}
+
+static int ram_trace_decode_rs8(void *data, size_t len, uint8_t *ecc)
+{
+	int i;
+	uint16_t par[ECC_SIZE];
+	for (i = 0; i < ECC_SIZE; i++)
+		par[i] = ecc[i];
+	return decode_rs8(ram_trace_rs_decoder, data, par, len,
+				NULL, 0, NULL, 0, NULL);
+}
+
+/*
+ * Parity follows the data: the main header's, then each cpu header's,
+ * then each block's, cpu by cpu.
+ */
+static uint8_t *ram_trace_header_par(void)
+{
+	return ram_trace_par_buffer;
+}
+
+static uint8_t *ram_trace_cpu_par(int cpu)
+{
+	return ram_trace_par_buffer + (1 + cpu) * ECC_SIZE;
+}
+
+static struct ram_trace_record *ram_trace_block(int cpu, unsigned int block)
+{
+	return ram_trace_data +
+	       (cpu * ram_trace_blocks + block) * RECORDS_PER_BLOCK;
+}
+
+static uint8_t *ram_trace_block_par(int cpu, unsigned int block)
+{
+	return ram_trace_par_buffer +
+	       (1 + ram_trace_nr_cpus + cpu * ram_trace_blocks + block) *
+	       ECC_SIZE;
+}
+
+static void ram_trace_start_block(int cpu, unsigned int block)
+{
+	memset(ram_trace_block(cpu, block), 0, ECC_BLOCK_SIZE);
+	ram_trace_cpu[cpu].block = block;
+	ram_trace_encode_rs8((uint8_t *)&ram_trace_cpu[cpu],
+			     sizeof(struct ram_trace_cpu),
+			     ram_trace_cpu_par(cpu));
+}
+
+/* called with interrupts disabled, on the cpu that owns the buffer */
+static void *ram_trace_reserve(int cpu)
+{
+	unsigned int pos = per_cpu(ram_trace_pos, cpu);
+
+	return ram_trace_block(cpu, 0) + pos;
+}
+
+static void ram_trace_commit(int cpu)
+{
+	unsigned int pos = ++per_cpu(ram_trace_pos, cpu);
+	unsigned int block = pos / RECORDS_PER_BLOCK;
+
+	if (pos % RECORDS_PER_BLOCK)
+		return;
+
+	/* the block is full: protect it, then move on to the next one */
+	ram_trace_encode_rs8((uint8_t *)ram_trace_block(cpu, block - 1),
+			     ECC_BLOCK_SIZE, ram_trace_block_par(cpu, block - 1));
+	if (block == ram_trace_blocks) {
+		block = 0;
+		per_cpu(ram_trace_pos, cpu) = 0;
+	}
+	ram_trace_start_block(cpu, block);
+}
+
+static void ram_trace_write(int type, int flags, int arg16, uint32_t arg,
+			    const char *name)
+{
+	struct ram_trace_record *rec;
+	struct ram_trace_name *nrec;
+	unsigned long irqflags;
+	int cpu;
+
+	local_irq_save(irqflags);
+	cpu = smp_processor_id();
+
+	rec = ram_trace_reserve(cpu);
+	rec->flags = flags;
+	rec->arg16 = arg16;
+	rec->arg = arg;
+	rec->time = sched_clock();
+	wmb();
+	rec->type = type;
+	ram_trace_commit(cpu);
+
+	if (name) {
+		nrec = ram_trace_reserve(cpu);
+		strncpy(nrec->name, name, sizeof(nrec->name));
+		wmb();
+		nrec->type = RAM_TRACE_NAME;
+		ram_trace_commit(cpu);
+	}
+
+	local_irq_restore(irqflags);
+}
+
+static notrace void
+ram_trace_switch(void *probe_data, void *call_data,
+		 const char *format, va_list *args)
+{
+	int prev_pid, next_pid;
+	long prev_state;
+
+	if (!(trace_mask & TRACE_SWITCH))
+		return;
+
+	prev_pid = va_arg(*args, int);
+	next_pid = va_arg(*args, int);
+	prev_state = va_arg(*args, long);
+
+	ram_trace_write(RAM_TRACE_SWITCH, min(prev_state, 255L), prev_pid,
+			next_pid, NULL);
+}
+
+static notrace void
+ram_trace_irq(void *probe_data, void *call_data,
+	      const char *format, va_list *args)
+{
+	int type = (long)probe_data;
+	unsigned int irq;
+	int ret = 0;
+
+	if (!(trace_mask & TRACE_IRQ))
+		return;
+
+	irq = va_arg(*args, unsigned int);
+	if (type == RAM_TRACE_IRQ_EXIT)
+		ret = va_arg(*args, int);
+
+	ram_trace_write(type, ret, 0, irq, NULL);
+}
+
+static notrace void
+ram_trace_wakelock(void *probe_data, void *call_data,
+		   const char *format, va_list *args)
+{
+	int event = (long)probe_data;
+	const char *name;
+	long timeout = -1;
+	int type;
+
+	if (!(trace_mask & TRACE_WAKELOCK))
+		return;
+
+	name = va_arg(*args, const char *);
+	type = va_arg(*args, int);
+	if (event == RAM_TRACE_WAKE_LOCK)
+		timeout = va_arg(*args, long);
+
+	ram_trace_write(event, type, timeout >= 0,
+			timeout >= 0 ? jiffies_to_msecs(timeout) : 0, name);
+}
+
+static notrace void
+ram_trace_suspend(void *probe_data, void *call_data,
+		  const char *format, va_list *args)
+{
+	int event = (long)probe_data;
+	int arg, error = 0;
+
+	if (!(trace_mask & TRACE_SUSPEND))
+		return;
+
+	arg = va_arg(*args, int);
+	if (event == RAM_TRACE_SUSPEND_EXIT)
+		error = va_arg(*args, int);
+
+	ram_trace_write(event, arg, 0, error, NULL);
+}
+
+static const struct {
+	const char *name;
+	const char *format;
+	marker_probe_func *probe;
+	long type;
+} ram_trace_markers[] = {
+	{ "kernel_sched_schedule",
+	  "prev_pid %d next_pid %d prev_state %ld ## rq %p prev %p next %p",
+	  ram_trace_switch, RAM_TRACE_SWITCH },
+	{ "kernel_irq_entry", "irq %u",
+	  ram_trace_irq, RAM_TRACE_IRQ_ENTRY },
+	{ "kernel_irq_exit", "irq %u ret %d",
+	  ram_trace_irq, RAM_TRACE_IRQ_EXIT },
+	{ "power_wake_lock", "name %s type %d timeout %ld",
+	  ram_trace_wakelock, RAM_TRACE_WAKE_LOCK },
+	{ "power_wake_unlock", "name %s type %d",
+	  ram_trace_wakelock, RAM_TRACE_WAKE_UNLOCK },
+	{ "power_early_suspend", "done %d",
+	  ram_trace_suspend, RAM_TRACE_EARLY_SUSPEND },
+	{ "power_late_resume", "done %d",
+	  ram_trace_suspend, RAM_TRACE_LATE_RESUME },
+	{ "power_suspend_enter", "state %d",
+	  ram_trace_suspend, RAM_TRACE_SUSPEND_ENTER },
+	{ "power_suspend_exit", "state %d error %d",
+	  ram_trace_suspend, RAM_TRACE_SUSPEND_EXIT },
+};
+
+static void ram_trace_save_record(struct ram_trace_record *rec, int cpu)
+{
+	struct ram_trace_old *old;
+
+	if (rec->type == RAM_TRACE_NAME) {
+		if (!ram_trace_old_count)
+			return;
+		old = &ram_trace_old[ram_trace_old_count - 1];
+		if (old->cpu != cpu || old->name[0] ||
+		    (old->rec.type != RAM_TRACE_WAKE_LOCK &&
+		     old->rec.type != RAM_TRACE_WAKE_UNLOCK))
+			return;
+		/* strncpy()'d: names of 15 characters or more have no NUL */
+		memcpy(old->name, ((struct ram_trace_name *)rec)->name,
+		       sizeof(((struct ram_trace_name *)rec)->name));
+		old->name[sizeof(old->name) - 1] = '\0';
+		return;
+	}
+
+	old = &ram_trace_old[ram_trace_old_count++];
+	old->rec = *rec;
+	old->cpu = cpu;
+	old->name[0] = '\0';
+}
+
+static int ram_trace_cmp(const void *a, const void *b)
+{
+	const struct ram_trace_old *x = a, *y = b;
+
+	if (x->rec.time != y->rec.time)
+		return x->rec.time < y->rec.time ? -1 : 1;
+	return x->cpu - y->cpu;
+}
+
+/*
+ * Copies the records of the last boot out, oldest first; the block that
+ * was being filled on each cpu has no valid parity and is taken as is.
+ */
+static void __init ram_trace_save_old(void)
+{
+	struct ram_trace_record *rec;
+	unsigned int cpu, cur, i, n;
+	int numerr;
+
+	ram_trace_old = vmalloc(ram_trace_nr_cpus * ram_trace_blocks *
+				RECORDS_PER_BLOCK * sizeof(*ram_trace_old));
+	if (ram_trace_old == NULL) {
+		printk(KERN_ERR "ram_trace: failed to allocate buffer\n");
+		return;
+	}
+
+	for (cpu = 0; cpu < ram_trace_nr_cpus; cpu++) {
+		numerr = ram_trace_decode_rs8(&ram_trace_cpu[cpu],
+					      sizeof(struct ram_trace_cpu),
+					      ram_trace_cpu_par(cpu));
+		if (numerr > 0)
+			ram_trace_corrected_bytes += numerr;
+		if (numerr < 0 || ram_trace_cpu[cpu].sig != RAM_TRACE_SIG ||
+		    ram_trace_cpu[cpu].block >= ram_trace_blocks) {
+			printk(KERN_INFO "ram_trace: no valid data for cpu %u\n",
+			       cpu);
+			ram_trace_bad_blocks++;
+			continue;
+		}
+
+		cur = ram_trace_cpu[cpu].block;
+		for (i = 1; i <= ram_trace_blocks; i++) {
+			unsigned int block = (cur + i) % ram_trace_blocks;
+
+			rec = ram_trace_block(cpu, block);
+			if (block != cur) {
+				numerr = ram_trace_decode_rs8(rec,
+					ECC_BLOCK_SIZE,
+					ram_trace_block_par(cpu, block));
+				if (numerr > 0) {
+					ram_trace_corrected_bytes += numerr;
+				} else if (numerr < 0) {
+					ram_trace_bad_blocks++;
+					continue;
+				}
+			}
+			for (n = 0; n < RECORDS_PER_BLOCK; n++)
+				if (rec[n].type)
+					ram_trace_save_record(&rec[n], cpu);
+		}
+	}
+
+	sort(ram_trace_old, ram_trace_old_count, sizeof(*ram_trace_old),
+	     ram_trace_cmp, NULL);
+
+	printk(KERN_INFO "ram_trace: %zu records, %d corrected bytes, "
+	       "%d unrecoverable blocks\n", ram_trace_old_count,
+	       ram_trace_corrected_bytes, ram_trace_bad_blocks);
+}
+
+static int __init ram_trace_init(void *buffer, size_t buffer_size)
+{
+	size_t header_size, block_size;
+	unsigned int cpu, block;
+	int numerr, i, ret;
+
+	BUILD_BUG_ON(sizeof(struct ram_trace_record) != 16);
+	BUILD_BUG_ON(sizeof(struct ram_trace_name) != 16);
+	BUILD_BUG_ON(ECC_BLOCK_SIZE % sizeof(struct ram_trace_record));
+
+	ram_trace_nr_cpus = nr_cpu_ids;
+	header_size = ALIGN(sizeof(struct ram_trace_buffer) +
+			    ram_trace_nr_cpus * sizeof(struct ram_trace_cpu),
+			    sizeof(struct ram_trace_record)) +
+		      (1 + ram_trace_nr_cpus) * ECC_SIZE;
+	block_size = ram_trace_nr_cpus * (ECC_BLOCK_SIZE + ECC_SIZE);
+	if (buffer_size < header_size + block_size * 2) {
+		pr_err("ram_trace: buffer %p, size %zu too small\n",
+		       buffer, buffer_size);
+		return -EINVAL;
+	}
+	ram_trace_blocks = (buffer_size - header_size) / block_size;
+
+	ram_trace_buffer = buffer;
+	ram_trace_cpu = buffer + sizeof(struct ram_trace_buffer);
+	ram_trace_data = buffer +
+		ALIGN(sizeof(struct ram_trace_buffer) +
+		      ram_trace_nr_cpus * sizeof(struct ram_trace_cpu),
+		      sizeof(struct ram_trace_record));
+	ram_trace_par_buffer = (uint8_t *)ram_trace_block(ram_trace_nr_cpus, 0);
+
+	/* first consecutive root is 0
+	 * primitive element to generate roots = 1
+	 */
+	ram_trace_rs_decoder = init_rs(ECC_SYMSIZE, ECC_POLY, 0, 1, ECC_SIZE);
+	if (ram_trace_rs_decoder == NULL) {
+		printk(KERN_INFO "ram_trace: init_rs failed\n");
+		return -ENOMEM;
+	}
+
+	numerr = ram_trace_decode_rs8(ram_trace_buffer,
+				      sizeof(struct ram_trace_buffer),
+				      ram_trace_header_par());
+	if (numerr > 0) {
+		printk(KERN_INFO "ram_trace: error in header, %d\n", numerr);
+		ram_trace_corrected_bytes += numerr;
+	} else if (numerr < 0) {
+		printk(KERN_INFO "ram_trace: uncorrectable error in header\n");
+		ram_trace_bad_blocks++;
+	}
+
+	if (ram_trace_buffer->sig == RAM_TRACE_SIG &&
+	    ram_trace_buffer->nr_cpus == ram_trace_nr_cpus &&
+	    ram_trace_buffer->blocks == ram_trace_blocks &&
+	    ram_trace_buffer->block_size == ECC_BLOCK_SIZE)
+		ram_trace_save_old();
+	else
+		printk(KERN_INFO "ram_trace: no valid data in buffer "
+		       "(sig = 0x%08x)\n", ram_trace_buffer->sig);
+
+	/* clear everything, so no record of the last boot is taken as new */
+	ram_trace_buffer->sig = RAM_TRACE_SIG;
+	ram_trace_buffer->nr_cpus = ram_trace_nr_cpus;
+	ram_trace_buffer->blocks = ram_trace_blocks;
+	ram_trace_buffer->block_size = ECC_BLOCK_SIZE;
+	ram_trace_encode_rs8((uint8_t *)ram_trace_buffer,
+			     sizeof(struct ram_trace_buffer),
+			     ram_trace_header_par());
+	for (cpu = 0; cpu < ram_trace_nr_cpus; cpu++) {
+		for (block = 1; block < ram_trace_blocks; block++) {
+			memset(ram_trace_block(cpu, block), 0, ECC_BLOCK_SIZE);
+			ram_trace_encode_rs8(
+				(uint8_t *)ram_trace_block(cpu, block),
+				ECC_BLOCK_SIZE, ram_trace_block_par(cpu, block));
+		}
+		ram_trace_cpu[cpu].sig = RAM_TRACE_SIG;
+		ram_trace_start_block(cpu, 0);
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ram_trace_markers); i++) {
+		ret = marker_probe_register(ram_trace_markers[i].name,
+					    ram_trace_markers[i].format,
+					    ram_trace_markers[i].probe,
+					    (void *)ram_trace_markers[i].type);
+		if (ret)
+			pr_info("ram_trace: couldn't add probe to %s\n",
+				ram_trace_markers[i].name);
+	}
+
+	printk(KERN_INFO "ram_trace: %u records per cpu\n",
+	       ram_trace_blocks * RECORDS_PER_BLOCK);
+	return 0;
+}
+
+static int __init ram_trace_driver_probe(struct platform_device *pdev)
+{
+	struct resource *res = pdev->resource;
+	size_t buffer_size;
+	void *buffer;
+
+	if (res == NULL || pdev->num_resources != 1 ||
+	    !(res->flags & IORESOURCE_MEM)) {
+		printk(KERN_ERR "ram_trace: invalid resource, %p %d flags "
+		       "%lx\n", res, pdev->num_resources, res ? res->flags : 0);
+		return -ENXIO;
+	}
+	buffer_size = res->end - res->start + 1;
+	printk(KERN_INFO "ram_trace: got buffer at %lx, size %zx\n",
+	       (unsigned long)res->start, buffer_size);
+	buffer = ioremap(res->start, buffer_size);
+	if (buffer == NULL) {
+		printk(KERN_ERR "ram_trace: failed to map memory\n");
+		return -ENOMEM;
+	}
+
+	return ram_trace_init(buffer, buffer_size);
+}
+
+static struct platform_driver ram_trace_driver = {
+	.driver		= {
+		.name	= "ram_trace",
+	},
+};
+
+static int __init ram_trace_module_init(void)
+{
+	return platform_driver_probe(&ram_trace_driver,
+				    ram_trace_driver_probe);
+}
+
+static void *ram_trace_seq_start(struct seq_file *m, loff_t *pos)
+{
+	if (*pos >= ram_trace_old_count)
+		return NULL;
+	return &ram_trace_old[*pos];
+}
+
+static void *ram_trace_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	++*pos;
+	return ram_trace_seq_start(m, pos);
+}
+
+static void ram_trace_seq_stop(struct seq_file *m, void *v)
+{
+}
+
+static int ram_trace_seq_show(struct seq_file *m, void *v)
+{
+	struct ram_trace_old *old = v;
+	struct ram_trace_record *rec = &old->rec;
+	unsigned long long t = rec->time;
+	unsigned long nsec_rem = do_div(t, NSEC_PER_SEC);
+
+	seq_printf(m, "[%5lu.%06lu] %d ", (unsigned long)t, nsec_rem / 1000,
+		   old->cpu);
+
+	switch (rec->type) {
+	case RAM_TRACE_SWITCH:
+		seq_printf(m, "switch %u -> %u, prev state %u\n",
+			   rec->arg16, rec->arg, rec->flags);
+		break;
+	case RAM_TRACE_IRQ_ENTRY:
+		seq_printf(m, "irq %u entry\n", rec->arg);
+		break;
+	case RAM_TRACE_IRQ_EXIT:
+		seq_printf(m, "irq %u exit%s\n", rec->arg,
+			   rec->flags ? "" : ", not handled");
+		break;
+	case RAM_TRACE_WAKE_LOCK:
+		if (rec->arg16)
+			seq_printf(m, "wake_lock %s, type %u, timeout %u ms\n",
+				   old->name, rec->flags, rec->arg);
+		else
+			seq_printf(m, "wake_lock %s, type %u\n",
+				   old->name, rec->flags);
+		break;
+	case RAM_TRACE_WAKE_UNLOCK:
+		seq_printf(m, "wake_unlock %s\n", old->name);
+		break;
+	case RAM_TRACE_EARLY_SUSPEND:
+		seq_printf(m, "early_suspend %s\n",
+			   rec->flags ? "done" : "start");
+		break;
+	case RAM_TRACE_LATE_RESUME:
+		seq_printf(m, "late_resume %s\n",
+			   rec->flags ? "done" : "start");
+		break;
+	case RAM_TRACE_SUSPEND_ENTER:
+		seq_printf(m, "suspend enter, state %u\n", rec->flags);
+		break;
+	case RAM_TRACE_SUSPEND_EXIT:
+		seq_printf(m, "suspend exit, state %u, error %d\n",
+			   rec->flags, (int)rec->arg);
+		break;
+	default:
+		seq_printf(m, "unknown event %u\n", rec->type);
+		break;
+	}
+	return 0;
+}
+
+static const struct seq_operations ram_trace_seq_ops = {
+	.start = ram_trace_seq_start,
+	.next = ram_trace_seq_next,
+	.stop = ram_trace_seq_stop,
+	.show = ram_trace_seq_show,
+};
+
+static int ram_trace_open_old(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &ram_trace_seq_ops);
+}
+
+static struct file_operations ram_trace_file_ops = {
+	.owner = THIS_MODULE,
+	.open = ram_trace_open_old,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = seq_release,
+};
+
+static int __init ram_trace_late_init(void)
+{
+	struct proc_dir_entry *entry;
+
+	if (ram_trace_old == NULL)
+		return 0;
+
+	entry = create_proc_entry("last_trace", S_IFREG | S_IRUGO, NULL);
+	if (!entry) {
+		printk(KERN_ERR "ram_trace: failed to create proc entry\n");
+		vfree(ram_trace_old);
+		ram_trace_old = NULL;
+		return 0;
+	}
+
+	entry->proc_fops = &ram_trace_file_ops;
+	return 0;
+}
+
+module_init(ram_trace_module_init);
+late_initcall(ram_trace_late_init);
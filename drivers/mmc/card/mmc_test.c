@@ -15,6 +15,7 @@
 #include <linux/mmc/mmc.h>
 
 #include <linux/scatterlist.h>
+#include <linux/math64.h>
 
 #define RESULT_OK		0
 #define RESULT_FAIL		1
@@ -891,6 +892,233 @@ static int mmc_test_multi_read_high(struct mmc_test_card *test)
 
 #endif /* CONFIG_HIGHMEM */
 
+/*******************************************************************/
+/*  Performance tests                                              */
+/*******************************************************************/
+
+#define PERF_TOTAL		(4 * 1024 * 1024)
+#define PERF_MAX_SIZE		(256 * 1024)
+#define PERF_MAX_PAGES		(PERF_MAX_SIZE / PAGE_SIZE)
+
+/*
+ * One request of a performance test, with its own pages so that two of
+ * them can be in the hands of the host at once.
+ */
+struct mmc_test_perf_req {
+	struct mmc_test_card	*test;
+	struct mmc_request	mrq;
+	struct mmc_command	cmd;
+	struct mmc_command	stop;
+	struct mmc_data		data;
+	struct mmc_async_req	areq;
+	struct scatterlist	sg[PERF_MAX_PAGES];
+	struct page		*pages[PERF_MAX_PAGES];
+	int			write;
+};
+
+/*
+ * The largest request, in pages, that the host takes as one page per
+ * sg entry
+ */
+static unsigned int mmc_test_perf_max_pages(struct mmc_host *host)
+{
+	unsigned int sz = PERF_MAX_SIZE;
+
+	sz = min(sz, host->max_req_size);
+	sz = min(sz, host->max_blk_count * 512);
+	sz = min(sz, (unsigned int)host->max_hw_segs * PAGE_SIZE);
+	sz = min(sz, (unsigned int)host->max_phys_segs * PAGE_SIZE);
+	if (host->max_seg_size < PAGE_SIZE)
+		return 0;
+
+	return sz / PAGE_SIZE;
+}
+
+static unsigned int mmc_test_capacity(struct mmc_card *card)
+{
+	if (!mmc_card_sd(card) && mmc_card_blockaddr(card))
+		return card->ext_csd.sectors;
+	else
+		return card->csd.capacity << (card->csd.read_blkbits - 9);
+}
+
+static void mmc_test_perf_prepare(struct mmc_test_perf_req *req,
+	unsigned int sector, unsigned int pages)
+{
+	struct mmc_test_card *test = req->test;
+	unsigned int i;
+
+	memset(&req->mrq, 0, sizeof(struct mmc_request));
+	memset(&req->cmd, 0, sizeof(struct mmc_command));
+	memset(&req->data, 0, sizeof(struct mmc_data));
+	memset(&req->stop, 0, sizeof(struct mmc_command));
+
+	req->mrq.cmd = &req->cmd;
+	req->mrq.data = &req->data;
+	req->mrq.stop = &req->stop;
+
+	sg_init_table(req->sg, pages);
+	for (i = 0; i < pages; i++)
+		sg_set_page(&req->sg[i], req->pages[i], PAGE_SIZE, 0);
+
+	if (!mmc_card_blockaddr(test->card))
+		sector <<= 9;
+
+	mmc_test_prepare_mrq(test, &req->mrq, req->sg, pages, sector,
+		pages * (PAGE_SIZE / 512), 512, req->write);
+
+	req->areq.mrq = &req->mrq;
+}
+
+static int mmc_test_perf_check(struct mmc_card *card,
+	struct mmc_async_req *areq)
+{
+	struct mmc_test_perf_req *req =
+		container_of(areq, struct mmc_test_perf_req, areq);
+
+	if (req->write)
+		mmc_test_wait_busy(req->test);
+
+	return mmc_test_check_result(req->test, &req->mrq);
+}
+
+/*
+ * Transfers count requests of the given size one after the other,
+ * waiting for each one before preparing the next
+ */
+static int mmc_test_perf_blocking(struct mmc_test_perf_req *req,
+	unsigned int pages, unsigned int count)
+{
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		mmc_test_perf_prepare(req, i * pages * (PAGE_SIZE / 512),
+			pages);
+		mmc_wait_for_req(req->test->card->host, &req->mrq);
+		ret = mmc_test_perf_check(req->test->card, &req->areq);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * The same, but each request is prepared while the previous one is
+ * transferred
+ */
+static int mmc_test_perf_nonblocking(struct mmc_test_perf_req *reqs,
+	unsigned int pages, unsigned int count)
+{
+	struct mmc_host *host = reqs[0].test->card->host;
+	struct mmc_test_perf_req *req;
+	unsigned int i;
+	int ret;
+
+	for (i = 0; i < count; i++) {
+		req = &reqs[i & 1];
+		mmc_test_perf_prepare(req, i * pages * (PAGE_SIZE / 512),
+			pages);
+		mmc_start_req(host, &req->areq, &ret);
+		if (ret)
+			return ret;
+	}
+
+	mmc_start_req(host, NULL, &ret);
+	return ret;
+}
+
+static int mmc_test_perf(struct mmc_test_card *test, int write,
+	int nonblocking)
+{
+	struct mmc_host *host = test->card->host;
+	struct mmc_test_perf_req *reqs;
+	struct timespec start, end, ts;
+	unsigned int max, pages, count, i, j;
+	u64 ns, rate;
+	int ret;
+
+	max = mmc_test_perf_max_pages(host);
+	if (!max)
+		return RESULT_UNSUP_HOST;
+	if (mmc_test_capacity(test->card) < PERF_TOTAL / 512)
+		return RESULT_UNSUP_CARD;
+
+	ret = mmc_test_set_blksize(test, 512);
+	if (ret)
+		return ret;
+
+	reqs = kzalloc(2 * sizeof(struct mmc_test_perf_req), GFP_KERNEL);
+	if (!reqs)
+		return -ENOMEM;
+
+	for (i = 0; i < 2; i++) {
+		reqs[i].test = test;
+		reqs[i].write = write;
+		reqs[i].areq.err_check = mmc_test_perf_check;
+		for (j = 0; j < max; j++) {
+			reqs[i].pages[j] = alloc_page(GFP_KERNEL);
+			if (!reqs[i].pages[j]) {
+				ret = -ENOMEM;
+				goto out;
+			}
+		}
+	}
+
+	for (pages = 1; pages <= max; pages <<= 1) {
+		count = PERF_TOTAL / (pages * PAGE_SIZE);
+
+		getnstimeofday(&start);
+		if (nonblocking)
+			ret = mmc_test_perf_nonblocking(reqs, pages, count);
+		else
+			ret = mmc_test_perf_blocking(reqs, pages, count);
+		getnstimeofday(&end);
+		if (ret)
+			break;
+
+		ts = timespec_sub(end, start);
+		ns = timespec_to_ns(&ts);
+		rate = div64_u64((u64)PERF_TOTAL * NSEC_PER_SEC,
+				 ns ? ns : 1) >> 10;
+
+		printk(KERN_INFO "%s: %u x %lu KiB in %lu.%09lu s: "
+			"%llu KiB/s\n", mmc_hostname(host), count,
+			pages * PAGE_SIZE / 1024, (unsigned long)ts.tv_sec,
+			ts.tv_nsec, rate);
+	}
+
+ out:
+	for (i = 0; i < 2; i++)
+		for (j = 0; j < max; j++)
+			if (reqs[i].pages[j])
+				__free_page(reqs[i].pages[j]);
+	kfree(reqs);
+
+	return ret;
+}
+
+static int mmc_test_perf_write(struct mmc_test_card *test)
+{
+	return mmc_test_perf(test, 1, 0);
+}
+
+static int mmc_test_perf_read(struct mmc_test_card *test)
+{
+	return mmc_test_perf(test, 0, 0);
+}
+
+static int mmc_test_perf_write_nonblock(struct mmc_test_card *test)
+{
+	return mmc_test_perf(test, 1, 1);
+}
+
+static int mmc_test_perf_read_nonblock(struct mmc_test_card *test)
+{
+	return mmc_test_perf(test, 0, 1);
+}
+
 static const struct mmc_test_case mmc_test_cases[] = {
 	{
 		.name = "Basic write (no data verification)",
@@ -1038,6 +1266,28 @@ static const struct mmc_test_case mmc_test_cases[] = {
 
 #endif /* CONFIG_HIGHMEM */
 
+	{
+		.name = "Sequential write performance",
+		.run = mmc_test_perf_write,
+		.cleanup = mmc_test_cleanup,
+	},
+
+	{
+		.name = "Sequential read performance",
+		.run = mmc_test_perf_read,
+	},
+
+	{
+		.name = "Sequential write performance, non-blocking",
+		.run = mmc_test_perf_write_nonblock,
+		.cleanup = mmc_test_cleanup,
+	},
+
+	{
+		.name = "Sequential read performance, non-blocking",
+		.run = mmc_test_perf_read_nonblock,
+	},
+
 };
 
 static DEFINE_MUTEX(mmc_test_lock);
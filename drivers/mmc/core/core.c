@@ -186,6 +186,75 @@ static void mmc_wait_done(struct mmc_request *mrq)
 	complete(mrq->done_data);
 }
 
+static void mmc_pre_req(struct mmc_host *host, struct mmc_request *mrq,
+			bool is_first_req)
+{
+	if (host->ops->pre_req)
+		host->ops->pre_req(host, mrq, is_first_req);
+}
+
+static void mmc_post_req(struct mmc_host *host, struct mmc_request *mrq,
+			 int err)
+{
+	if (host->ops->post_req)
+		host->ops->post_req(host, mrq, err);
+}
+
+/**
+ *	mmc_start_req - start a request without waiting for it
+ *	@host: MMC host to start the request
+ *	@areq: request to start, or NULL to only finish the previous one
+ *	@error: where to store the err_check result of the previous one
+ *
+ *	Prepares @areq while the previous asynchronous request, if any, is
+ *	still on the bus, waits for that one to complete and checks it,
+ *	then starts @areq and returns the previous request, or NULL if
+ *	there was none.  The caller then finishes the previous request
+ *	while @areq is being transferred.
+ *
+ *	If the previous request failed, @areq is not started: @error is
+ *	set and @areq must be passed in again once the caller has dealt
+ *	with the failure.
+ */
+struct mmc_async_req *mmc_start_req(struct mmc_host *host,
+				    struct mmc_async_req *areq, int *error)
+{
+	struct mmc_async_req *prev = host->areq;
+	int err = 0;
+
+	if (areq)
+		mmc_pre_req(host, areq->mrq, !prev);
+
+	if (prev) {
+		wait_for_completion(&prev->completion);
+		err = prev->err_check(host->card, prev);
+		if (err) {
+			mmc_post_req(host, prev->mrq, 0);
+			if (areq)
+				mmc_post_req(host, areq->mrq, -EINVAL);
+			host->areq = NULL;
+			goto out;
+		}
+	}
+
+	if (areq) {
+		init_completion(&areq->completion);
+		areq->mrq->done_data = &areq->completion;
+		areq->mrq->done = mmc_wait_done;
+		mmc_start_request(host, areq->mrq);
+	}
+	if (prev)
+		mmc_post_req(host, prev->mrq, 0);
+	host->areq = areq;
+
+ out:
+	if (error)
+		*error = err;
+	return prev;
+}
+
+EXPORT_SYMBOL(mmc_start_req);
+
 /**
  *	mmc_wait_for_req - start a request and wait for completion
  *	@host: MMC host to start command
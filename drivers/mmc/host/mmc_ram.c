@@ -0,0 +1,453 @@
+/*
+ *  linux/drivers/mmc/host/mmc_ram.c - MMC host with a card in RAM
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * A host controller with an MMC card (v3.1, byte addressed) emulated in
+ * vmalloc'ed memory, to exercise the core, the block driver and mmc_test
+ * without hardware.  Data commands are carried out by a worker thread, as
+ * a DMA engine would, and completed once the transfer would have taken
+ * xfer_kbps, so that the CPU work around a request (preparing, mapping,
+ * bouncing) and the transfer itself overlap the way they do on real
+ * hosts.
+ *
+ * The "stats" attribute of the platform device counts the requests, and
+ * how many of them pre_req prepared while another was on the bus.  It
+ * also warns if post_req is called for a request that hasn't completed.
+ */
+
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/init.h>
+#include <linux/platform_device.h>
+#include <linux/vmalloc.h>
+#include <linux/highmem.h>
+#include <linux/hrtimer.h>
+#include <linux/workqueue.h>
+#include <linux/scatterlist.h>
+
+#include <linux/mmc/host.h>
+#include <linux/mmc/mmc.h>
+
+#define DRIVER_NAME	"mmc_ram"
+
+#define MMC_RAM_OCR	(MMC_VDD_32_33 | MMC_VDD_33_34)
+/* always ready, in the transfer state */
+#define MMC_RAM_STATUS	(R1_READY_FOR_DATA | (4 << 9))
+#define MMC_RAM_MAX_REQ	(512 * 1024)
+
+static unsigned int size_mb = 16;
+module_param(size_mb, uint, 0444);
+MODULE_PARM_DESC(size_mb, "card size in MiB, up to 1024");
+
+static unsigned int xfer_kbps = 10240;
+module_param(xfer_kbps, uint, 0644);
+MODULE_PARM_DESC(xfer_kbps, "bus transfer rate in KiB/s, 0 for no delay");
+
+static unsigned int access_us = 50;
+module_param(access_us, uint, 0644);
+MODULE_PARM_DESC(access_us, "card access time per data command");
+
+struct mmc_ram_host {
+	struct mmc_host		*mmc;
+	u8			*mem;
+	unsigned long		size;
+	u32			cid[4];
+	u32			csd[4];
+
+	spinlock_t		lock;
+	struct mmc_request	*mrq;		/* data request in progress */
+	ktime_t			started;
+	struct workqueue_struct	*workqueue;
+	struct work_struct	work;
+	struct hrtimer		timer;
+
+	unsigned long		requests;
+	unsigned long long	bytes;
+	unsigned long		prepared;	/* by pre_req */
+	unsigned long		overlapped;	/* ...during another transfer */
+};
+
+/* The reverse of UNSTUFF_BITS() in core/mmc.c */
+static void mmc_ram_stuff(u32 *resp, int start, int size, u32 val)
+{
+	int off = 3 - start / 32;
+	int shft = start & 31;
+
+	resp[off] |= val << shft;
+	if (size + shft > 32)
+		resp[off - 1] |= val >> (32 - shft);
+}
+
+static void mmc_ram_init_card(struct mmc_ram_host *host)
+{
+	unsigned long blocks = host->size >> 9;
+	int mult;
+
+	/* capacity = (C_SIZE + 1) << (C_SIZE_MULT + 2) blocks */
+	for (mult = 0; mult < 7; mult++)
+		if ((blocks >> (mult + 2)) <= 4096)
+			break;
+
+	mmc_ram_stuff(host->cid, 120, 8, 0xff);		/* MID */
+	mmc_ram_stuff(host->cid, 96, 8, 'R');		/* PNM */
+	mmc_ram_stuff(host->cid, 88, 8, 'A');
+	mmc_ram_stuff(host->cid, 80, 8, 'M');
+	mmc_ram_stuff(host->cid, 72, 8, 'M');
+	mmc_ram_stuff(host->cid, 64, 8, 'M');
+	mmc_ram_stuff(host->cid, 56, 8, 'C');
+	mmc_ram_stuff(host->cid, 16, 32, 1);		/* PSN */
+	mmc_ram_stuff(host->cid, 12, 4, 1);		/* MDT */
+	mmc_ram_stuff(host->cid, 8, 4, 2008 - 1997);
+
+	mmc_ram_stuff(host->csd, 126, 2, 2);		/* CSD v1.2 */
+	mmc_ram_stuff(host->csd, 122, 4, 3);		/* MMC v3.1 */
+	mmc_ram_stuff(host->csd, 115, 4, 1);		/* TAAC 1us */
+	mmc_ram_stuff(host->csd, 112, 3, 3);
+	mmc_ram_stuff(host->csd, 99, 4, 5);		/* 20MHz */
+	mmc_ram_stuff(host->csd, 96, 3, 2);
+	mmc_ram_stuff(host->csd, 84, 12, 0x0f5);	/* CCC */
+	mmc_ram_stuff(host->csd, 80, 4, 9);		/* READ_BL_LEN */
+	mmc_ram_stuff(host->csd, 62, 12, (blocks >> (mult + 2)) - 1);
+	mmc_ram_stuff(host->csd, 47, 3, mult);
+	mmc_ram_stuff(host->csd, 26, 3, 2);		/* R2W_FACTOR */
+	mmc_ram_stuff(host->csd, 22, 4, 9);		/* WRITE_BL_LEN */
+}
+
+/*
+ * Commands without data.  Anything the card doesn't know, including
+ * the SD and SDIO probes, times out.
+ */
+static void mmc_ram_command(struct mmc_ram_host *host, struct mmc_command *cmd)
+{
+	switch (cmd->opcode) {
+	case MMC_GO_IDLE_STATE:
+		break;
+	case MMC_SEND_OP_COND:
+		cmd->resp[0] = MMC_CARD_BUSY | MMC_RAM_OCR;
+		break;
+	case MMC_ALL_SEND_CID:
+		memcpy(cmd->resp, host->cid, sizeof(host->cid));
+		break;
+	case MMC_SEND_CSD:
+		memcpy(cmd->resp, host->csd, sizeof(host->csd));
+		break;
+	case MMC_SET_RELATIVE_ADDR:
+	case MMC_SELECT_CARD:
+	case MMC_SET_BLOCKLEN:
+	case MMC_SEND_STATUS:
+	case MMC_STOP_TRANSMISSION:
+		cmd->resp[0] = MMC_RAM_STATUS;
+		break;
+	default:
+		cmd->error = -ETIMEDOUT;
+	}
+}
+
+static void mmc_ram_finish(struct mmc_ram_host *host)
+{
+	struct mmc_request *mrq;
+	unsigned long flags;
+
+	spin_lock_irqsave(&host->lock, flags);
+	mrq = host->mrq;
+	host->mrq = NULL;
+	host->requests++;
+	host->bytes += mrq->data->bytes_xfered;
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	mmc_request_done(host->mmc, mrq);
+}
+
+static enum hrtimer_restart mmc_ram_timeout(struct hrtimer *timer)
+{
+	mmc_ram_finish(container_of(timer, struct mmc_ram_host, timer));
+	return HRTIMER_NORESTART;
+}
+
+static void mmc_ram_copy(struct mmc_ram_host *host, struct mmc_data *data,
+			 u8 *mem, unsigned int len)
+{
+	struct sg_mapping_iter miter;
+	int write = data->flags & MMC_DATA_WRITE;
+
+	sg_miter_start(&miter, data->sg, data->sg_len, 0);
+	while (len && sg_miter_next(&miter)) {
+		miter.consumed = min_t(unsigned int, miter.length, len);
+		if (write) {
+			memcpy(mem, miter.addr, miter.consumed);
+		} else {
+			memcpy(miter.addr, mem, miter.consumed);
+			flush_kernel_dcache_page(miter.page);
+		}
+		mem += miter.consumed;
+		len -= miter.consumed;
+	}
+	sg_miter_stop(&miter);
+}
+
+static void mmc_ram_work(struct work_struct *work)
+{
+	struct mmc_ram_host *host =
+		container_of(work, struct mmc_ram_host, work);
+	struct mmc_request *mrq = host->mrq;
+	struct mmc_command *cmd = mrq->cmd;
+	struct mmc_data *data = mrq->data;
+	unsigned int len = data->blksz * data->blocks;
+	u64 ns;
+
+	switch (cmd->opcode) {
+	case MMC_READ_SINGLE_BLOCK:
+	case MMC_WRITE_BLOCK:
+		/* the rest of a longer transfer times out */
+		if (data->blocks > 1) {
+			len = data->blksz;
+			data->error = -ETIMEDOUT;
+		}
+		/* fall through */
+	case MMC_READ_MULTIPLE_BLOCK:
+	case MMC_WRITE_MULTIPLE_BLOCK:
+		cmd->resp[0] = MMC_RAM_STATUS;
+		if (cmd->arg > host->size || len > host->size - cmd->arg) {
+			cmd->resp[0] |= R1_OUT_OF_RANGE;
+			data->error = -ETIMEDOUT;
+			len = 0;
+			break;
+		}
+		mmc_ram_copy(host, data, host->mem + cmd->arg, len);
+		break;
+	default:
+		/* a command that has no data phase */
+		mmc_ram_command(host, cmd);
+		data->error = -ETIMEDOUT;
+		len = 0;
+	}
+
+	data->bytes_xfered = len;
+	if (mrq->stop)
+		mrq->stop->resp[0] = MMC_RAM_STATUS;
+
+	ns = (u64)access_us * NSEC_PER_USEC;
+	if (xfer_kbps) {
+		u64 xfer = (u64)len * NSEC_PER_SEC;
+
+		do_div(xfer, xfer_kbps * 1024);
+		ns += xfer;
+	}
+	if (ktime_to_ns(ktime_sub(ktime_get(), host->started)) < ns)
+		hrtimer_start(&host->timer, ktime_add_ns(host->started, ns),
+			      HRTIMER_MODE_ABS);
+	else
+		mmc_ram_finish(host);
+}
+
+static void mmc_ram_request(struct mmc_host *mmc, struct mmc_request *mrq)
+{
+	struct mmc_ram_host *host = mmc_priv(mmc);
+	unsigned long flags;
+
+	if (!mrq->data) {
+		mmc_ram_command(host, mrq->cmd);
+		mmc_request_done(mmc, mrq);
+		return;
+	}
+
+	spin_lock_irqsave(&host->lock, flags);
+	WARN_ON(host->mrq);
+	host->mrq = mrq;
+	host->started = ktime_get();
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	queue_work(host->workqueue, &host->work);
+}
+
+static void mmc_ram_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			    bool is_first_req)
+{
+	struct mmc_ram_host *host = mmc_priv(mmc);
+
+	if (!mrq->data)
+		return;
+
+	WARN_ON(mrq->data->host_cookie);
+	mrq->data->host_cookie = 1;
+	host->prepared++;
+	if (!is_first_req)
+		host->overlapped++;
+}
+
+static void mmc_ram_post_req(struct mmc_host *mmc, struct mmc_request *mrq,
+			     int err)
+{
+	struct mmc_ram_host *host = mmc_priv(mmc);
+
+	if (!mrq->data)
+		return;
+
+	WARN_ON(!mrq->data->host_cookie);
+	WARN_ON(host->mrq == mrq);
+	mrq->data->host_cookie = 0;
+}
+
+static void mmc_ram_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
+{
+}
+
+static int mmc_ram_get_ro(struct mmc_host *mmc)
+{
+	return 0;
+}
+
+static const struct mmc_host_ops mmc_ram_ops = {
+	.request	= mmc_ram_request,
+	.pre_req	= mmc_ram_pre_req,
+	.post_req	= mmc_ram_post_req,
+	.set_ios	= mmc_ram_set_ios,
+	.get_ro		= mmc_ram_get_ro,
+};
+
+static ssize_t mmc_ram_stats_show(struct device *dev,
+	struct device_attribute *attr, char *buf)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct mmc_ram_host *host = mmc_priv(mmc);
+
+	return sprintf(buf, "requests %lu\nbytes %llu\nprepared %lu\n"
+		       "overlapped %lu\n", host->requests, host->bytes,
+		       host->prepared, host->overlapped);
+}
+
+static DEVICE_ATTR(stats, S_IRUGO, mmc_ram_stats_show, NULL);
+
+static int __devinit mmc_ram_probe(struct platform_device *pdev)
+{
+	struct mmc_ram_host *host;
+	struct mmc_host *mmc;
+	int ret = -ENOMEM;
+
+	mmc = mmc_alloc_host(sizeof(struct mmc_ram_host), &pdev->dev);
+	if (!mmc)
+		return -ENOMEM;
+
+	host = mmc_priv(mmc);
+	host->mmc = mmc;
+	host->size = (unsigned long)size_mb << 20;
+	host->mem = vmalloc(host->size);
+	if (!host->mem)
+		goto err_free_host;
+	memset(host->mem, 0, host->size);
+
+	host->workqueue = create_singlethread_workqueue(DRIVER_NAME);
+	if (!host->workqueue)
+		goto err_vfree;
+
+	spin_lock_init(&host->lock);
+	INIT_WORK(&host->work, mmc_ram_work);
+	hrtimer_init(&host->timer, CLOCK_MONOTONIC, HRTIMER_MODE_ABS);
+	host->timer.function = mmc_ram_timeout;
+	mmc_ram_init_card(host);
+
+	mmc->ops = &mmc_ram_ops;
+	mmc->f_min = 400000;
+	mmc->f_max = 20000000;
+	mmc->ocr_avail = MMC_RAM_OCR;
+
+	mmc->max_blk_size = 512;
+	mmc->max_blk_count = MMC_RAM_MAX_REQ / 512;
+	mmc->max_req_size = MMC_RAM_MAX_REQ;
+	mmc->max_seg_size = MMC_RAM_MAX_REQ;
+	mmc->max_hw_segs = 128;
+	mmc->max_phys_segs = 128;
+
+	platform_set_drvdata(pdev, mmc);
+
+	ret = device_create_file(&pdev->dev, &dev_attr_stats);
+	if (ret)
+		goto err_destroy_wq;
+
+	ret = mmc_add_host(mmc);
+	if (ret)
+		goto err_remove_file;
+
+	return 0;
+
+err_remove_file:
+	device_remove_file(&pdev->dev, &dev_attr_stats);
+err_destroy_wq:
+	destroy_workqueue(host->workqueue);
+err_vfree:
+	vfree(host->mem);
+err_free_host:
+	mmc_free_host(mmc);
+	return ret;
+}
+
+static int __devexit mmc_ram_remove(struct platform_device *pdev)
+{
+	struct mmc_host *mmc = platform_get_drvdata(pdev);
+	struct mmc_ram_host *host = mmc_priv(mmc);
+
+	mmc_remove_host(mmc);
+	device_remove_file(&pdev->dev, &dev_attr_stats);
+
+	destroy_workqueue(host->workqueue);
+	hrtimer_cancel(&host->timer);
+	vfree(host->mem);
+
+	platform_set_drvdata(pdev, NULL);
+	mmc_free_host(mmc);
+	return 0;
+}
+
+static struct platform_driver mmc_ram_driver = {
+	.probe		= mmc_ram_probe,
+	.remove		= __devexit_p(mmc_ram_remove),
+	.driver		= {
+		.name	= DRIVER_NAME,
+		.owner	= THIS_MODULE,
+	},
+};
+
+static struct platform_device *mmc_ram_pdev;
+
+static int __init mmc_ram_init(void)
+{
+	int ret;
+
+	if (!size_mb || size_mb > 1024)
+		return -EINVAL;
+
+	mmc_ram_pdev = platform_device_alloc(DRIVER_NAME, -1);
+	if (!mmc_ram_pdev)
+		return -ENOMEM;
+
+	ret = platform_driver_register(&mmc_ram_driver);
+	if (ret)
+		goto err_put;
+
+	ret = platform_device_add(mmc_ram_pdev);
+	if (ret)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	platform_driver_unregister(&mmc_ram_driver);
+err_put:
+	platform_device_put(mmc_ram_pdev);
+	return ret;
+}
+
+static void __exit mmc_ram_exit(void)
+{
+	platform_device_unregister(mmc_ram_pdev);
+	platform_driver_unregister(&mmc_ram_driver);
+}
+
+module_init(mmc_ram_init);
+module_exit(mmc_ram_exit);
+
+MODULE_DESCRIPTION("MMC host with a card emulated in RAM");
+MODULE_LICENSE("GPL");
@@ -178,8 +178,10 @@ msmsdcc_dma_complete_func(struct msm_dmov_cmd *cmd,
 			mrq->data->error = -EIO;
 	}
 	host->dma.busy = 0;
-	dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg, host->dma.num_ents,
-		     host->dma.dir);
+	/* mapped by msmsdcc_pre_req() are unmapped by msmsdcc_post_req() */
+	if (!mrq->data->host_cookie)
+		dma_unmap_sg(mmc_dev(host->mmc), host->dma.sg,
+			     host->dma.num_ents, host->dma.dir);
 
 	if (host->curr.user_pages) {
 		struct scatterlist *sg = host->dma.sg;
@@ -279,8 +281,11 @@ static int msmsdcc_config_dma(struct msmsdcc_host *host, struct mmc_data *data)
 	/* host->curr.user_pages = (data->flags & MMC_DATA_USERPAGE); */
 	host->curr.user_pages = 0;
 
-	n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
-			host->dma.num_ents, host->dma.dir);
+	if (data->host_cookie)
+		n = host->dma.num_ents;
+	else
+		n = dma_map_sg(mmc_dev(host->mmc), host->dma.sg,
+			       host->dma.num_ents, host->dma.dir);
 
 	if (n != host->dma.num_ents) {
 		printk(KERN_ERR "%s: Unable to map in all sg elements\n",
@@ -752,6 +757,48 @@ msmsdcc_request(struct mmc_host *mmc, struct mmc_request *mrq)
 	spin_unlock_irqrestore(&host->lock, flags);
 }
 
+/*
+ * Map the next request's buffers while the current one is transferred;
+ * the DataMover command list is shared, so only the mapping (and its
+ * cache maintenance) is done ahead.  Whatever isn't mapped here is
+ * mapped by msmsdcc_config_dma() as before.
+ */
+static void
+msmsdcc_pre_req(struct mmc_host *mmc, struct mmc_request *mrq,
+		bool is_first_req)
+{
+	struct msmsdcc_host *host = mmc_priv(mmc);
+	struct mmc_data *data = mrq->data;
+	enum dma_data_direction dir;
+	int n;
+
+	if (!data || validate_dma(host, data))
+		return;
+
+	dir = data->flags & MMC_DATA_READ ? DMA_FROM_DEVICE : DMA_TO_DEVICE;
+	n = dma_map_sg(mmc_dev(mmc), data->sg, data->sg_len, dir);
+	if (n != data->sg_len) {
+		if (n)
+			dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len, dir);
+		return;
+	}
+	data->host_cookie = 1;
+}
+
+static void
+msmsdcc_post_req(struct mmc_host *mmc, struct mmc_request *mrq, int err)
+{
+	struct mmc_data *data = mrq->data;
+
+	if (!data || !data->host_cookie)
+		return;
+
+	dma_unmap_sg(mmc_dev(mmc), data->sg, data->sg_len,
+		     data->flags & MMC_DATA_READ ?
+		     DMA_FROM_DEVICE : DMA_TO_DEVICE);
+	data->host_cookie = 0;
+}
+
 static void
 msmsdcc_set_ios(struct mmc_host *mmc, struct mmc_ios *ios)
 {
@@ -841,6 +888,8 @@ static void msmsdcc_enable_sdio_irq(struct mmc_host *mmc, int enable)
 
 static const struct mmc_host_ops msmsdcc_ops = {
 	.request	= msmsdcc_request,
+	.pre_req	= msmsdcc_pre_req,
+	.post_req	= msmsdcc_post_req,
 	.set_ios	= msmsdcc_set_ios,
 #ifdef CONFIG_MMC_MSM_SDIO_SUPPORT
 	.enable_sdio_irq = msmsdcc_enable_sdio_irq,
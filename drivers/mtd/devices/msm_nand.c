@@ -4000,7 +4000,7 @@ static void __exit msm_nand_exit(void)
 	platform_driver_unregister(&msm_nand_driver);
 }
 
-module_init(msm_nand_init);
+module_init_async(msm_nand_init);
 module_exit(msm_nand_exit);
 
 MODULE_LICENSE("GPL");
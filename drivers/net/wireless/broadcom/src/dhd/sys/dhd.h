@@ -112,6 +112,8 @@ typedef struct dhd_pub {
 	ulong rx_ctlerrs;	/* Errors in processing rx control frames */
 	ulong rx_dropped;	/* Packets dropped locally (no memory) */
 	ulong rx_flushed;  /* Packets flushed due to unscheduled sendup thread */
+	ulong rx_polls;		/* NAPI poll calls */
+	ulong rx_pollfull;	/* NAPI polls that used their whole budget */
 
 	ulong rx_readahead_cnt;	/* Number of packets where header read-ahead was used. */
 	ulong tx_realloc;	/* Number of tx packets we had to realloc for headroom */
@@ -146,6 +146,8 @@ dhd_dump(dhd_pub_t *dhdp, char *buf, int buflen)
 	            dhdp->rx_ctlpkts, dhdp->rx_ctlerrs, dhdp->rx_dropped, dhdp->rx_flushed);
 	bcm_bprintf(strbuf, "rx_readahead_cnt %ld tx_realloc %ld\n",
 	            dhdp->rx_readahead_cnt, dhdp->tx_realloc);
+	bcm_bprintf(strbuf, "rx_polls %ld rx_pollfull %ld\n",
+	            dhdp->rx_polls, dhdp->rx_pollfull);
 	bcm_bprintf(strbuf, "\n");
 
 	/* Add any prot info */
@@ -224,6 +226,7 @@ dhd_doiovar(dhd_pub_t * dhd_pub, const bcm_iovar_t *vi, uint32 actionid, const c
 		dhd_pub->rx_readahead_cnt = 0;
 		dhd_pub->tx_realloc = 0;
 		dhd_pub->rx_flushed = 0;
+		dhd_pub->rx_polls = dhd_pub->rx_pollfull = 0;
 		memset(&dhd_pub->dstats, 0, sizeof(dhd_pub->dstats));
 		dhd_bus_clearcounts(dhd_pub);
 		break;
@@ -87,6 +87,11 @@ typedef struct dhd_if {
 	char			name[IFNAMSIZ+1]; /* linux interface name */
 } dhd_if_t;
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24)
+#define DHD_NAPI
+#define DHD_NAPI_QLEN	512	/* Max frames waiting for the NAPI poll */
+#endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 24) */
+
 /* Local private structure (extension of pub) */
 typedef struct dhd_info {
 #ifdef CONFIG_WIRELESS_EXT
@@ -115,6 +120,13 @@ typedef struct dhd_info {
 	struct semaphore dpc_sem;
 	struct completion dpc_exited;
 
+#ifdef DHD_NAPI
+	/* Polled receive: frames from the DPC wait here for dhd_napi_poll() */
+	struct napi_struct napi;
+	struct sk_buff_head rxq;
+	bool napi_enabled;
+#endif /* DHD_NAPI */
+
 	/* Thread to work on multicast and multiple interfaces */
 	long sysioc_pid;
 	struct semaphore sysioc_sem;
@@ -148,6 +160,12 @@ module_param(dhd_watchdog_prio, int, 0);
 int dhd_dpc_prio = 98;
 module_param(dhd_dpc_prio, int, 0);
 
+#ifdef DHD_NAPI
+/* NAPI poll weight (frames per poll), 0 to hand frames to netif_rx() */
+uint dhd_napi_weight = 64;
+module_param(dhd_napi_weight, uint, 0);
+#endif /* DHD_NAPI */
+
 /* DPC thread priority, -1 to use tasklet */
 extern int dhd_dongle_memsize;
 module_param(dhd_dongle_memsize, int, 0);
@@ -202,6 +220,10 @@ module_param(dhd_rxbound, uint, 0);
 extern uint dhd_deferred_tx;
 module_param(dhd_deferred_tx, uint, 0);
 
+/* Tx glomming: send queued frames in one SDIO transfer */
+extern uint dhd_txglom;
+module_param(dhd_txglom, uint, 0);
+
 
 
 #ifdef SDTEST
@@ -672,6 +694,65 @@ dhd_txflowcontrol(dhd_pub_t *dhdp, int ifidx, bool state)
 		netif_wake_queue(net);
 }
 
+#ifdef DHD_NAPI
+/* Deliver queued rx frames to the stack, at most budget per call */
+static int
+dhd_napi_poll(struct napi_struct *napi, int budget)
+{
+	dhd_info_t *dhd = container_of(napi, dhd_info_t, napi);
+	struct sk_buff *skb;
+	int work = 0;
+
+	while ((work < budget) && (skb = skb_dequeue(&dhd->rxq))) {
+		netif_receive_skb(skb);
+		work++;
+	}
+
+	dhd->pub.rx_polls++;
+	if (work < budget) {
+		napi_complete(napi);
+		/* Frames queued after the last dequeue found the poll still
+		 * scheduled, so nobody else will pick them up.
+		 */
+		if (!skb_queue_empty(&dhd->rxq))
+			napi_reschedule(napi);
+	} else
+		dhd->pub.rx_pollfull++;
+
+	return work;
+}
+
+/* Move a batch of rx frames to the NAPI queue and schedule one poll for it */
+static void
+dhd_napi_rx(dhd_info_t *dhd, struct sk_buff_head *list)
+{
+	struct sk_buff *skb;
+	ulong flags;
+
+	spin_lock_irqsave(&dhd->rxq.lock, flags);
+	while ((skb = __skb_dequeue(list))) {
+		if (skb_queue_len(&dhd->rxq) >= DHD_NAPI_QLEN) {
+			dhd->pub.rx_dropped++;
+			dev_kfree_skb_any(skb);
+			continue;
+		}
+		__skb_queue_tail(&dhd->rxq, skb);
+	}
+	spin_unlock_irqrestore(&dhd->rxq.lock, flags);
+
+	if (in_interrupt()) {
+		napi_schedule(&dhd->napi);
+	} else {
+		/* As with netif_rx_ni(), run the softirq we raised right away
+		 * rather than leaving it to the next interrupt.
+		 */
+		local_bh_disable();
+		napi_schedule(&dhd->napi);
+		local_bh_enable();
+	}
+}
+#endif /* DHD_NAPI */
+
 void
 dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 {
@@ -683,6 +764,13 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 	int i;
 	dhd_if_t *ifp;
 	wl_event_msg_t event;
+#ifdef DHD_NAPI
+	struct sk_buff_head rxlist;
+	bool napi = dhd->napi_enabled;
+
+	if (napi)
+		skb_queue_head_init(&rxlist);
+#endif /* DHD_NAPI */
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -745,6 +833,13 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 		dhdp->dstats.rx_bytes += skb->len;
 		dhdp->rx_packets++; /* Local count */
 
+#ifdef DHD_NAPI
+		if (napi) {
+			__skb_queue_tail(&rxlist, skb);
+			continue;
+		}
+#endif /* DHD_NAPI */
+
 		if (in_interrupt()) {
 			netif_rx(skb);
 		} else {
@@ -765,6 +860,11 @@ dhd_rx_frame(dhd_pub_t *dhdp, int ifidx, void *pktbuf, int numpkt)
 #endif /* LINUX_VERSION_CODE >= KERNEL_VERSION(2, 6, 0) */
 		}
 	}
+
+#ifdef DHD_NAPI
+	if (napi && !skb_queue_empty(&rxlist))
+		dhd_napi_rx(dhd, &rxlist);
+#endif /* DHD_NAPI */
 }
 
 void
@@ -1429,9 +1529,22 @@ dhd_attach(osl_t *osh, struct dhd_bus *bus, uint bus_hdrlen)
 
 	dhd->pub.osh = osh;
 
+#ifdef DHD_NAPI
+	skb_queue_head_init(&dhd->rxq);
+#endif /* DHD_NAPI */
+
 	if (dhd_add_if(dhd, 0, (void *)net, net->name) == DHD_BAD_IF)
 		goto fail;
 
+#ifdef DHD_NAPI
+	/* Polled receive on the primary interface's context */
+	if (dhd_napi_weight) {
+		netif_napi_add(net, &dhd->napi, dhd_napi_poll, dhd_napi_weight);
+		napi_enable(&dhd->napi);
+		dhd->napi_enabled = TRUE;
+	}
+#endif /* DHD_NAPI */
+
 	net->open = NULL;
 
 	init_MUTEX(&dhd->proto_sem);
@@ -1766,6 +1879,16 @@ dhd_detach(dhd_pub_t *dhdp)
 
 		dhd_net_stop(dhdp);	/* Copy this logic from RC31 :SW.LEE */
 
+#ifdef DHD_NAPI
+		/* DPC is gone, so nothing else will be queued */
+		if (dhd->napi_enabled) {
+			dhd->napi_enabled = FALSE;
+			napi_disable(&dhd->napi);
+			netif_napi_del(&dhd->napi);
+		}
+		skb_queue_purge(&dhd->rxq);
+#endif /* DHD_NAPI */
+
 		if (dhdp->prot)
 			dhd_prot_detach(dhdp);
 
@@ -76,6 +76,16 @@
 
 #define DHD_TXMINMAX	1	/* Max tx frames if rx still pending */
 
+#define DHD_TXGLOM_MAX	8	/* Max tx frames in one F2 write (tx superframe) */
+#define DHD_TXGLOM_BUFSZ	(16 * 1024)	/* Max frame bytes in a tx superframe */
+#define DHD_TXGLOM_PKTSZ	(DHD_TXGLOM_BUFSZ + 1024) /* Plus alignment and roundup */
+
+#define DHD_RXPOOL_MAX	32	/* Default depth of the rx buffer pool */
+#define DHD_RXPOOL_FILL	8	/* Max pool buffers allocated per watchdog tick */
+#define DHD_RX_COPYBREAK	256	/* Copy frames up to this size, recycle buffer */
+
+#define DHD_SDSINK_WINDOW	16	/* Tx credit granted by the software bus stand-in */
+
 #define MEMBLOCK    2048 /* Block size used for downloading of dongle image */
 #define MAX_DATA_BUF (32 * 1024)	/* which should be more than
 						* and to hold biggest glom possible
@@ -114,6 +124,9 @@
 
 #define MAX_RX_DATASZ	2048
 
+/* Rx pool buffers hold any frame that fits the non-glom read limit */
+#define DHD_RXPOOL_PKTSZ	(MAX_RX_DATASZ + DHD_SDALIGN)
+
 /* Maximum milliseconds to wait for F2 to come up */
 #define DHD_WAIT_F2RDY	4000
 
@@ -138,7 +151,7 @@
  * bufpool was present for gspi bus.
  */
 #define PKTFREE2()		if ((bus->bus != SPI_BUS) || bus->usebufpool) \
-					PKTFREE(bus->dhd->osh, pkt, FALSE);
+					dhdsdio_rxpkt_put(bus, pkt);
 
 /* Private data for SDIO bus interaction */
 typedef struct dhd_bus {
@@ -247,8 +260,30 @@ typedef struct dhd_bus {
 	uint	pktgen_rcvd;	/* Number of test packets received */
 	uint	pktgen_fail;	/* Number of failed send attempts */
 	uint16	pktgen_len;	/* Length of next packet to send */
+
+	/* software bus stand-in: F2 writes consumed by the host */
+	bool	sdsink;		/* Loop F2 writes back instead of sending them */
+	uint8	sink_seq;	/* Next tx sequence number expected by the sink */
+	struct pktq sinkq;	/* Echo responses waiting for delivery */
+	uint	sink_xfers;	/* F2 writes consumed by the sink */
+	uint	sink_frames;	/* Frames found in those writes */
+	uint	sink_badseq;	/* Frames with unexpected sequence number */
+	uint	sink_errors;	/* Writes with bad framing */
 #endif /* SDTEST */
 
+	/* Tx glomming: several queued frames in one F2 write */
+	bool		txglom_enable;	/* Use tx superframes */
+	uint		txglom_max;	/* Max frames per tx superframe */
+	void		*txglom_pkt;	/* Buffer for building tx superframes */
+	uint		txglom_headroom; /* Original headroom of txglom_pkt */
+
+	/* Rx buffer pool */
+	void		*rxpool;	/* Free list of full-size rx packets */
+	uint		rxpool_cnt;	/* Packets currently on the free list */
+	uint		rxpool_max;	/* Pool depth (0 disables the pool) */
+	uint		rxpool_headroom; /* Headroom to restore on recycle */
+	uint		rx_copybreak;	/* Copy frames this small, recycle buffer */
+
 	/* Some additional counters */
 	uint	tx_sderrs;	/* Count of tx attempts with sd errors */
 	uint	fcqueued;	/* Tx packets that got queued */
@@ -268,6 +303,12 @@ typedef struct dhd_bus {
 	uint	f2rxdata;	/* Number of frame data reads */
 	uint	f2txdata;	/* Number of f2 frame writes */
 	uint	f1regdata;	/* Number of f1 register accesses */
+	uint	txglomframes;	/* Number of tx superframes sent */
+	uint	txglompkts;	/* Number of packets sent in tx superframes */
+	uint	rxpool_hits;	/* Rx buffers taken from the pool */
+	uint	rxpool_misses;	/* Rx buffers allocated because pool was empty */
+	uint	rxpool_recycled; /* Rx buffers returned to the pool */
+	uint	rx_copied;	/* Rx frames copied out under rx_copybreak */
 
 } dhd_bus_t;
 
@@ -292,6 +333,9 @@ uint dhd_txbound;
 uint dhd_rxbound;
 uint dhd_txminmax = DHD_TXMINMAX;
 
+/* Tx glomming (requires dongle support for back-to-back F2 frames) */
+uint dhd_txglom;
+
 /* override the RAM size if possible */
 #define DONGLE_MIN_MEMSIZE (128 *1024)
 int dhd_dongle_memsize;
@@ -387,6 +431,7 @@ do { \
 #ifdef SDTEST
 static void dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq);
 static void dhdsdio_sdtest_set(dhd_bus_t *bus, bool start);
+static int dhdsdio_sdsink(dhd_bus_t *bus, uint8 *buf, uint nbytes);
 #endif
 
 static int dhdsdio_download_state(dhd_bus_t *bus, bool enter);
@@ -800,6 +845,132 @@ dhdsdio_bussleep(dhd_bus_t *bus, bool sleep)
 	} while (0);
 
 
+/* Rx buffer pool.  Full-size rx packets the driver consumes itself (control
+ * and test frames, errors, copied-out small frames) go back on a free list
+ * and are handed out again instead of calling PKTGET for every frame.  The
+ * list is refilled from the watchdog, outside the receive path.
+ * Caller holds the SDIO lock.
+ */
+static void *
+dhdsdio_rxpkt_get(dhd_bus_t *bus, uint len)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *pkt;
+
+	if ((len <= DHD_RXPOOL_PKTSZ) && (pkt = bus->rxpool)) {
+		bus->rxpool = PKTNEXT(osh, pkt);
+		PKTSETNEXT(osh, pkt, NULL);
+		bus->rxpool_cnt--;
+		bus->rxpool_hits++;
+		PKTSETLEN(osh, pkt, len);
+		return pkt;
+	}
+
+	if (bus->rxpool_max)
+		bus->rxpool_misses++;
+	return PKTGET(osh, len, FALSE);
+}
+
+/* Return a packet (or chain) to the rx pool, freeing what doesn't fit */
+static void
+dhdsdio_rxpkt_put(dhd_bus_t *bus, void *pkt)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *pnext;
+
+	for (; pkt; pkt = pnext) {
+		pnext = PKTNEXT(osh, pkt);
+		PKTSETNEXT(osh, pkt, NULL);
+
+		if ((bus->rxpool_cnt < bus->rxpool_max) &&
+		    PKTRESET(osh, pkt, bus->rxpool_headroom, DHD_RXPOOL_PKTSZ)) {
+			PKTSETNEXT(osh, pkt, bus->rxpool);
+			bus->rxpool = pkt;
+			bus->rxpool_cnt++;
+			bus->rxpool_recycled++;
+		} else {
+			PKTFREE(osh, pkt, FALSE);
+		}
+	}
+}
+
+static void
+dhdsdio_rxpool_fill(dhd_bus_t *bus, uint maxpkts)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *pkt;
+
+	while (maxpkts-- && (bus->rxpool_cnt < bus->rxpool_max)) {
+		if (!(pkt = PKTGET(osh, DHD_RXPOOL_PKTSZ, FALSE)))
+			break;
+		bus->rxpool_headroom = PKTHEADROOM(osh, pkt);
+		PKTSETNEXT(osh, pkt, bus->rxpool);
+		bus->rxpool = pkt;
+		bus->rxpool_cnt++;
+	}
+}
+
+/* Takes osh from the caller: on release bus->dhd is already gone */
+static void
+dhdsdio_rxpool_flush(dhd_bus_t *bus, osl_t *osh)
+{
+	if (bus->rxpool)
+		PKTFREE(osh, bus->rxpool, FALSE);
+	bus->rxpool = NULL;
+	bus->rxpool_cnt = 0;
+}
+
+/* Small frames (TCP acks, events) are copied into a right-sized packet
+ * so the full-size buffer stays in the pool instead of going up the stack.
+ */
+static void *
+dhdsdio_rxcopybreak(dhd_bus_t *bus, void *pkt)
+{
+	osl_t *osh = bus->dhd->osh;
+	uint len = PKTLEN(osh, pkt);
+	void *new;
+
+	if (!bus->rxpool_max || (len > bus->rx_copybreak))
+		return pkt;
+
+	ASSERT(PKTNEXT(osh, pkt) == NULL);
+	if (!(new = PKTGET(osh, len, FALSE)))
+		return pkt;
+
+	bcopy(PKTDATA(osh, pkt), PKTDATA(osh, new), len);
+	PKTSETPRIO(new, PKTPRIO(pkt));
+	dhdsdio_rxpkt_put(bus, pkt);
+	bus->rx_copied++;
+
+	return new;
+}
+
+/* Abort a failed F2 write and make the dongle discard the partial frame */
+static void
+dhdsdio_txfail(dhd_bus_t *bus)
+{
+	bcmsdh_info_t *sdh = bus->sdh;
+	int i;
+
+	bus->tx_sderrs++;
+
+	bcmsdh_abort(sdh, SDIO_FUNC_2);
+	bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
+	                 SFC_WF_TERM, NULL);
+	bus->f1regdata++;
+
+	for (i = 0; i < 3; i++) {
+		uint8 hi, lo;
+		hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+		                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
+		lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
+		                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
+		bus->f1regdata += 2;
+		if ((hi == 0) && (lo == 0))
+			break;
+	}
+}
+
 /* Writes a HW/SW header into the packet and sends it. */
 /* Assumes: (a) header space already there, (b) caller holds lock */
 static int
@@ -813,7 +984,6 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 	uint retries = 0;
 	bcmsdh_info_t *sdh;
 	void *new;
-	int i;
 
 	DHD_TRACE(("%s: Enter\n", __FUNCTION__));
 
@@ -918,24 +1088,7 @@ dhdsdio_txpkt(dhd_bus_t *bus, void *pkt, uint chan, bool free_pkt)
 			/* On failure, abort the command and terminate the frame */
 			DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
 			          __FUNCTION__, ret));
-			bus->tx_sderrs++;
-
-			bcmsdh_abort(sdh, SDIO_FUNC_2);
-			bcmsdh_cfg_write(sdh, SDIO_FUNC_1, SBSDIO_FUNC1_FRAMECTRL,
-			                 SFC_WF_TERM, NULL);
-			bus->f1regdata++;
-
-			for (i = 0; i < 3; i++) {
-				uint8 hi, lo;
-				hi = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
-				                     SBSDIO_FUNC1_WFRAMEBCHI, NULL);
-				lo = bcmsdh_cfg_read(sdh, SDIO_FUNC_1,
-				                     SBSDIO_FUNC1_WFRAMEBCLO, NULL);
-				bus->f1regdata += 2;
-				if ((hi == 0) && (lo == 0))
-					break;
-			}
-
+			dhdsdio_txfail(bus);
 		}
 	} while ((ret < 0) && retrydata && retries++ < TXRETRIES);
 
@@ -952,6 +1105,115 @@ done:
 	return ret;
 }
 
+/* Sends several frames in a single F2 write.  Each frame gets its own HW/SW
+ * header and sequence number and the frames are packed back to back, so the
+ * dongle walks the transfer by frame tag just as for consecutive writes; only
+ * the total is padded.  Frames are copied into bus->txglom_pkt, which is
+ * handed to the SDIO layer as an aligned packet (no bounce copy below us).
+ * Assumes: (a) header space already there, (b) caller holds lock,
+ * (c) total length fits in DHD_TXGLOM_BUFSZ.  Frees the packets.
+ */
+static int
+dhdsdio_txglom(dhd_bus_t *bus, void **pkts, uint num, uint chan)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *glom = bus->txglom_pkt;
+	uint8 *frame, *dptr;
+	uint16 len;
+	uint32 swheader;
+	uint total, i;
+	uint retries = 0;
+	int ret;
+
+	DHD_TRACE(("%s: Enter, %d frames\n", __FUNCTION__, num));
+
+	if (bus->dhd->dongle_reset) {
+		ret = BCME_NOTREADY;
+		goto done;
+	}
+
+	for (total = 0, i = 0; i < num; i++)
+		total += PKTLEN(osh, pkts[i]);
+	ASSERT(total <= DHD_TXGLOM_BUFSZ);
+
+	/* Restore the full buffer, then align the start */
+	if (!PKTRESET(osh, glom, bus->txglom_headroom, DHD_TXGLOM_PKTSZ)) {
+		ret = BCME_ERROR;
+		goto done;
+	}
+	PKTALIGN(osh, glom, DHD_TXGLOM_PKTSZ - DHD_SDALIGN, DHD_SDALIGN);
+	frame = (uint8*)PKTDATA(osh, glom);
+
+	for (dptr = frame, i = 0; i < num; i++) {
+		len = (uint16)PKTLEN(osh, pkts[i]);
+		bcopy(PKTDATA(osh, pkts[i]), dptr, len);
+
+		/* Hardware tag: 2 byte len followed by 2 byte ~len check (all LE) */
+		*(uint16*)dptr = htol16(len);
+		*(((uint16*)dptr) + 1) = htol16(~len);
+
+		/* Software tag: channel, sequence number, data offset */
+		swheader = ((chan << SDPCM_CHANNEL_SHIFT) & SDPCM_CHANNEL_MASK) | bus->tx_seq |
+		        ((SDPCM_HDRLEN << SDPCM_DOFFSET_SHIFT) & SDPCM_DOFFSET_MASK);
+		htol32_ua_store(swheader, dptr + SDPCM_FRAMETAG_LEN);
+		htol32_ua_store(0, dptr + SDPCM_FRAMETAG_LEN + sizeof(swheader));
+		bus->tx_seq = (bus->tx_seq + 1) % SDPCM_SEQUENCE_WRAP;
+
+#ifdef DHD_DEBUG
+		tx_packets[PKTPRIO(pkts[i])]++;
+		if (DHD_HDRS_ON())
+			prhex("TxGlomHdr", dptr, MIN(len, 16));
+#endif
+		dptr += len;
+	}
+
+	/* Zero the pad so the dongle sees an empty tag after the last frame */
+	len = (uint16)total;
+	if (bus->roundup && bus->blocksize && (total > bus->blocksize)) {
+		uint16 pad = bus->blocksize - (total % bus->blocksize);
+		if ((pad <= bus->roundup) && (pad < bus->blocksize))
+			len += pad;
+	} else if (total % DHD_SDALIGN) {
+		len += DHD_SDALIGN - (total % DHD_SDALIGN);
+	}
+	if (forcealign && (len & (ALIGNMENT - 1)))
+		len = ROUNDUP(len, ALIGNMENT);
+	bzero(frame + total, len - total);
+	PKTSETLEN(osh, glom, len);
+
+	do {
+		ret = dhd_bcmsdh_send_buf(bus, bcmsdh_cur_sbwad(bus->sdh), SDIO_FUNC_2, F2SYNC,
+		                          frame, len, glom, NULL, NULL);
+		bus->f2txdata++;
+		ASSERT(ret != BCME_PENDING);
+
+		if (ret < 0) {
+			DHD_INFO(("%s: sdio error %d, abort command and terminate frame.\n",
+			          __FUNCTION__, ret));
+			dhdsdio_txfail(bus);
+		}
+	} while ((ret < 0) && retrydata && retries++ < TXRETRIES);
+
+	if (ret == 0) {
+		bus->txglomframes++;
+		bus->txglompkts += num;
+	}
+
+done:
+	/* restore pkt buffer pointers before calling tx complete routine */
+	dhd_os_sdunlock(bus->dhd);
+	for (i = 0; i < num; i++) {
+		PKTPULL(osh, pkts[i], SDPCM_HDRLEN);
+		dhd_txcomplete(bus->dhd, pkts[i], ret != 0);
+	}
+	dhd_os_sdlock(bus->dhd);
+
+	for (i = 0; i < num; i++)
+		PKTFREE(osh, pkts[i], TRUE);
+
+	return ret;
+}
+
 static bool
 dhd_prec_enq(struct dhd_bus *bus, struct pktq *q, void *pkt, int prec)
 {
@@ -1093,6 +1355,60 @@ dhd_bus_txdata(struct dhd_bus *bus, void *pkt)
 	return ret;
 }
 
+/* Dequeue as many frames as the window, glom limit and buffer allow and send
+ * them as one tx superframe.  Returns the number of frames dequeued.
+ */
+static uint
+dhdsdio_sendglom(dhd_bus_t *bus, uint maxframes, uint8 tx_prec_map)
+{
+	osl_t *osh = bus->dhd->osh;
+	void *pkts[DHD_TXGLOM_MAX];
+	void *pkt;
+	uint num, total, datalen;
+	int ret, prec_out;
+
+	maxframes = MIN(maxframes, (uint8)(bus->tx_max - bus->tx_seq));
+	maxframes = MIN(maxframes, bus->txglom_max);
+
+	dhd_os_sdlock_txq(bus->dhd);
+	for (num = total = 0; num < maxframes; num++) {
+		if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL)
+			break;
+		if (num && ((total + PKTLEN(osh, pkt)) > DHD_TXGLOM_BUFSZ)) {
+			pktq_penq_head(&bus->txq, prec_out, pkt);
+			break;
+		}
+		total += PKTLEN(osh, pkt);
+		pkts[num] = pkt;
+	}
+	dhd_os_sdunlock_txq(bus->dhd);
+
+	if (!num)
+		return 0;
+
+	datalen = total - (num * SDPCM_HDRLEN);
+
+#ifndef SDTEST
+	if (num == 1)
+		ret = dhdsdio_txpkt(bus, pkts[0], SDPCM_DATA_CHANNEL, TRUE);
+	else
+		ret = dhdsdio_txglom(bus, pkts, num, SDPCM_DATA_CHANNEL);
+#else
+	if (num == 1)
+		ret = dhdsdio_txpkt(bus, pkts[0],
+		        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL), TRUE);
+	else
+		ret = dhdsdio_txglom(bus, pkts, num,
+		        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL));
+#endif
+	if (ret)
+		bus->dhd->tx_errors += num;
+	else
+		bus->dhd->dstats.tx_bytes += datalen;
+
+	return num;
+}
+
 static uint
 dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 {
@@ -1100,7 +1416,7 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 	uint32 intstatus = 0;
 	uint retries = 0;
 	int ret = 0, prec_out;
-	uint cnt = 0;
+	uint cnt = 0, num;
 	uint datalen;
 	uint8 tx_prec_map;
 
@@ -1112,25 +1428,32 @@ dhdsdio_sendfromq(dhd_bus_t *bus, uint maxframes)
 	tx_prec_map = ~bus->flowcontrol;
 
 	/* Send frames until the limit or some other event */
-	for (cnt = 0; (cnt < maxframes) && DATAOK(bus); cnt++) {
-		dhd_os_sdlock_txq(bus->dhd);
-		if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
+	for (cnt = 0; (cnt < maxframes) && DATAOK(bus); cnt += num) {
+		/* Combine queued frames into one transfer if enabled */
+		if (bus->txglom_enable && bus->txglom_pkt && ((maxframes - cnt) > 1)) {
+			if ((num = dhdsdio_sendglom(bus, maxframes - cnt, tx_prec_map)) == 0)
+				break;
+		} else {
+			num = 1;
+			dhd_os_sdlock_txq(bus->dhd);
+			if ((pkt = pktq_mdeq(&bus->txq, tx_prec_map, &prec_out)) == NULL) {
+				dhd_os_sdunlock_txq(bus->dhd);
+				break;
+			}
 			dhd_os_sdunlock_txq(bus->dhd);
-			break;
-		}
-		dhd_os_sdunlock_txq(bus->dhd);
-		datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
+			datalen = PKTLEN(bus->dhd->osh, pkt) - SDPCM_HDRLEN;
 
 #ifndef SDTEST
-		ret = dhdsdio_txpkt(bus, pkt, SDPCM_DATA_CHANNEL, TRUE);
+			ret = dhdsdio_txpkt(bus, pkt, SDPCM_DATA_CHANNEL, TRUE);
 #else
-		ret = dhdsdio_txpkt(bus, pkt,
-		        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL), TRUE);
+			ret = dhdsdio_txpkt(bus, pkt,
+			        (bus->ext_loop ? SDPCM_TEST_CHANNEL : SDPCM_DATA_CHANNEL), TRUE);
 #endif
-		if (ret)
-			bus->dhd->tx_errors++;
-		else
-			bus->dhd->dstats.tx_bytes += datalen;
+			if (ret)
+				bus->dhd->tx_errors++;
+			else
+				bus->dhd->dstats.tx_bytes += datalen;
+		}
 
 		/* In poll mode, need to check for other events */
 		if (!bus->intr && cnt)
@@ -1336,11 +1659,16 @@ enum {
 #ifdef SDTEST
 	IOV_PKTGEN,
 	IOV_EXTLOOP,
+	IOV_SDSINK,
 #endif /* SDTEST */
 	IOV_SPROM,
 	IOV_TXBOUND,
 	IOV_RXBOUND,
 	IOV_TXMINMAX,
+	IOV_TXGLOM,
+	IOV_TXGLOMMAX,
+	IOV_RXPOOL,
+	IOV_RXCOPYBREAK,
 	IOV_IDLETIME,
 	IOV_IDLECLOCK,
 	IOV_SD1IDLE,
@@ -1368,6 +1696,10 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 	{"txbound",	IOV_TXBOUND,	0,	IOVT_UINT32,	0 },
 	{"rxbound",	IOV_RXBOUND,	0,	IOVT_UINT32,	0 },
 	{"txminmax",	IOV_TXMINMAX,	0,	IOVT_UINT32,	0 },
+	{"txglom",	IOV_TXGLOM,	0,	IOVT_BOOL,	0 },
+	{"txglommax",	IOV_TXGLOMMAX,	0,	IOVT_UINT32,	0 },
+	{"rxpool",	IOV_RXPOOL,	0,	IOVT_UINT32,	0 },
+	{"rxcopybreak",	IOV_RXCOPYBREAK, 0,	IOVT_UINT32,	0 },
 #ifdef DHD_DEBUG
 	{"sdreg",	IOV_SDREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
 	{"sbreg",	IOV_SBREG,	0,	IOVT_BUFFER,	sizeof(sdreg_t) },
@@ -1378,6 +1710,7 @@ const bcm_iovar_t dhdsdio_iovars[] = {
 #ifdef SDTEST
 	{"extloop",	IOV_EXTLOOP,	0,	IOVT_BOOL,	0 },
 	{"pktgen",	IOV_PKTGEN,	0,	IOVT_BUFFER,	sizeof(dhd_pktgen_t) },
+	{"sdsink",	IOV_SDSINK,	0,	IOVT_BOOL,	0 },
 #endif /* SDTEST */
 
 	{NULL, 0, 0, 0, 0 }
@@ -1423,6 +1756,11 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 	            bus->fc_rcvd, bus->fc_xoff, bus->fc_xon);
 	bcm_bprintf(strbuf, "rxglomfail %d, rxglomframes %d, rxglompkts %d\n",
 	            bus->rxglomfail, bus->rxglomframes, bus->rxglompkts);
+	bcm_bprintf(strbuf, "txglom %d, txglomframes %d, txglompkts %d\n",
+	            bus->txglom_enable, bus->txglomframes, bus->txglompkts);
+	bcm_bprintf(strbuf, "rxpool %d/%d, hits %d, misses %d, recycled %d, copied %d\n",
+	            bus->rxpool_cnt, bus->rxpool_max, bus->rxpool_hits, bus->rxpool_misses,
+	            bus->rxpool_recycled, bus->rx_copied);
 	bcm_bprintf(strbuf, "f2rx (hdrs/data) %d (%d/%d), f2tx %d f1regs %d\n",
 	            (bus->f2rxhdrs + bus->f2rxdata), bus->f2rxhdrs, bus->f2rxdata,
 	            bus->f2txdata, bus->f1regdata);
@@ -1440,6 +1778,11 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 		dhd_dump_pct(strbuf, ", pkts/glom", bus->rxglompkts, bus->rxglomframes);
 		bcm_bprintf(strbuf, "\n");
 
+		dhd_dump_pct(strbuf, "Tx: glom pct", (100 * bus->txglompkts),
+		             bus->dhd->tx_packets);
+		dhd_dump_pct(strbuf, ", pkts/glom", bus->txglompkts, bus->txglomframes);
+		bcm_bprintf(strbuf, "\n");
+
 		dhd_dump_pct(strbuf, "Tx: pkts/f2wr", bus->dhd->tx_packets, bus->f2txdata);
 		dhd_dump_pct(strbuf, ", pkts/f1sd", bus->dhd->tx_packets, bus->f1regdata);
 		dhd_dump_pct(strbuf, ", pkts/sd", bus->dhd->tx_packets,
@@ -1469,6 +1812,11 @@ dhd_bus_dump(dhd_pub_t *dhdp, struct bcmstrbuf *strbuf)
 		bcm_bprintf(strbuf, "send attempts %d rcvd %d fail %d\n",
 		            bus->pktgen_sent, bus->pktgen_rcvd, bus->pktgen_fail);
 	}
+	if (bus->sdsink) {
+		bcm_bprintf(strbuf, "sdsink xfers %d frames %d badseq %d errors %d\n",
+		            bus->sink_xfers, bus->sink_frames, bus->sink_badseq,
+		            bus->sink_errors);
+	}
 #endif /* SDTEST */
 #ifdef DHD_DEBUG
 	bcm_bprintf(strbuf, "dpc_sched %d host interrupt%spending\n",
@@ -1490,6 +1838,11 @@ dhd_bus_clearcounts(dhd_pub_t *dhdp)
 	bus->tx_sderrs = bus->fc_rcvd = bus->fc_xoff = bus->fc_xon = 0;
 	bus->rxglomfail = bus->rxglomframes = bus->rxglompkts = 0;
 	bus->f2rxhdrs = bus->f2rxdata = bus->f2txdata = bus->f1regdata = 0;
+	bus->txglomframes = bus->txglompkts = 0;
+	bus->rxpool_hits = bus->rxpool_misses = bus->rxpool_recycled = bus->rx_copied = 0;
+#ifdef SDTEST
+	bus->sink_xfers = bus->sink_frames = bus->sink_badseq = bus->sink_errors = 0;
+#endif /* SDTEST */
 }
 
 #ifdef SDTEST
@@ -1970,6 +2323,57 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 	case IOV_SVAL(IOV_TXMINMAX):
 		dhd_txminmax = (uint)int_val;
 		break;
+
+	case IOV_GVAL(IOV_TXGLOM):
+		int_val = (int32)bus->txglom_enable;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXGLOM):
+		if (bool_val && !bus->txglom_pkt) {
+			bcmerror = BCME_NOMEM;
+			break;
+		}
+		bus->txglom_enable = bool_val;
+		break;
+
+	case IOV_GVAL(IOV_TXGLOMMAX):
+		int_val = (int32)bus->txglom_max;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_TXGLOMMAX):
+		if ((int_val < 1) || (int_val > DHD_TXGLOM_MAX))
+			bcmerror = BCME_RANGE;
+		else
+			bus->txglom_max = (uint)int_val;
+		break;
+
+	case IOV_GVAL(IOV_RXPOOL):
+		int_val = (int32)bus->rxpool_max;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_RXPOOL):
+		if (int_val < 0) {
+			bcmerror = BCME_RANGE;
+			break;
+		}
+		bus->rxpool_max = (uint)int_val;
+		if (bus->rxpool_cnt > bus->rxpool_max) {
+			dhdsdio_rxpool_flush(bus, bus->dhd->osh);
+			dhdsdio_rxpool_fill(bus, bus->rxpool_max);
+		}
+		break;
+
+	case IOV_GVAL(IOV_RXCOPYBREAK):
+		int_val = (int32)bus->rx_copybreak;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_RXCOPYBREAK):
+		bus->rx_copybreak = (uint)int_val;
+		break;
 #ifdef DHD_DEBUG
 
 #endif /* DHD_DEBUG */
@@ -1985,6 +2389,21 @@ dhdsdio_doiovar(dhd_bus_t *bus, const bcm_iovar_t *vi, uint32 actionid, const ch
 		bus->ext_loop = bool_val;
 		break;
 
+	case IOV_GVAL(IOV_SDSINK):
+		int_val = (int32)bus->sdsink;
+		bcopy(&int_val, arg, val_size);
+		break;
+
+	case IOV_SVAL(IOV_SDSINK):
+		if (bool_val && !bus->sdsink) {
+			bus->sink_seq = bus->tx_seq;
+			bus->tx_max = bus->tx_seq + DHD_SDSINK_WINDOW;
+		} else if (!bool_val) {
+			pktq_flush(bus->dhd->osh, &bus->sinkq, FALSE);
+		}
+		bus->sdsink = bool_val;
+		break;
+
 	case IOV_GVAL(IOV_PKTGEN):
 		bcmerror = dhdsdio_pktgen_get(bus, arg);
 		break;
@@ -2351,6 +2770,10 @@ dhd_bus_stop(struct dhd_bus *bus, bool enforce_mutex)
 
 	bus->glom = bus->glomd = NULL;
 
+#ifdef SDTEST
+	pktq_flush(osh, &bus->sinkq, FALSE);
+#endif /* SDTEST */
+
 	/* Clear rx control and wake any waiters */
 	bus->rxlen = 0;
 	dhd_os_ioctl_resp_wake(bus->dhd);
@@ -2630,7 +3053,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 	uint8 *dptr, num = 0;
 
 	uint16 sublen, check;
-	void *pfirst, *plast, *pnext, *save_pfirst;
+	void *pfirst, *plast, *pnext, *pnew, *save_pfirst;
 	osl_t *osh = bus->dhd->osh;
 
 	int errcode;
@@ -2684,7 +3107,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			}
 
 			/* Allocate/chain packet for next subframe */
-			if ((pnext = PKTGET(osh, sublen + DHD_SDALIGN, FALSE)) == NULL) {
+			if ((pnext = dhdsdio_rxpkt_get(bus, sublen + DHD_SDALIGN)) == NULL) {
 				DHD_ERROR(("%s: PKTGET failed, num %d len %d\n",
 				           __FUNCTION__, num, sublen));
 				break;
@@ -2718,13 +3141,13 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			pfirst = pnext = NULL;
 		} else {
 			if (pfirst)
-				PKTFREE(osh, pfirst, FALSE);
+				dhdsdio_rxpkt_put(bus, pfirst);
 			bus->glom = NULL;
 			num = 0;
 		}
 
 		/* Done with descriptor packet */
-		PKTFREE(osh, bus->glomd, FALSE);
+		dhdsdio_rxpkt_put(bus, bus->glomd);
 		bus->glomd = NULL;
 		bus->nextlen = 0;
 
@@ -2785,7 +3208,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 				bus->glomerr = 0;
 				dhdsdio_rxfail(bus, TRUE, FALSE);
 				dhd_os_sdlock_rxq(bus->dhd);
-				PKTFREE(osh, bus->glom, FALSE);
+				dhdsdio_rxpkt_put(bus, bus->glom);
 				dhd_os_sdunlock_rxq(bus->dhd);
 				bus->rxglomfail++;
 				bus->glom = NULL;
@@ -2907,7 +3330,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 				bus->glomerr = 0;
 				dhdsdio_rxfail(bus, TRUE, FALSE);
 				dhd_os_sdlock_rxq(bus->dhd);
-				PKTFREE(osh, bus->glom, FALSE);
+				dhdsdio_rxpkt_put(bus, bus->glom);
 				dhd_os_sdunlock_rxq(bus->dhd);
 				bus->rxglomfail++;
 				bus->glom = NULL;
@@ -2955,7 +3378,7 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 			PKTPULL(osh, pfirst, doff);
 
 			if (PKTLEN(osh, pfirst) == 0) {
-				PKTFREE(bus->dhd->osh, pfirst, FALSE);
+				dhdsdio_rxpkt_put(bus, pfirst);
 				if (plast) {
 					PKTSETNEXT(osh, plast, pnext);
 				} else {
@@ -2963,10 +3386,21 @@ dhdsdio_rxglom(dhd_bus_t *bus, uint8 rxseq)
 					save_pfirst = pnext;
 				}
 				continue;
-			} else if (dhd_prot_hdrpull(bus->dhd, &ifidx, pfirst) != 0) {
+			}
+
+			/* Copy small subframes out so the buffer can be recycled */
+			if ((pnew = dhdsdio_rxcopybreak(bus, pfirst)) != pfirst) {
+				if (plast)
+					PKTSETNEXT(osh, plast, pnew);
+				else
+					save_pfirst = pnew;
+				pfirst = pnew;
+			}
+
+			if (dhd_prot_hdrpull(bus->dhd, &ifidx, pfirst) != 0) {
 				DHD_ERROR(("%s: rx protocol error\n", dhd_ifname(bus->dhd, ifidx)));
 				bus->dhd->rx_errors++;
-				PKTFREE(osh, pfirst, FALSE);
+				dhdsdio_rxpkt_put(bus, pfirst);
 				if (plast) {
 					PKTSETNEXT(osh, plast, pnext);
 				} else {
@@ -3094,7 +3528,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 			 */
 			/* Allocate a packet buffer */
 			dhd_os_sdlock_rxq(bus->dhd);
-			if (!(pkt = PKTGET(osh, rdlen + DHD_SDALIGN, FALSE))) {
+			if (!(pkt = dhdsdio_rxpkt_get(bus, rdlen + DHD_SDALIGN))) {
 				if (bus->bus == SPI_BUS) {
 					bus->usebufpool = FALSE;
 					bus->rxctl = bus->rxbuf;
@@ -3150,7 +3584,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 				if (sdret < 0) {
 					DHD_ERROR(("%s (nextlen): read %d bytes failed: %d\n",
 					   __FUNCTION__, rdlen, sdret));
-					PKTFREE(bus->dhd->osh, pkt, FALSE);
+					dhdsdio_rxpkt_put(bus, pkt);
 					bus->dhd->rx_errors++;
 					dhd_os_sdunlock_rxq(bus->dhd);
 					/* Force retry w/normal header read.  Don't attemp NAK for
@@ -3288,7 +3722,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 					dhdsdio_read_control(bus, rxbuf, len, doff);
 					if (bus->usebufpool) {
 						dhd_os_sdlock_rxq(bus->dhd);
-						PKTFREE(bus->dhd->osh, pkt, FALSE);
+						dhdsdio_rxpkt_put(bus, pkt);
 						dhd_os_sdunlock_rxq(bus->dhd);
 					}
 					continue;
@@ -3467,7 +3901,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 		}
 
 		dhd_os_sdlock_rxq(bus->dhd);
-		if (!(pkt = PKTGET(osh, (rdlen + firstread + DHD_SDALIGN), FALSE))) {
+		if (!(pkt = dhdsdio_rxpkt_get(bus, (rdlen + firstread + DHD_SDALIGN)))) {
 			/* Give up on data, request rtx of events */
 			DHD_ERROR(("%s: PKTGET failed: rdlen %d chan %d\n",
 			           __FUNCTION__, rdlen, chan));
@@ -3496,7 +3930,7 @@ dhdsdio_readframes(dhd_bus_t *bus, uint maxframes, bool *finished)
 			           ((chan == SDPCM_EVENT_CHANNEL) ? "event" :
 			            ((chan == SDPCM_DATA_CHANNEL) ? "data" : "test")), sdret));
 			dhd_os_sdlock_rxq(bus->dhd);
-			PKTFREE(bus->dhd->osh, pkt, FALSE);
+			dhdsdio_rxpkt_put(bus, pkt);
 			dhd_os_sdunlock_rxq(bus->dhd);
 			bus->dhd->rx_errors++;
 			dhdsdio_rxfail(bus, TRUE, RETRYCHAN(chan));
@@ -3549,13 +3983,20 @@ deliver:
 
 		if (PKTLEN(osh, pkt) == 0) {
 			dhd_os_sdlock_rxq(bus->dhd);
-			PKTFREE(bus->dhd->osh, pkt, FALSE);
+			dhdsdio_rxpkt_put(bus, pkt);
 			dhd_os_sdunlock_rxq(bus->dhd);
 			continue;
-		} else if (dhd_prot_hdrpull(bus->dhd, &ifidx, pkt) != 0) {
+		}
+
+		/* Copy small frames out so the buffer can be recycled */
+		dhd_os_sdlock_rxq(bus->dhd);
+		pkt = dhdsdio_rxcopybreak(bus, pkt);
+		dhd_os_sdunlock_rxq(bus->dhd);
+
+		if (dhd_prot_hdrpull(bus->dhd, &ifidx, pkt) != 0) {
 			DHD_ERROR(("%s: rx protocol error\n", dhd_ifname(bus->dhd, ifidx)));
 			dhd_os_sdlock_rxq(bus->dhd);
-			PKTFREE(bus->dhd->osh, pkt, FALSE);
+			dhdsdio_rxpkt_put(bus, pkt);
 			dhd_os_sdunlock_rxq(bus->dhd);
 			bus->dhd->rx_errors++;
 			continue;
@@ -3942,6 +4383,24 @@ dhdsdio_pktgen_init(dhd_bus_t *bus)
 	bus->pktgen_stop = 1;
 }
 
+/* Send a burst of generated frames as one tx superframe */
+static void
+dhdsdio_pktgen_glom(dhd_bus_t *bus, void **pkts, uint num)
+{
+	int ret;
+
+	if (num == 1)
+		ret = dhdsdio_txpkt(bus, pkts[0], SDPCM_TEST_CHANNEL, TRUE);
+	else
+		ret = dhdsdio_txglom(bus, pkts, num, SDPCM_TEST_CHANNEL);
+
+	if (ret) {
+		bus->pktgen_fail += num;
+		if (bus->pktgen_stop && (bus->pktgen_fail >= bus->pktgen_stop))
+			bus->pktgen_count = 0;
+	}
+}
+
 static void
 dhdsdio_pktgen(dhd_bus_t *bus)
 {
@@ -3951,6 +4410,9 @@ dhdsdio_pktgen(dhd_bus_t *bus)
 	uint fillbyte;
 	osl_t *osh = bus->dhd->osh;
 	uint16 len;
+	void *pkts[DHD_TXGLOM_MAX];
+	uint num = 0, glomlen = 0;
+	bool glom = (bus->txglom_enable && bus->txglom_pkt);
 
 	/* Display current count if appropriate */
 	if (bus->pktgen_print && (++bus->pktgen_ptick >= bus->pktgen_print)) {
@@ -4023,8 +4485,16 @@ dhdsdio_pktgen(dhd_bus_t *bus)
 		}
 #endif
 
-		/* Send it */
-		if (dhdsdio_txpkt(bus, pkt, SDPCM_TEST_CHANNEL, TRUE)) {
+		/* Send it, or collect it into a tx superframe */
+		if (glom) {
+			if (num && ((num == bus->txglom_max) ||
+			            ((glomlen + PKTLEN(osh, pkt)) > DHD_TXGLOM_BUFSZ))) {
+				dhdsdio_pktgen_glom(bus, pkts, num);
+				num = glomlen = 0;
+			}
+			glomlen += PKTLEN(osh, pkt);
+			pkts[num++] = pkt;
+		} else if (dhdsdio_txpkt(bus, pkt, SDPCM_TEST_CHANNEL, TRUE)) {
 			bus->pktgen_fail++;
 			if (bus->pktgen_stop && bus->pktgen_stop == bus->pktgen_fail)
 				bus->pktgen_count = 0;
@@ -4039,6 +4509,9 @@ dhdsdio_pktgen(dhd_bus_t *bus)
 		if (bus->pktgen_mode == DHD_PKTGEN_RXBURST)
 			break;
 	}
+
+	if (num)
+		dhdsdio_pktgen_glom(bus, pkts, num);
 }
 
 static void
@@ -4083,7 +4556,7 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 	/* Check for min length */
 	if ((pktlen = PKTLEN(osh, pkt)) < SDPCM_TEST_HDRLEN) {
 		DHD_ERROR(("dhdsdio_restrcv: toss runt frame, pktlen %d\n", pktlen));
-		PKTFREE(osh, pkt, FALSE);
+		dhdsdio_rxpkt_put(bus, pkt);
 		return;
 	}
 
@@ -4098,7 +4571,7 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 		if (pktlen != len + SDPCM_TEST_HDRLEN) {
 			DHD_ERROR(("dhdsdio_testrcv: frame length mismatch, pktlen %d seq %d"
 			           " cmd %d extra %d len %d\n", pktlen, seq, cmd, extra, len));
-			PKTFREE(osh, pkt, FALSE);
+			dhdsdio_rxpkt_put(bus, pkt);
 			return;
 		}
 	}
@@ -4108,18 +4581,18 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 	case SDPCM_TEST_ECHOREQ:
 		/* Rx->Tx turnaround ok (even on NDIS w/current implementation) */
 		*(uint8 *)(PKTDATA(osh, pkt)) = SDPCM_TEST_ECHORSP;
+		/* dhdsdio_txpkt() frees the packet either way */
 		if (dhdsdio_txpkt(bus, pkt, SDPCM_TEST_CHANNEL, TRUE) == 0) {
 			bus->pktgen_sent++;
 		} else {
 			bus->pktgen_fail++;
-			PKTFREE(osh, pkt, FALSE);
 		}
 		bus->pktgen_rcvd++;
 		break;
 
 	case SDPCM_TEST_ECHORSP:
 		if (bus->ext_loop) {
-			PKTFREE(osh, pkt, FALSE);
+			dhdsdio_rxpkt_put(bus, pkt);
 			bus->pktgen_rcvd++;
 			break;
 		}
@@ -4132,12 +4605,12 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 				break;
 			}
 		}
-		PKTFREE(osh, pkt, FALSE);
+		dhdsdio_rxpkt_put(bus, pkt);
 		bus->pktgen_rcvd++;
 		break;
 
 	case SDPCM_TEST_DISCARD:
-		PKTFREE(osh, pkt, FALSE);
+		dhdsdio_rxpkt_put(bus, pkt);
 		bus->pktgen_rcvd++;
 		break;
 
@@ -4146,7 +4619,7 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 	default:
 		DHD_INFO(("dhdsdio_testrcv: unsupported or unknown command, pktlen %d seq %d"
 		          " cmd %d extra %d len %d\n", pktlen, seq, cmd, extra, len));
-		PKTFREE(osh, pkt, FALSE);
+		dhdsdio_rxpkt_put(bus, pkt);
 		break;
 	}
 
@@ -4158,6 +4631,82 @@ dhdsdio_testrcv(dhd_bus_t *bus, void *pkt, uint seq)
 		}
 	}
 }
+
+/* Software stand-in for the dongle end of F2 writes ("sdsink" iovar).  Walks
+ * each transfer frame by frame the way the dongle does, checks the framing
+ * and sequence numbers, grants tx credit, and turns test-channel echo
+ * requests around onto sinkq.  Together with pktgen this exercises tx
+ * glomming and the rx pool without firmware.  Register accesses and
+ * control frames are not emulated.  Caller holds the SDIO lock.
+ */
+static int
+dhdsdio_sdsink(dhd_bus_t *bus, uint8 *buf, uint nbytes)
+{
+	osl_t *osh = bus->dhd->osh;
+	uint8 *frame;
+	uint16 len, check;
+	uint8 chan, seq, doff;
+	uint off;
+	void *pkt;
+
+	bus->sink_xfers++;
+
+	for (off = 0; (off + SDPCM_HDRLEN) <= nbytes; off += len) {
+		frame = buf + off;
+		len = ltoh16_ua(frame);
+		check = ltoh16_ua(frame + sizeof(uint16));
+
+		/* Zero tag marks the padding after the last frame */
+		if (!len && !check)
+			break;
+
+		chan = SDPCM_PACKET_CHANNEL(&frame[SDPCM_FRAMETAG_LEN]);
+		seq = SDPCM_PACKET_SEQUENCE(&frame[SDPCM_FRAMETAG_LEN]);
+		doff = SDPCM_DOFFSET_VALUE(&frame[SDPCM_FRAMETAG_LEN]);
+
+		if ((uint16)~(len ^ check) || (len < SDPCM_HDRLEN) || ((off + len) > nbytes) ||
+		    (doff < SDPCM_HDRLEN) || (doff > len)) {
+			DHD_ERROR(("%s: bad frame at offset %d of %d: len 0x%04x check 0x%04x "
+			           "doff %d\n", __FUNCTION__, off, nbytes, len, check, doff));
+			bus->sink_errors++;
+			return BCME_ERROR;
+		}
+
+		if (seq != bus->sink_seq) {
+			DHD_INFO(("%s: tx seq %d, expected %d\n", __FUNCTION__, seq, bus->sink_seq));
+			bus->sink_badseq++;
+		}
+		bus->sink_seq = seq + 1;
+		bus->sink_frames++;
+
+		/* Offer a fixed window beyond the last frame consumed */
+		bus->tx_max = (uint8)(seq + 1 + DHD_SDSINK_WINDOW);
+
+		if ((chan != SDPCM_TEST_CHANNEL) || ((len - doff) < SDPCM_TEST_HDRLEN) ||
+		    (frame[doff] != SDPCM_TEST_ECHOREQ))
+			continue;
+
+		if (pktq_full(&bus->sinkq) || !(pkt = dhdsdio_rxpkt_get(bus, len - doff))) {
+			bus->dhd->rx_dropped++;
+			continue;
+		}
+		bcopy(frame + doff, PKTDATA(osh, pkt), len - doff);
+		*(uint8 *)PKTDATA(osh, pkt) = SDPCM_TEST_ECHORSP;
+		pktenq(&bus->sinkq, pkt);
+	}
+
+	return 0;
+}
+
+/* Deliver the echo responses queued by dhdsdio_sdsink() */
+static void
+dhdsdio_sdsink_rx(dhd_bus_t *bus)
+{
+	void *pkt;
+
+	while ((pkt = pktdeq(&bus->sinkq)))
+		dhdsdio_testrcv(bus, pkt, bus->rx_seq);
+}
 #endif /* SDTEST */
 
 extern bool
@@ -4212,7 +4761,15 @@ dhd_bus_watchdog(dhd_pub_t *dhdp)
 		bus->lastintrs = bus->intrcount;
 	}
 
+	/* Top up the rx buffer pool outside the receive path */
+	if (bus->rxpool_cnt < bus->rxpool_max)
+		dhdsdio_rxpool_fill(bus, DHD_RXPOOL_FILL);
+
 #ifdef SDTEST
+	/* Deliver frames turned around by the software bus stand-in */
+	if (bus->sdsink)
+		dhdsdio_sdsink_rx(bus);
+
 	/* Generate packets if configured */
 	if (bus->pktgen_count && (++bus->pktgen_tick >= bus->pktgen_freq)) {
 		/* Make sure backplane clock is on */
@@ -4567,6 +5124,9 @@ dhdsdio_probe_attach(struct dhd_bus *bus, osl_t *osh, void *sdh, void *regsva,
 	OR_REG(osh, &bus->regs->corecontrol, CC_BPRESEN);
 
 	pktq_init(&bus->txq, (PRIOMASK+1), QLEN);
+#ifdef SDTEST
+	pktq_init(&bus->sinkq, 1, QLEN);
+#endif /* SDTEST */
 
 	/* Locate an appropriately-aligned portion of hdrbuf */
 	bus->rxhdr = (uint8*)ROUNDUP((uintptr)&bus->hdrbuf[0], DHD_SDALIGN);
@@ -4611,6 +5171,20 @@ dhdsdio_probe_malloc(dhd_bus_t *bus, osl_t *osh, void *sdh)
 	else
 		bus->dataptr = bus->databuf;
 
+	/* Buffer for tx superframes; glomming is simply unavailable without it */
+	if ((bus->txglom_pkt = PKTGET(osh, DHD_TXGLOM_PKTSZ, TRUE)))
+		bus->txglom_headroom = PKTHEADROOM(osh, bus->txglom_pkt);
+	else
+		DHD_ERROR(("%s: PKTGET of %d-byte txglom buffer failed\n",
+		           __FUNCTION__, DHD_TXGLOM_PKTSZ));
+	bus->txglom_enable = (dhd_txglom && bus->txglom_pkt);
+	bus->txglom_max = DHD_TXGLOM_MAX;
+
+	/* Prime the rx buffer pool */
+	bus->rxpool_max = DHD_RXPOOL_MAX;
+	bus->rx_copybreak = DHD_RX_COPYBREAK;
+	dhdsdio_rxpool_fill(bus, bus->rxpool_max);
+
 	return TRUE;
 
 fail:
@@ -4766,6 +5340,14 @@ dhdsdio_release_malloc(dhd_bus_t *bus, osl_t *osh)
 		MFREE(osh, bus->databuf, MAX_DATA_BUF);
 		bus->databuf = NULL;
 	}
+
+	if (bus->txglom_pkt) {
+		PKTFREE(osh, bus->txglom_pkt, TRUE);
+		bus->txglom_pkt = NULL;
+		bus->txglom_enable = FALSE;
+	}
+
+	dhdsdio_rxpool_flush(bus, osh);
 }
 
 
@@ -5142,6 +5724,10 @@ static int
 dhd_bcmsdh_send_buf(dhd_bus_t *bus, uint32 addr, uint fn, uint flags, uint8 *buf, uint nbytes,
 	void *pkt, bcmsdh_cmplt_fn_t complete, void *handle)
 {
+#ifdef SDTEST
+	if (bus->sdsink && (fn == SDIO_FUNC_2))
+		return dhdsdio_sdsink(bus, buf, nbytes);
+#endif /* SDTEST */
 	return (bcmsdh_send_buf(bus->sdh, addr, fn, flags, buf, nbytes, pkt, complete, handle));
 }
 
@@ -243,6 +243,7 @@ extern void osl_dma_unmap(osl_t *osh, uint pa, uint size, int direction);
 #define	PKTPUSH(osh, skb, bytes)	skb_push((struct sk_buff*)(skb), (bytes))
 #define	PKTPULL(osh, skb, bytes)	skb_pull((struct sk_buff*)(skb), (bytes))
 #define	PKTDUP(osh, skb)		osl_pktdup((osh), (skb))
+#define	PKTRESET(osh, skb, hr, len)	osl_pktreset((osh), (skb), (hr), (len))
 #define	PKTTAG(skb)			((void*)(((struct sk_buff*)(skb))->cb))
 #define PKTALLOCED(osh)			((osl_pubinfo_t *)(osh))->pktalloced
 #define PKTLIST_DUMP(osh, buf)
@@ -250,6 +251,7 @@ extern void osl_dma_unmap(osl_t *osh, uint pa, uint size, int direction);
 extern void *osl_pktget(osl_t *osh, uint len);
 extern void osl_pktfree(osl_t *osh, void *skb, bool send);
 extern void *osl_pktdup(osl_t *osh, void *skb);
+extern bool osl_pktreset(osl_t *osh, void *skb, uint headroom, uint len);
 
 
 
@@ -219,6 +219,31 @@ osl_pktfree(osl_t *osh, void *p, bool send)
 	}
 }
 
+
+bool
+osl_pktreset(osl_t *osh, void *p, uint headroom, uint len)
+{
+	struct sk_buff *skb = (struct sk_buff*) p;
+
+	if (skb_cloned(skb) || skb_shared(skb) || skb_is_nonlinear(skb))
+		return FALSE;
+
+	if ((skb->head + headroom + len) > skb_end_pointer(skb))
+		return FALSE;
+
+	skb->data = skb->head + headroom;
+	skb->len = 0;
+	skb_reset_tail_pointer(skb);
+	skb_put(skb, len);
+	skb->priority = 0;
+	skb->next = skb->prev = NULL;
+
+	if (osh->pub.pkttag)
+		bzero((void*)skb->cb, OSL_PKTTAG_SZ);
+
+	return TRUE;
+}
+
 uint32
 osl_pci_read_config(osl_t *osh, uint offset, uint size)
 {
@@ -25,6 +25,9 @@
 #include <linux/wait.h>
 #include <linux/err.h>
 #include <linux/interrupt.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/sched.h>
 
 #include <linux/types.h>
 #include <linux/device.h>
@@ -36,11 +39,31 @@
 
 #include "f_adb.h"
 
-#define BULK_BUFFER_SIZE           4096
+#define BULK_BUFFER_SIZE           16384
 
 /* number of rx and tx requests to allocate */
-#define RX_REQ_MAX 4
-#define TX_REQ_MAX 4
+#define RX_REQ_MAX 8
+#define TX_REQ_MAX 8
+
+/* how many user pages a zero-copy write pins at a time */
+#define ZERO_COPY_PAGES 64
+
+static unsigned adb_rx_reqs = RX_REQ_MAX;
+module_param(adb_rx_reqs, uint, S_IRUGO);
+MODULE_PARM_DESC(adb_rx_reqs, "number of adb rx requests");
+
+static unsigned adb_tx_reqs = TX_REQ_MAX;
+module_param(adb_tx_reqs, uint, S_IRUGO);
+MODULE_PARM_DESC(adb_tx_reqs, "number of adb tx requests");
+
+static unsigned adb_buflen = BULK_BUFFER_SIZE;
+module_param(adb_buflen, uint, S_IRUGO);
+MODULE_PARM_DESC(adb_buflen, "size of each adb request buffer, whole pages");
+
+static unsigned adb_zero_copy_min = 4 * PAGE_SIZE;
+module_param(adb_zero_copy_min, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(adb_zero_copy_min,
+		"smallest write sent from user pages, 0 to always copy");
 
 static const char shortname[] = "android_adb";
 
@@ -62,6 +85,11 @@ struct adb_dev {
 	struct list_head rx_idle;
 	struct list_head rx_done;
 
+	/* size of the request buffers, adb_buflen rounded to whole pages */
+	unsigned buf_size;
+	/* tx requests queued from user pages and not completed yet */
+	atomic_t tx_zero_copy;
+
 	wait_queue_head_t read_wq;
 	wait_queue_head_t write_wq;
 
@@ -152,6 +180,8 @@ static struct usb_request *adb_request_new(struct usb_ep *ep, int buffer_size)
 		usb_ep_free_request(ep, req);
 		return NULL;
 	}
+	/* a zero-copy write points buf elsewhere; this is where it goes back */
+	req->context = req->buf;
 
 	return req;
 }
@@ -210,11 +240,15 @@ struct usb_request *req_get(struct adb_dev *dev, struct list_head *head)
 static void adb_complete_in(struct usb_ep *ep, struct usb_request *req)
 {
 	struct adb_dev *dev = _adb_dev;
+	int zero_copy = (req->buf != req->context);
 
 	if (req->status != 0)
 		dev->error = 1;
 
+	req->buf = req->context;
 	req_put(dev, &dev->tx_idle, req);
+	if (zero_copy)
+		atomic_dec(&dev->tx_zero_copy);
 
 	wake_up(&dev->write_wq);
 }
@@ -261,16 +295,17 @@ static int __init create_bulk_endpoints(struct adb_dev *dev,
 	dev->ep_out = ep;
 
 	/* now allocate requests for our endpoints */
-	for (i = 0; i < RX_REQ_MAX; i++) {
-		req = adb_request_new(dev->ep_out, BULK_BUFFER_SIZE);
+	dev->buf_size = max_t(unsigned, PAGE_ALIGN(adb_buflen), PAGE_SIZE);
+	for (i = 0; i < max_t(unsigned, adb_rx_reqs, 1); i++) {
+		req = adb_request_new(dev->ep_out, dev->buf_size);
 		if (!req)
 			goto fail;
 		req->complete = adb_complete_out;
 		req_put(dev, &dev->rx_idle, req);
 	}
 
-	for (i = 0; i < TX_REQ_MAX; i++) {
-		req = adb_request_new(dev->ep_in, BULK_BUFFER_SIZE);
+	for (i = 0; i < max_t(unsigned, adb_tx_reqs, 1); i++) {
+		req = adb_request_new(dev->ep_in, dev->buf_size);
 		if (!req)
 			goto fail;
 		req->complete = adb_complete_in;
@@ -319,7 +354,7 @@ static ssize_t adb_read(struct file *fp, char __user *buf,
 		/* if we have idle read requests, get them queued */
 		while ((req = req_get(dev, &dev->rx_idle))) {
 requeue_req:
-			req->length = BULK_BUFFER_SIZE;
+			req->length = dev->buf_size;
 			ret = usb_ep_queue(dev->ep_out, req, GFP_ATOMIC);
 
 			if (ret < 0) {
@@ -386,6 +421,124 @@ fail:
 	return r;
 }
 
+/*
+ * Send a write straight from the caller's pages rather than copying it
+ * into the tx buffers.  Each request covers a physically contiguous run of
+ * the pages, spanning no more pages than a tx buffer does, so that the
+ * controller sees nothing it would not see from the copying path.  The
+ * buffer must start on a packet boundary: every request but the last then
+ * ends on a page boundary and is a whole number of packets, and the host
+ * does not get a short packet in the middle of a message.
+ *
+ * Returns how much was sent, which is less than count (possibly 0) if part
+ * of the buffer is in highmem or cannot be pinned, or a negative error.
+ * The rest is left to the copying path.
+ */
+static ssize_t adb_write_zero_copy(struct adb_dev *dev,
+				   const char __user *buf, size_t count)
+{
+	struct page *pages[ZERO_COPY_PAGES];
+	struct usb_request *queued[ZERO_COPY_PAGES];
+	struct usb_request *req;
+	unsigned long start = (unsigned long)buf;
+	unsigned maxpacket = dev->ep_in->maxpacket;
+	unsigned off, len;
+	int nr_pages, nr_queued, lowmem, first, i;
+	ssize_t sent = 0;
+	int ret = 0;
+
+	if (!maxpacket || start % maxpacket)
+		return 0;
+
+	while (count > 0) {
+		off = start & ~PAGE_MASK;
+		nr_pages = min_t(size_t, ZERO_COPY_PAGES,
+				 (off + count + PAGE_SIZE - 1) >> PAGE_SHIFT);
+
+		down_read(&current->mm->mmap_sem);
+		nr_pages = get_user_pages(current, current->mm,
+					  start & PAGE_MASK, nr_pages, 0, 0,
+					  pages, NULL);
+		up_read(&current->mm->mmap_sem);
+		if (nr_pages <= 0)
+			break;
+
+		/* requests need a kernel address; stop at the first highmem page */
+		for (lowmem = 0; lowmem < nr_pages; lowmem++)
+			if (PageHighMem(pages[lowmem]))
+				break;
+
+		nr_queued = 0;
+		for (first = 0; first < lowmem && count > 0; first = i) {
+			len = PAGE_SIZE - off;
+			for (i = first + 1; i < lowmem; i++) {
+				if (len >= count ||
+				    off + len + PAGE_SIZE > dev->buf_size ||
+				    page_to_pfn(pages[i]) !=
+				    page_to_pfn(pages[i - 1]) + 1)
+					break;
+				len += PAGE_SIZE;
+			}
+			if (len > count)
+				len = count;
+
+			req = 0;
+			ret = wait_event_interruptible(dev->write_wq,
+				((req = req_get(dev, &dev->tx_idle)) ||
+				 dev->error));
+			if (ret < 0 || dev->error) {
+				if (req)
+					req_put(dev, &dev->tx_idle, req);
+				if (ret == 0)
+					ret = -EIO;
+				break;
+			}
+
+			req->buf = page_address(pages[first]) + off;
+			req->length = len;
+			atomic_inc(&dev->tx_zero_copy);
+			ret = usb_ep_queue(dev->ep_in, req, GFP_ATOMIC);
+			if (ret < 0) {
+				req->buf = req->context;
+				req_put(dev, &dev->tx_idle, req);
+				atomic_dec(&dev->tx_zero_copy);
+				dev->error = 1;
+				ret = -EIO;
+				break;
+			}
+			queued[nr_queued++] = req;
+
+			sent += len;
+			start += len;
+			count -= len;
+			off = 0;
+		}
+
+		/*
+		 * The controller may still be reading the pages.  If the host
+		 * stops reading, a signal takes the requests back rather than
+		 * leaving the writer stuck with the pages pinned.
+		 */
+		if (wait_event_interruptible(dev->write_wq,
+				atomic_read(&dev->tx_zero_copy) == 0)) {
+			for (i = 0; i < nr_queued; i++)
+				usb_ep_dequeue(dev->ep_in, queued[i]);
+			wait_event(dev->write_wq,
+				   atomic_read(&dev->tx_zero_copy) == 0);
+			ret = -EINTR;
+		}
+		for (i = 0; i < nr_pages; i++)
+			page_cache_release(pages[i]);
+
+		if (ret < 0)
+			return ret;
+		if (lowmem < nr_pages)
+			break;
+	}
+
+	return sent;
+}
+
 static ssize_t adb_write(struct file *fp, const char __user *buf,
 				 size_t count, loff_t *pos)
 {
@@ -400,6 +553,17 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 	if (_lock(&dev->write_excl))
 		return -EBUSY;
 
+	if (adb_zero_copy_min && count >= adb_zero_copy_min && !dev->error) {
+		ret = adb_write_zero_copy(dev, buf, count);
+		if (ret < 0) {
+			r = ret;
+			count = 0;
+		} else {
+			buf += ret;
+			count -= ret;
+		}
+	}
+
 	while (count > 0) {
 		if (dev->error) {
 			DBG(cdev, "adb_write dev->error\n");
@@ -418,8 +582,8 @@ static ssize_t adb_write(struct file *fp, const char __user *buf,
 		}
 
 		if (req != 0) {
-			if (count > BULK_BUFFER_SIZE)
-				xfer = BULK_BUFFER_SIZE;
+			if (count > dev->buf_size)
+				xfer = dev->buf_size;
 			else
 				xfer = count;
 			if (copy_from_user(req->buf, buf, xfer)) {
@@ -611,6 +775,7 @@ int __init adb_function_add(struct usb_configuration *c)
 	atomic_set(&dev->open_excl, 0);
 	atomic_set(&dev->read_excl, 0);
 	atomic_set(&dev->write_excl, 0);
+	atomic_set(&dev->tx_zero_copy, 0);
 
 	INIT_LIST_HEAD(&dev->rx_idle);
 	INIT_LIST_HEAD(&dev->rx_done);
@@ -58,7 +58,9 @@
 #include <linux/fs.h>
 #include <linux/kref.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/limits.h>
+#include <linux/pagemap.h>
 #include <linux/rwsem.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
@@ -77,7 +79,7 @@
 #include "gadget_chips.h"
 
 
-#define BULK_BUFFER_SIZE           4096
+#define BULK_BUFFER_SIZE           16384
 
 /*-------------------------------------------------------------------------*/
 
@@ -222,6 +224,14 @@ struct bulk_cs_wrap {
 
 /*-------------------------------------------------------------------------*/
 
+/* Where the time of the data phases went, for one direction */
+struct lun_io_stats {
+	unsigned long	commands;
+	u64		bytes;
+	u64		file_ns;	/* reading or writing the backing file */
+	u64		usb_ns;		/* waiting for the host */
+};
+
 struct lun {
 	struct file	*filp;
 	loff_t		file_length;
@@ -236,6 +246,12 @@ struct lun {
 	u32		sense_data_info;
 	u32		unit_attention_data;
 
+	/* written since writeback was last started */
+	u32		unflushed;
+
+	struct lun_io_stats	read_stats;
+	struct lun_io_stats	write_stats;
+
 	struct device	dev;
 };
 
@@ -251,8 +267,24 @@ static struct lun *dev_to_lun(struct device *dev)
 #define EP0_BUFSIZE	256
 #define DELAYED_STATUS	(EP0_BUFSIZE + 999)	/* An impossibly large value */
 
-/* Number of buffers we will use.  2 is enough for double-buffering */
-#define NUM_BUFFERS	2
+/* Number of buffers we will use by default.  2 is enough for
+ * double-buffering; more keep several transfers queued while the thread
+ * is busy with the backing file. */
+#define NUM_BUFFERS	4
+#define MAX_NUM_BUFFERS	32
+
+static unsigned ums_num_buffers = NUM_BUFFERS;
+module_param(ums_num_buffers, uint, S_IRUGO);
+MODULE_PARM_DESC(ums_num_buffers, "number of mass storage buffers, 2 to 32");
+
+static unsigned ums_buflen = BULK_BUFFER_SIZE;
+module_param(ums_buflen, uint, S_IRUGO);
+MODULE_PARM_DESC(ums_buflen, "size of each mass storage buffer, whole pages");
+
+static unsigned ums_writeback_kb = 512;
+module_param(ums_writeback_kb, uint, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(ums_writeback_kb,
+		"start writeback after this many KB are written, 0 for never");
 
 enum fsg_buffer_state {
 	BUF_STATE_EMPTY = 0,
@@ -332,7 +364,8 @@ struct fsg_dev {
 
 	struct fsg_buffhd	*next_buffhd_to_fill;
 	struct fsg_buffhd	*next_buffhd_to_drain;
-	struct fsg_buffhd	buffhds[NUM_BUFFERS];
+	struct fsg_buffhd	*buffhds;
+	unsigned int		num_buffers;
 
 	int			thread_wakeup_needed;
 	struct completion	thread_notifier;
@@ -745,6 +778,40 @@ static int sleep_thread(struct fsg_dev *fsg)
 
 /*-------------------------------------------------------------------------*/
 
+static void add_time(u64 *ns, ktime_t start)
+{
+	*ns += ktime_to_ns(ktime_sub(ktime_get(), start));
+}
+
+/* Get all of a READ command on its way from the backing file up front, so
+ * that reading the later buffers overlaps sending the earlier ones rather
+ * than each file read waiting for its own I/O. */
+static void start_readahead(struct lun *curlun, loff_t offset, u32 length)
+{
+	struct file	*filp = curlun->filp;
+	pgoff_t		first, last;
+
+	if (offset >= curlun->file_length)
+		return;
+	if (length > curlun->file_length - offset)
+		length = curlun->file_length - offset;
+	first = offset >> PAGE_CACHE_SHIFT;
+	last = (offset + length - 1) >> PAGE_CACHE_SHIFT;
+	page_cache_sync_readahead(filp->f_mapping, &filp->f_ra, filp,
+			first, last - first + 1);
+}
+
+/* Start writing back what the host has written, without waiting for it, so
+ * that the card is kept busy instead of dirty pages piling up until the
+ * thread is throttled in the middle of a transfer. */
+static void start_writeback(struct lun *curlun)
+{
+	if (!ums_writeback_kb || curlun->unflushed < ums_writeback_kb << 10)
+		return;
+	curlun->unflushed = 0;
+	filemap_flush(curlun->filp->f_mapping);
+}
+
 static int do_read(struct fsg_dev *fsg)
 {
 	struct lun		*curlun = fsg->curlun;
@@ -756,6 +823,7 @@ static int do_read(struct fsg_dev *fsg)
 	unsigned int		amount;
 	unsigned int		partial_page;
 	ssize_t			nread;
+	ktime_t			start;
 
 	/* Get the starting Logical Block Address and check that it's
 	 * not too big */
@@ -783,6 +851,11 @@ static int do_read(struct fsg_dev *fsg)
 	if (unlikely(amount_left == 0))
 		return -EIO;		/* No default reply */
 
+	curlun->read_stats.commands++;
+	start = ktime_get();
+	start_readahead(curlun, file_offset, amount_left);
+	add_time(&curlun->read_stats.file_ns, start);
+
 	for (;;) {
 
 		/* Figure out how much we need to read:
@@ -804,11 +877,13 @@ static int do_read(struct fsg_dev *fsg)
 
 		/* Wait for the next buffer to become available */
 		bh = fsg->next_buffhd_to_fill;
+		start = ktime_get();
 		while (bh->state != BUF_STATE_EMPTY) {
 			rc = sleep_thread(fsg);
 			if (rc)
 				return rc;
 		}
+		add_time(&curlun->read_stats.usb_ns, start);
 
 		/* If we were asked to read past the end of file,
 		 * end with an empty buffer. */
@@ -824,9 +899,11 @@ static int do_read(struct fsg_dev *fsg)
 
 		/* Perform the read */
 		file_offset_tmp = file_offset;
+		start = ktime_get();
 		nread = vfs_read(curlun->filp,
 				(char __user *) bh->buf,
 				amount, &file_offset_tmp);
+		add_time(&curlun->read_stats.file_ns, start);
 		VLDBG(curlun, "file read %u @ %llu -> %d\n", amount,
 				(unsigned long long) file_offset,
 				(int) nread);
@@ -845,6 +922,7 @@ static int do_read(struct fsg_dev *fsg)
 		file_offset  += nread;
 		amount_left  -= nread;
 		fsg->residue -= nread;
+		curlun->read_stats.bytes += nread;
 		bh->inreq->length = nread;
 		bh->state = BUF_STATE_FULL;
 
@@ -883,6 +961,7 @@ static int do_write(struct fsg_dev *fsg)
 	unsigned int		partial_page;
 	ssize_t			nwritten;
 	int			rc;
+	ktime_t			start;
 
 	if (curlun->ro) {
 		curlun->sense_data = SS_WRITE_PROTECTED;
@@ -914,6 +993,7 @@ static int do_write(struct fsg_dev *fsg)
 	}
 
 	/* Carry out the file writes */
+	curlun->write_stats.commands++;
 	get_some_more = 1;
 	file_offset = usb_offset = ((loff_t) lba) << 9;
 	amount_left_to_req = amount_left_to_write = fsg->data_size_from_cmnd;
@@ -1003,9 +1083,15 @@ static int do_write(struct fsg_dev *fsg)
 
 			/* Perform the write */
 			file_offset_tmp = file_offset;
+			start = ktime_get();
 			nwritten = vfs_write(curlun->filp,
 					(char __user *) bh->buf,
 					amount, &file_offset_tmp);
+			if (nwritten > 0) {
+				curlun->unflushed += nwritten;
+				start_writeback(curlun);
+			}
+			add_time(&curlun->write_stats.file_ns, start);
 			VLDBG(curlun, "file write %u @ %llu -> %d\n", amount,
 					(unsigned long long) file_offset,
 					(int) nwritten);
@@ -1025,6 +1111,7 @@ static int do_write(struct fsg_dev *fsg)
 			file_offset += nwritten;
 			amount_left_to_write -= nwritten;
 			fsg->residue -= nwritten;
+			curlun->write_stats.bytes += nwritten;
 
 			/* If an error occurred, report it and its position */
 			if (nwritten < amount) {
@@ -1043,9 +1130,11 @@ static int do_write(struct fsg_dev *fsg)
 		}
 
 		/* Wait for something to happen */
+		start = ktime_get();
 		rc = sleep_thread(fsg);
 		if (rc)
 			return rc;
+		add_time(&curlun->write_stats.usb_ns, start);
 	}
 
 	return -EIO;		/* No default reply */
@@ -2126,7 +2215,7 @@ static int do_set_interface(struct fsg_dev *fsg, int altsetting)
 
 reset:
 	/* Deallocate the requests */
-	for (i = 0; i < NUM_BUFFERS; ++i) {
+	for (i = 0; i < fsg->num_buffers; ++i) {
 		struct fsg_buffhd *bh = &fsg->buffhds[i];
 
 		if (bh->inreq) {
@@ -2170,7 +2259,7 @@ reset:
 	fsg->bulk_out_maxpacket = le16_to_cpu(d->wMaxPacketSize);
 
 	/* Allocate the requests */
-	for (i = 0; i < NUM_BUFFERS; ++i) {
+	for (i = 0; i < fsg->num_buffers; ++i) {
 		struct fsg_buffhd	*bh = &fsg->buffhds[i];
 
 		rc = alloc_request(fsg, fsg->bulk_in, &bh->inreq);
@@ -2289,7 +2378,7 @@ static void handle_exception(struct fsg_dev *fsg)
 	 * state, and the exception.  Then invoke the handler. */
 	spin_lock_irq(&fsg->lock);
 
-	for (i = 0; i < NUM_BUFFERS; ++i) {
+	for (i = 0; i < fsg->num_buffers; ++i) {
 		bh = &fsg->buffhds[i];
 		bh->state = BUF_STATE_EMPTY;
 	}
@@ -2602,7 +2691,47 @@ static ssize_t store_file(struct device *dev, struct device_attribute *attr,
 }
 
 
+static void print_io_stats(const char *name, struct lun_io_stats *stats,
+		char **buf)
+{
+	u64	file_ms = stats->file_ns, usb_ms = stats->usb_ns;
+
+	do_div(file_ms, NSEC_PER_MSEC);
+	do_div(usb_ms, NSEC_PER_MSEC);
+	*buf += sprintf(*buf, "%-5s %8lu %12llu %10llu %10llu\n", name,
+			stats->commands, (unsigned long long) stats->bytes,
+			(unsigned long long) file_ms,
+			(unsigned long long) usb_ms);
+}
+
+/* The counters are updated by the main thread without locking; a read
+ * during a transfer may see them slightly out of step. */
+static ssize_t show_stats(struct device *dev, struct device_attribute *attr,
+		char *buf)
+{
+	struct lun	*curlun = dev_to_lun(dev);
+	char		*p = buf;
+
+	p += sprintf(p, "%-5s %8s %12s %10s %10s\n", "",
+			"commands", "bytes", "file ms", "usb ms");
+	print_io_stats("read", &curlun->read_stats, &p);
+	print_io_stats("write", &curlun->write_stats, &p);
+	return p - buf;
+}
+
+static ssize_t store_stats(struct device *dev, struct device_attribute *attr,
+		const char *buf, size_t count)
+{
+	struct lun	*curlun = dev_to_lun(dev);
+
+	memset(&curlun->read_stats, 0, sizeof(curlun->read_stats));
+	memset(&curlun->write_stats, 0, sizeof(curlun->write_stats));
+	return count;
+}
+
+
 static DEVICE_ATTR(file, 0444, show_file, store_file);
+static DEVICE_ATTR(stats, 0644, show_stats, store_stats);
 
 /*-------------------------------------------------------------------------*/
 
@@ -2665,6 +2794,7 @@ fsg_function_unbind(struct usb_configuration *c, struct usb_function *f)
 	for (i = 0; i < fsg->nluns; ++i) {
 		curlun = &fsg->luns[i];
 		if (curlun->registered) {
+			device_remove_file(&curlun->dev, &dev_attr_stats);
 			device_remove_file(&curlun->dev, &dev_attr_file);
 			device_unregister(&curlun->dev);
 			curlun->registered = 0;
@@ -2681,8 +2811,12 @@ fsg_function_unbind(struct usb_configuration *c, struct usb_function *f)
 	}
 
 	/* Free the data buffers */
-	for (i = 0; i < NUM_BUFFERS; ++i)
-		kfree(fsg->buffhds[i].buf);
+	if (fsg->buffhds) {
+		for (i = 0; i < fsg->num_buffers; ++i)
+			kfree(fsg->buffhds[i].buf);
+		kfree(fsg->buffhds);
+		fsg->buffhds = NULL;
+	}
 }
 
 static int __init
@@ -2735,6 +2869,12 @@ fsg_function_bind(struct usb_configuration *c, struct usb_function *f)
 			goto out;
 		}
 		rc = device_create_file(&curlun->dev, &dev_attr_file);
+		if (rc == 0) {
+			rc = device_create_file(&curlun->dev, &dev_attr_stats);
+			if (rc != 0)
+				device_remove_file(&curlun->dev,
+						&dev_attr_file);
+		}
 		if (rc != 0) {
 			ERROR(fsg, "device_create_file failed: %d\n", rc);
 			device_unregister(&curlun->dev);
@@ -2775,7 +2915,11 @@ fsg_function_bind(struct usb_configuration *c, struct usb_function *f)
 	}
 
 	/* Allocate the data buffers */
-	for (i = 0; i < NUM_BUFFERS; ++i) {
+	fsg->buffhds = kcalloc(fsg->num_buffers, sizeof(struct fsg_buffhd),
+			GFP_KERNEL);
+	if (!fsg->buffhds)
+		goto out;
+	for (i = 0; i < fsg->num_buffers; ++i) {
 		struct fsg_buffhd	*bh = &fsg->buffhds[i];
 
 		/* Allocate for the bulk-in endpoint.  We assume that
@@ -2786,7 +2930,7 @@ fsg_function_bind(struct usb_configuration *c, struct usb_function *f)
 			goto out;
 		bh->next = bh + 1;
 	}
-	fsg->buffhds[NUM_BUFFERS - 1].next = &fsg->buffhds[0];
+	fsg->buffhds[fsg->num_buffers - 1].next = &fsg->buffhds[0];
 
 	fsg->thread_task = kthread_create(fsg_main_thread, fsg,
 			shortname);
@@ -2868,7 +3012,9 @@ int __init mass_storage_function_add(struct usb_configuration *c, int nluns)
 	kref_init(&fsg->ref);
 	init_completion(&fsg->thread_notifier);
 
-	the_fsg->buf_size = BULK_BUFFER_SIZE;
+	the_fsg->buf_size = max_t(u32, PAGE_ALIGN(ums_buflen), PAGE_SIZE);
+	the_fsg->num_buffers = clamp_t(unsigned, ums_num_buffers, 2,
+			MAX_NUM_BUFFERS);
 	the_fsg->sdev.name = DRIVER_NAME;
 	the_fsg->sdev.print_name = print_switch_name;
 	the_fsg->sdev.print_state = print_switch_state;
@@ -73,6 +73,15 @@
  *   - MS-Windows drivers sometimes emit undocumented requests.
  */
 
+/* Packets the host may put in one transfer to us; each rx buffer is sized
+ * for this many.  Transfers to the host are batched up to the size it
+ * gives in its INITIALIZE message, see u_ether.c.
+ */
+static unsigned rndis_ul_max_pkt_per_xfer = 3;
+module_param(rndis_ul_max_pkt_per_xfer, uint, S_IRUGO);
+MODULE_PARM_DESC(rndis_ul_max_pkt_per_xfer,
+		"most packets the host may send per RNDIS transfer");
+
 struct rndis_ep_descs {
 	struct usb_endpoint_descriptor	*in;
 	struct usb_endpoint_descriptor	*out;
@@ -371,6 +380,9 @@ static void rndis_command_complete(struct usb_ep *ep, struct usb_request *req)
 	if (status < 0)
 		ERROR(cdev, "RNDIS command error %d, %d/%d\n",
 			status, req->actual, req->length);
+
+	/* INITIALIZE tells, and HALT forgets, how much the host takes */
+	rndis->port.dl_max_xfer_size = rndis_get_host_max_xfer(rndis->config);
 //	spin_unlock(&dev->lock);
 }
 
@@ -526,6 +538,7 @@ static void rndis_disable(struct usb_function *f)
 	DBG(cdev, "rndis deactivated\n");
 
 	rndis_uninit(rndis->config);
+	rndis->port.dl_max_xfer_size = 0;
 	gether_disconnect(&rndis->port);
 
 	usb_ep_disable(rndis->notify);
@@ -678,6 +691,7 @@ rndis_bind(struct usb_configuration *c, struct usb_function *f)
 
 	rndis_set_param_medium(rndis->config, NDIS_MEDIUM_802_3, 0);
 	rndis_set_host_mac(rndis->config, rndis->ethaddr);
+	rndis_set_max_pkt_xfer(rndis->config, rndis_ul_max_pkt_per_xfer);
 
 #if 0
 // FIXME
@@ -808,6 +822,7 @@ int __init rndis_bind_config(struct usb_configuration *c, u8 ethaddr[ETH_ALEN])
 	rndis->port.header_len = sizeof(struct rndis_packet_msg_type);
 	rndis->port.wrap = rndis_add_header;
 	rndis->port.unwrap = rndis_rm_hdr;
+	rndis->port.ul_max_pkts_per_xfer = rndis_ul_max_pkt_per_xfer;
 
 	rndis->port.func.name = "rndis";
 	rndis->port.func.strings = rndis_strings;
@@ -577,6 +577,9 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 		return -ENOMEM;
 	resp = (rndis_init_cmplt_type *) r->buf;
 
+	/* the most the host takes in one transfer to it */
+	params->host_max_xfer = le32_to_cpu (buf->MaxTransferSize);
+
 	resp->MessageType = __constant_cpu_to_le32 (
 			REMOTE_NDIS_INITIALIZE_CMPLT);
 	resp->MessageLength = __constant_cpu_to_le32 (52);
@@ -586,13 +589,17 @@ static int rndis_init_response (int configNr, rndis_init_msg_type *buf)
 	resp->MinorVersion = __constant_cpu_to_le32 (RNDIS_MINOR_VERSION);
 	resp->DeviceFlags = __constant_cpu_to_le32 (RNDIS_DF_CONNECTIONLESS);
 	resp->Medium = __constant_cpu_to_le32 (RNDIS_MEDIUM_802_3);
-	resp->MaxPacketsPerTransfer = __constant_cpu_to_le32 (1);
-	resp->MaxTransferSize = cpu_to_le32 (
-		  params->dev->mtu
+	resp->MaxPacketsPerTransfer = cpu_to_le32 (params->max_pkt_per_xfer);
+	resp->MaxTransferSize = cpu_to_le32 (params->max_pkt_per_xfer
+		* (params->dev->mtu
 		+ sizeof (struct ethhdr)
-		+ sizeof (struct rndis_packet_msg_type)
+		+ sizeof (struct rndis_packet_msg_type))
 		+ 22);
-	resp->PacketAlignmentFactor = __constant_cpu_to_le32 (0);
+	/* Packets after the first in a transfer start on 4 byte boundaries
+	 * (2^2), so their IP headers are aligned the way the first one's is.
+	 */
+	resp->PacketAlignmentFactor = cpu_to_le32 (
+			params->max_pkt_per_xfer > 1 ? 2 : 0);
 	resp->AFListOffset = __constant_cpu_to_le32 (0);
 	resp->AFListSize = __constant_cpu_to_le32 (0);
 
@@ -782,6 +789,7 @@ void rndis_uninit (int configNr)
 	if (configNr >= RNDIS_MAX_CONFIGS)
 		return;
 	rndis_per_dev_params [configNr].state = RNDIS_UNINITIALIZED;
+	rndis_per_dev_params [configNr].host_max_xfer = 0;
 
 	/* drain the response queue */
 	while ((buf = rndis_get_next_response(configNr, &length)))
@@ -831,6 +839,7 @@ int rndis_msg_parser (u8 configNr, u8 *buf)
 		DBG("%s: REMOTE_NDIS_HALT_MSG\n",
 			__func__ );
 		params->state = RNDIS_UNINITIALIZED;
+		params->host_max_xfer = 0;
 		if (params->dev) {
 			netif_carrier_off (params->dev);
 			netif_stop_queue (params->dev);
@@ -905,6 +914,7 @@ int rndis_register(void (*resp_avail)(void *v), void *v)
 			rndis_per_dev_params [i].used = 1;
 			rndis_per_dev_params [i].resp_avail = resp_avail;
 			rndis_per_dev_params [i].v = v;
+			rndis_per_dev_params [i].max_pkt_per_xfer = 1;
 			DBG("%s: configNr = %d\n", __func__, i);
 			return i;
 		}
@@ -960,6 +970,26 @@ int rndis_set_param_medium (u8 configNr, u32 medium, u32 speed)
 	return 0;
 }
 
+/* how many packets the host may send in one transfer */
+int rndis_set_max_pkt_xfer (u8 configNr, u32 max_pkt_per_xfer)
+{
+	DBG("%s: %u\n", __func__, max_pkt_per_xfer);
+	if (configNr >= RNDIS_MAX_CONFIGS) return -1;
+
+	rndis_per_dev_params [configNr].max_pkt_per_xfer =
+			max_t(u32, max_pkt_per_xfer, 1);
+
+	return 0;
+}
+
+/* how much the host takes in one transfer, zero until it initialized us */
+u32 rndis_get_host_max_xfer (u8 configNr)
+{
+	if (configNr >= RNDIS_MAX_CONFIGS) return 0;
+
+	return rndis_per_dev_params [configNr].host_max_xfer;
+}
+
 void rndis_add_hdr (struct sk_buff *skb)
 {
 	struct rndis_packet_msg_type	*header;
@@ -1028,23 +1058,54 @@ static rndis_resp_t *rndis_add_response (int configNr, u32 length)
 	return r;
 }
 
-int rndis_rm_hdr(struct sk_buff *skb)
+/*
+ * A transfer may hold several packet messages, as many as we told the
+ * host in rndis_init_response(); each but the last is cloned off the
+ * transfer's skb, so they share its buffer.  Bytes after the last message
+ * that can't be another one are padding, as hosts add to avoid ZLPs.
+ */
+int rndis_rm_hdr(struct sk_buff *skb, struct sk_buff_head *list)
 {
-	/* tmp points to a struct rndis_packet_msg_type */
-	__le32		*tmp = (void *) skb->data;
-
-	/* MessageType, MessageLength */
-	if (__constant_cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
-			!= get_unaligned(tmp++))
-		return -EINVAL;
-	tmp++;
+	for (;;) {
+		/* tmp points to a struct rndis_packet_msg_type */
+		__le32		*tmp = (void *) skb->data;
+		u32		msg_len, data_offset, data_len;
+		struct sk_buff	*skb2;
+
+		if (skb->len < sizeof(struct rndis_packet_msg_type))
+			return -EINVAL;
+
+		/* MessageType, MessageLength */
+		if (__constant_cpu_to_le32(REMOTE_NDIS_PACKET_MSG)
+				!= get_unaligned(tmp++))
+			return -EINVAL;
+		msg_len = get_unaligned_le32(tmp++);
+
+		/* DataOffset, DataLength */
+		data_offset = get_unaligned_le32(tmp++) + 8;
+		data_len = get_unaligned_le32(tmp++);
+		if (data_offset > skb->len
+				|| data_len > skb->len - data_offset)
+			return -EOVERFLOW;
+
+		if (msg_len < data_offset + data_len || msg_len >= skb->len
+				|| skb->len - msg_len
+					< sizeof(struct rndis_packet_msg_type)) {
+			skb_pull(skb, data_offset);
+			skb_trim(skb, data_len);
+			skb_queue_tail(list, skb);
+			return 0;
+		}
 
-	/* DataOffset, DataLength */
-	if (!skb_pull(skb, get_unaligned_le32(tmp++) + 8))
-		return -EOVERFLOW;
-	skb_trim(skb, get_unaligned_le32(tmp++));
+		skb2 = skb_clone(skb, GFP_ATOMIC);
+		if (!skb2)
+			return -ENOMEM;
+		skb_pull(skb2, data_offset);
+		skb_trim(skb2, data_len);
+		skb_queue_tail(list, skb2);
 
-	return 0;
+		skb_pull(skb, msg_len);
+	}
 }
 
 #ifdef	CONFIG_USB_GADGET_DEBUG_FILES
@@ -1061,7 +1122,9 @@ static int rndis_proc_show(struct seq_file *m, void *v)
 			 "speed     : %d\n"
 			 "cable     : %s\n"
 			 "vendor ID : 0x%08X\n"
-			 "vendor    : %s\n",
+			 "vendor    : %s\n"
+			 "pkts/xfer : %u\n"
+			 "host xfer : %u\n",
 			 param->confignr, (param->used) ? "y" : "n",
 			 ({ char *s = "?";
 			 switch (param->state) {
@@ -1075,7 +1138,8 @@ static int rndis_proc_show(struct seq_file *m, void *v)
 			 param->medium,
 			 (param->media_state) ? 0 : param->speed*100,
 			 (param->media_state) ? "disconnected" : "connected",
-			 param->vendorID, param->vendorDescr);
+			 param->vendorID, param->vendorDescr,
+			 param->max_pkt_per_xfer, param->host_max_xfer);
 	return 0;
 }
 
@@ -229,6 +229,8 @@ typedef struct rndis_params
 	u32			medium;
 	u32			speed;
 	u32			media_state;
+	u32			max_pkt_per_xfer;
+	u32			host_max_xfer;
 
 	const u8		*host_mac;
 	u16			*filter;
@@ -250,8 +252,10 @@ int  rndis_set_param_dev (u8 configNr, struct net_device *dev,
 int  rndis_set_param_vendor (u8 configNr, u32 vendorID,
 			    const char *vendorDescr);
 int  rndis_set_param_medium (u8 configNr, u32 medium, u32 speed);
+int  rndis_set_max_pkt_xfer (u8 configNr, u32 max_pkt_per_xfer);
+u32  rndis_get_host_max_xfer (u8 configNr);
 void rndis_add_hdr (struct sk_buff *skb);
-int rndis_rm_hdr (struct sk_buff *skb);
+int rndis_rm_hdr (struct sk_buff *skb, struct sk_buff_head *list);
 u8   *rndis_get_next_response (int configNr, u32 *length);
 void rndis_free_response (int configNr, u8 *buf);
 
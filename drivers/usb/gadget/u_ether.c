@@ -28,6 +28,7 @@
 #include <linux/ctype.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
+#include <linux/hrtimer.h>
 
 #include "u_ether.h"
 
@@ -54,6 +55,9 @@
 
 #define DRIVER_VERSION	"29-May-2008"
 
+/* transfers are counted by frames carried: 1, 2-3, 4-7, 8-15, 16 or more */
+#define XFER_HIST	5
+
 struct eth_dev {
 	/* lock is held while accessing port_usb
 	 * or updating its backlink port_usb->ioport
@@ -69,8 +73,17 @@ struct eth_dev {
 	atomic_t		tx_qlen;
 
 	unsigned		header_len;
+	unsigned		ul_max_pkts;
 	struct sk_buff		*(*wrap)(struct sk_buff *skb);
-	int			(*unwrap)(struct sk_buff *skb);
+	int			(*unwrap)(struct sk_buff *skb,
+						struct sk_buff_head *list);
+
+	/* frames batched for the next transfer, see eth_xmit_agg() */
+	struct usb_request	*tx_agg_req;
+	struct hrtimer		tx_agg_timer;
+
+	unsigned long		tx_xfers[XFER_HIST];
+	unsigned long		rx_xfers[XFER_HIST];
 
 	struct work_struct	work;
 
@@ -98,6 +111,23 @@ MODULE_PARM_DESC(qmult, "queue length multiplier at high speed");
 #define qmult		1
 #endif
 
+/* Frames for a host that takes several per transfer are batched; a batch
+ * goes out when it holds tx_agg_frames frames or might not fit another
+ * one in tx_agg_bytes, when an earlier transfer completes, or at the
+ * latest tx_agg_usecs after it was started.
+ */
+static unsigned tx_agg_frames = 10;
+module_param(tx_agg_frames, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_agg_frames, "most frames per tx transfer, 1 to not batch");
+
+static unsigned tx_agg_bytes = SKB_MAX_ORDER(0, 1);
+module_param(tx_agg_bytes, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_agg_bytes, "most bytes per batched tx transfer");
+
+static unsigned tx_agg_usecs = 500;
+module_param(tx_agg_usecs, uint, S_IRUGO|S_IWUSR);
+MODULE_PARM_DESC(tx_agg_usecs, "usecs a batch may wait, 0 waits for a completion");
+
 /* for dual-speed hardware, use deeper queues at highspeed */
 static inline int qlen(struct usb_gadget *gadget)
 {
@@ -175,6 +205,54 @@ static void eth_get_drvinfo(struct net_device *net, struct ethtool_drvinfo *p)
 	strlcpy(p->bus_info, dev_name(&dev->gadget->dev), sizeof p->bus_info);
 }
 
+static inline void count_xfer(unsigned long *hist, unsigned frames)
+{
+	if (frames)
+		hist[min(fls(frames), XFER_HIST) - 1]++;
+}
+
+/* "ethtool -S" shows how well frames share transfers */
+static const char xfer_stat_names[][ETH_GSTRING_LEN] = {
+	"tx_xfers_1_frame",
+	"tx_xfers_2_3_frames",
+	"tx_xfers_4_7_frames",
+	"tx_xfers_8_15_frames",
+	"tx_xfers_16_frames",
+	"rx_xfers_1_frame",
+	"rx_xfers_2_3_frames",
+	"rx_xfers_4_7_frames",
+	"rx_xfers_8_15_frames",
+	"rx_xfers_16_frames",
+};
+
+static int eth_get_sset_count(struct net_device *net, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return ARRAY_SIZE(xfer_stat_names);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void eth_get_strings(struct net_device *net, u32 sset, u8 *data)
+{
+	if (sset == ETH_SS_STATS)
+		memcpy(data, xfer_stat_names, sizeof xfer_stat_names);
+}
+
+static void eth_get_ethtool_stats(struct net_device *net,
+		struct ethtool_stats *stats, u64 *data)
+{
+	struct eth_dev	*dev = netdev_priv(net);
+	int		i;
+
+	for (i = 0; i < XFER_HIST; i++)
+		*data++ = dev->tx_xfers[i];
+	for (i = 0; i < XFER_HIST; i++)
+		*data++ = dev->rx_xfers[i];
+}
+
 /* REVISIT can also support:
  *   - WOL (by tracking suspends and issuing remote wakeup)
  *   - msglevel (implies updated messaging)
@@ -184,6 +262,9 @@ static void eth_get_drvinfo(struct net_device *net, struct ethtool_drvinfo *p)
 static struct ethtool_ops ops = {
 	.get_drvinfo = eth_get_drvinfo,
 	.get_link = ethtool_op_get_link,
+	.get_sset_count = eth_get_sset_count,
+	.get_strings = eth_get_strings,
+	.get_ethtool_stats = eth_get_ethtool_stats,
 };
 
 static void defer_kevent(struct eth_dev *dev, int flag)
@@ -228,10 +309,14 @@ rx_submit(struct eth_dev *dev, struct usb_request *req, gfp_t gfp_flags)
 	 * RNDIS uses internal framing, and explicitly allows senders to
 	 * pad to end-of-packet.  That's potentially nice for speed, but
 	 * means receivers can't recover lost synch on their own (because
-	 * new packets don't only start after a short RX).
+	 * new packets don't only start after a short RX).  It also lets
+	 * the host put several packets in one transfer, when we said it
+	 * may (ul_max_pkts).
 	 */
-	size += sizeof(struct ethhdr) + dev->net->mtu + RX_EXTRA;
+	size += sizeof(struct ethhdr) + dev->net->mtu;
 	size += dev->port_usb->header_len;
+	size *= dev->ul_max_pkts;
+	size += RX_EXTRA;
 	size += out->maxpacket - 1;
 	size -= size % out->maxpacket;
 
@@ -269,35 +354,50 @@ enomem:
 
 static void rx_complete(struct usb_ep *ep, struct usb_request *req)
 {
-	struct sk_buff	*skb = req->context;
+	struct sk_buff	*skb = req->context, *frame;
 	struct eth_dev	*dev = ep->driver_data;
 	int		status = req->status;
+	struct sk_buff_head frames;
+	unsigned	count = 0;
 
 	switch (status) {
 
 	/* normal completion */
 	case 0:
 		skb_put(skb, req->actual);
+		skb_queue_head_init(&frames);
 		if (dev->unwrap)
-			status = dev->unwrap(skb);
-		if (status < 0
-				|| ETH_HLEN > skb->len
-				|| skb->len > ETH_FRAME_LEN) {
+			status = dev->unwrap(skb, &frames);
+		else
+			skb_queue_tail(&frames, skb);
+		if (status < 0) {
 			dev->net->stats.rx_errors++;
 			dev->net->stats.rx_length_errors++;
-			DBG(dev, "rx length %d\n", skb->len);
-			break;
-		}
+			DBG(dev, "rx unwrap %d\n", status);
+		} else
+			skb = NULL;
+
+		while ((frame = skb_dequeue(&frames)) != NULL) {
+			if (ETH_HLEN > frame->len
+					|| frame->len > ETH_FRAME_LEN) {
+				dev->net->stats.rx_errors++;
+				dev->net->stats.rx_length_errors++;
+				DBG(dev, "rx length %d\n", frame->len);
+				dev_kfree_skb_any(frame);
+				continue;
+			}
 
-		skb->protocol = eth_type_trans(skb, dev->net);
-		dev->net->stats.rx_packets++;
-		dev->net->stats.rx_bytes += skb->len;
+			frame->protocol = eth_type_trans(frame, dev->net);
+			dev->net->stats.rx_packets++;
+			dev->net->stats.rx_bytes += frame->len;
 
-		/* no buffer copies needed, unless hardware can't
-		 * use skb buffers.
-		 */
-		status = netif_rx(skb);
-		skb = NULL;
+			/* no buffer copies needed, unless hardware can't
+			 * use skb buffers.
+			 */
+			status = netif_rx(frame);
+			count++;
+		}
+		count_xfer(dev->rx_xfers, count);
 		break;
 
 	/* software-driven interface shutdown */
@@ -432,23 +532,30 @@ static void eth_work(struct work_struct *work)
 		DBG(dev, "work done, flags = 0x%lx\n", dev->todo);
 }
 
+/* frames carried by a tx skb; the control buffer is ours while we hold it */
+#define TX_FRAMES(skb)	(*(unsigned *)(skb)->cb)
+
+static void tx_agg_flush(struct eth_dev *dev, struct usb_ep *in);
+
 static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 {
 	struct sk_buff	*skb = req->context;
 	struct eth_dev	*dev = ep->driver_data;
+	int		status = req->status;
 
-	switch (req->status) {
+	switch (status) {
 	default:
 		dev->net->stats.tx_errors++;
-		VDBG(dev, "tx err %d\n", req->status);
+		VDBG(dev, "tx err %d\n", status);
 		/* FALLTHROUGH */
 	case -ECONNRESET:		/* unlink */
 	case -ESHUTDOWN:		/* disconnect etc */
 		break;
 	case 0:
 		dev->net->stats.tx_bytes += skb->len;
+		count_xfer(dev->tx_xfers, TX_FRAMES(skb));
 	}
-	dev->net->stats.tx_packets++;
+	dev->net->stats.tx_packets += TX_FRAMES(skb);
 
 	spin_lock(&dev->req_lock);
 	list_add(&req->list, &dev->tx_reqs);
@@ -456,6 +563,11 @@ static void tx_complete(struct usb_ep *ep, struct usb_request *req)
 	dev_kfree_skb_any(skb);
 
 	atomic_dec(&dev->tx_qlen);
+
+	/* a batch waiting for this transfer can go now */
+	if (status == 0 && dev->tx_agg_req)
+		tx_agg_flush(dev, ep);
+
 	if (netif_carrier_ok(dev->net))
 		netif_wake_queue(dev->net);
 }
@@ -465,23 +577,227 @@ static inline int is_promisc(u16 cdc_filter)
 	return cdc_filter & USB_CDC_PACKET_TYPE_PROMISCUOUS;
 }
 
+/* queue a request taken off tx_reqs; it is put back if that fails */
+static void tx_queue(struct eth_dev *dev, struct usb_ep *in,
+		struct usb_request *req, struct sk_buff *skb, bool throttle)
+{
+	int		length = skb->len;
+	int		retval;
+	unsigned long	flags;
+
+	req->buf = skb->data;
+	req->context = skb;
+	req->complete = tx_complete;
+
+	/* use zlp framing on tx for strict CDC-Ether conformance,
+	 * though any robust network rx path ignores extra padding.
+	 * and some hardware doesn't like to write zlps.
+	 */
+	req->zero = 1;
+	if (!dev->zlp && (length % in->maxpacket) == 0)
+		length++;
+
+	req->length = length;
+
+	/* throttle highspeed IRQ rate back slightly; batches rely on
+	 * completions to be sent, so they don't
+	 */
+	if (gadget_is_dualspeed(dev->gadget))
+		req->no_interrupt = (throttle
+				&& dev->gadget->speed == USB_SPEED_HIGH)
+			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
+			: 0;
+
+	retval = usb_ep_queue(in, req, GFP_ATOMIC);
+	switch (retval) {
+	default:
+		DBG(dev, "tx queue err %d\n", retval);
+		break;
+	case 0:
+		dev->net->trans_start = jiffies;
+		atomic_inc(&dev->tx_qlen);
+	}
+
+	if (retval) {
+		dev->net->stats.tx_dropped += TX_FRAMES(skb);
+		dev_kfree_skb_any(skb);
+		spin_lock_irqsave(&dev->req_lock, flags);
+		if (list_empty(&dev->tx_reqs))
+			netif_start_queue(dev->net);
+		list_add(&req->list, &dev->tx_reqs);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+	}
+}
+
+/* send the open batch, if there still is one */
+static void tx_agg_flush(struct eth_dev *dev, struct usb_ep *in)
+{
+	struct usb_request	*req;
+	unsigned long		flags;
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_agg_req;
+	dev->tx_agg_req = NULL;
+	if (req && list_empty(&dev->tx_reqs))
+		netif_stop_queue(dev->net);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (req)
+		tx_queue(dev, in, req, req->context, false);
+}
+
+static enum hrtimer_restart tx_agg_timeout(struct hrtimer *timer)
+{
+	struct eth_dev	*dev = container_of(timer, struct eth_dev,
+					tx_agg_timer);
+	struct usb_ep	*in = NULL;
+	unsigned long	flags;
+
+	spin_lock_irqsave(&dev->lock, flags);
+	if (dev->port_usb)
+		in = dev->port_usb->in_ep;
+	spin_unlock_irqrestore(&dev->lock, flags);
+
+	if (in)
+		tx_agg_flush(dev, in);
+	return HRTIMER_NORESTART;
+}
+
+/* throw the open batch away, when the endpoint is going down; this may
+ * interrupt tx_agg_timeout(), which then finds nothing left to send
+ */
+static void tx_agg_drop(struct eth_dev *dev)
+{
+	struct usb_request	*req;
+	struct sk_buff		*skb = NULL;
+	unsigned long		flags;
+
+	hrtimer_try_to_cancel(&dev->tx_agg_timer);
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_agg_req;
+	dev->tx_agg_req = NULL;
+	if (req) {
+		skb = req->context;
+		list_add(&req->list, &dev->tx_reqs);
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+
+	if (skb) {
+		dev->net->stats.tx_dropped += TX_FRAMES(skb);
+		dev_kfree_skb_any(skb);
+	}
+}
+
+/*
+ * Framing like RNDIS lets one transfer carry several frames, up to a size
+ * the host gives.  Fewer, larger transfers mean fewer interrupts and less
+ * per-request overhead on both ends, at the cost of copying each frame
+ * into the batch.  The batch is only held back while an earlier transfer
+ * is in flight, so a lightly loaded link doesn't get slower.
+ *
+ * An open batch always has room for one more frame of the largest size,
+ * so the queue only has to stop when there is no batch and no request.
+ */
+static int eth_xmit_agg(struct eth_dev *dev, struct sk_buff *skb,
+		struct usb_ep *in, unsigned max)
+{
+	struct net_device	*net = dev->net;
+	unsigned		room = ETH_HLEN + net->mtu + dev->header_len;
+	struct usb_request	*req, *full = NULL;
+	struct sk_buff		*agg = NULL;
+	unsigned long		flags;
+
+	if (dev->wrap) {
+		struct sk_buff	*skb_new;
+
+		skb_new = dev->wrap(skb);
+		dev_kfree_skb_any(skb);
+		if (!skb_new) {
+			net->stats.tx_dropped++;
+			return 0;
+		}
+		skb = skb_new;
+	}
+
+	spin_lock_irqsave(&dev->req_lock, flags);
+	req = dev->tx_agg_req;
+	if (!req) {
+		/* same disconnect() race as in eth_start_xmit() */
+		if (list_empty(&dev->tx_reqs)) {
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+			net->stats.tx_dropped++;
+			dev_kfree_skb_any(skb);
+			return 0;
+		}
+		req = container_of(dev->tx_reqs.next, struct usb_request, list);
+		list_del(&req->list);
+		spin_unlock_irqrestore(&dev->req_lock, flags);
+
+		/* nothing in flight to wait for, or no memory: no batch */
+		if (atomic_read(&dev->tx_qlen))
+			agg = alloc_skb(max + 1, GFP_ATOMIC);
+		if (!agg) {
+			spin_lock_irqsave(&dev->req_lock, flags);
+			if (list_empty(&dev->tx_reqs))
+				netif_stop_queue(net);
+			spin_unlock_irqrestore(&dev->req_lock, flags);
+
+			TX_FRAMES(skb) = 1;
+			tx_queue(dev, in, req, skb, false);
+			return 0;
+		}
+		TX_FRAMES(agg) = 0;
+		req->context = agg;
+
+		spin_lock_irqsave(&dev->req_lock, flags);
+		dev->tx_agg_req = req;
+		if (tx_agg_usecs)
+			hrtimer_start(&dev->tx_agg_timer,
+				ns_to_ktime((u64) tx_agg_usecs * NSEC_PER_USEC),
+				HRTIMER_MODE_REL);
+	}
+
+	agg = req->context;
+	memcpy(skb_put(agg, skb->len), skb->data, skb->len);
+	TX_FRAMES(agg)++;
+
+	/* send it once another frame might not fit; the byte short of
+	 * max is for the zlp padding tx_queue() may add
+	 */
+	if (TX_FRAMES(agg) >= tx_agg_frames || agg->len + room >= max
+			|| skb_tailroom(agg) <= room) {
+		full = req;
+		dev->tx_agg_req = NULL;
+		if (list_empty(&dev->tx_reqs))
+			netif_stop_queue(net);
+	}
+	spin_unlock_irqrestore(&dev->req_lock, flags);
+	dev_kfree_skb_any(skb);
+
+	if (full)
+		tx_queue(dev, in, full, agg, false);
+	return 0;
+}
+
 static int eth_start_xmit(struct sk_buff *skb, struct net_device *net)
 {
 	struct eth_dev		*dev = netdev_priv(net);
-	int			length = skb->len;
-	int			retval;
 	struct usb_request	*req = NULL;
 	unsigned long		flags;
 	struct usb_ep		*in;
 	u16			cdc_filter;
+	unsigned		agg_size;
 
 	spin_lock_irqsave(&dev->lock, flags);
 	if (dev->port_usb) {
 		in = dev->port_usb->in_ep;
 		cdc_filter = dev->port_usb->cdc_filter;
+		agg_size = dev->port_usb->dl_max_xfer_size;
 	} else {
 		in = NULL;
 		cdc_filter = 0;
+		agg_size = 0;
 	}
 	spin_unlock_irqrestore(&dev->lock, flags);
 
@@ -512,6 +828,13 @@ static int eth_start_xmit(struct sk_buff *skb, struct net_device *net)
 		/* ignores USB_CDC_PACKET_TYPE_DIRECTED */
 	}
 
+	/* batch frames when a transfer may hold more than one */
+	agg_size = min(agg_size, tx_agg_bytes);
+	agg_size = min_t(unsigned, agg_size, SKB_MAX_ALLOC);
+	if (tx_agg_frames > 1
+			&& agg_size > ETH_HLEN + net->mtu + dev->header_len)
+		return eth_xmit_agg(dev, skb, in, agg_size);
+
 	spin_lock_irqsave(&dev->req_lock, flags);
 	/*
 	 * this freelist can be empty if an interrupt triggered disconnect()
@@ -544,48 +867,20 @@ static int eth_start_xmit(struct sk_buff *skb, struct net_device *net)
 
 		dev_kfree_skb_any(skb);
 		skb = skb_new;
-		length = skb->len;
 	}
-	req->buf = skb->data;
-	req->context = skb;
-	req->complete = tx_complete;
 
-	/* use zlp framing on tx for strict CDC-Ether conformance,
-	 * though any robust network rx path ignores extra padding.
-	 * and some hardware doesn't like to write zlps.
-	 */
-	req->zero = 1;
-	if (!dev->zlp && (length % in->maxpacket) == 0)
-		length++;
-
-	req->length = length;
-
-	/* throttle highspeed IRQ rate back slightly */
-	if (gadget_is_dualspeed(dev->gadget))
-		req->no_interrupt = (dev->gadget->speed == USB_SPEED_HIGH)
-			? ((atomic_read(&dev->tx_qlen) % qmult) != 0)
-			: 0;
-
-	retval = usb_ep_queue(in, req, GFP_ATOMIC);
-	switch (retval) {
-	default:
-		DBG(dev, "tx queue err %d\n", retval);
-		break;
-	case 0:
-		net->trans_start = jiffies;
-		atomic_inc(&dev->tx_qlen);
-	}
+	TX_FRAMES(skb) = 1;
+	tx_queue(dev, in, req, skb, true);
+	return 0;
 
-	if (retval) {
 drop:
-		dev->net->stats.tx_dropped++;
-		dev_kfree_skb_any(skb);
-		spin_lock_irqsave(&dev->req_lock, flags);
-		if (list_empty(&dev->tx_reqs))
-			netif_start_queue(net);
-		list_add(&req->list, &dev->tx_reqs);
-		spin_unlock_irqrestore(&dev->req_lock, flags);
-	}
+	dev->net->stats.tx_dropped++;
+	dev_kfree_skb_any(skb);
+	spin_lock_irqsave(&dev->req_lock, flags);
+	if (list_empty(&dev->tx_reqs))
+		netif_start_queue(net);
+	list_add(&req->list, &dev->tx_reqs);
+	spin_unlock_irqrestore(&dev->req_lock, flags);
 	return 0;
 }
 
@@ -628,6 +923,7 @@ static int eth_stop(struct net_device *net)
 
 	VDBG(dev, "%s\n", __func__);
 	netif_stop_queue(net);
+	tx_agg_drop(dev);
 
 	DBG(dev, "stop stats: rx/tx %ld/%ld, errs %ld/%ld\n",
 		dev->net->stats.rx_packets, dev->net->stats.tx_packets,
@@ -743,6 +1039,9 @@ int __init gether_setup(struct usb_gadget *g, u8 ethaddr[ETH_ALEN])
 	INIT_WORK(&dev->work, eth_work);
 	INIT_LIST_HEAD(&dev->tx_reqs);
 	INIT_LIST_HEAD(&dev->rx_reqs);
+	hrtimer_init(&dev->tx_agg_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	dev->tx_agg_timer.function = tx_agg_timeout;
+	dev->ul_max_pkts = 1;
 
 	/* network device setup */
 	dev->net = net;
@@ -804,6 +1103,7 @@ void gether_cleanup(void)
 		return;
 
 	unregister_netdev(the_dev->net);
+	hrtimer_cancel(&the_dev->tx_agg_timer);
 	free_netdev(the_dev->net);
 
 	/* assuming we used keventd, it must quiesce too */
@@ -861,6 +1161,7 @@ struct net_device *gether_connect(struct gether *link)
 		DBG(dev, "qlen %d\n", qlen(dev->gadget));
 
 		dev->header_len = link->header_len;
+		dev->ul_max_pkts = max_t(u32, link->ul_max_pkts_per_xfer, 1);
 		dev->unwrap = link->unwrap;
 		dev->wrap = link->wrap;
 
@@ -918,6 +1219,7 @@ void gether_disconnect(struct gether *link)
 
 	netif_stop_queue(dev->net);
 	netif_carrier_off(dev->net);
+	tx_agg_drop(dev);
 
 	/* disable endpoints, forcing (synchronous) completion
 	 * of all pending i/o.  then free the request objects
@@ -955,6 +1257,7 @@ void gether_disconnect(struct gether *link)
 
 	/* finish forgetting about this USB link episode */
 	dev->header_len = 0;
+	dev->ul_max_pkts = 1;
 	dev->unwrap = NULL;
 	dev->wrap = NULL;
 
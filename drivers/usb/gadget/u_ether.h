@@ -61,11 +61,23 @@ struct gether {
 	u16				cdc_filter;
 
 	/* hooks for added framing, as needed for RNDIS and EEM.
-	 * we currently don't support multiple frames per SKB.
+	 * wrap() adds the framing to one frame; unwrap() queues the
+	 * frame(s) a received transfer holds on the list, or returns
+	 * a negative errno and leaves the skb to the caller.
 	 */
 	u32				header_len;
 	struct sk_buff			*(*wrap)(struct sk_buff *skb);
-	int				(*unwrap)(struct sk_buff *skb);
+	int				(*unwrap)(struct sk_buff *skb,
+						struct sk_buff_head *list);
+
+	/* framing that lets several frames share one transfer: rx
+	 * buffers hold ul_max_pkts_per_xfer frames from the host, and
+	 * up to dl_max_xfer_size bytes of frames are batched towards
+	 * it (zero for one frame per transfer).  dl_max_xfer_size may
+	 * change while the link is up, when the host tells its limit.
+	 */
+	u32				ul_max_pkts_per_xfer;
+	u32				dl_max_xfer_size;
 
 	/* called on network open/close */
 	void				(*open)(struct gether *);
@@ -2497,7 +2497,9 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("mountstats", S_IRUSR, mountstats),
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, clear_refs),
+	REG("reclaim",    S_IWUSR, reclaim),
 	REG("smaps",      S_IRUGO, smaps),
+	REG("smaps_rollup", S_IRUGO, smaps_rollup),
 	REG("pagemap",    S_IRUSR, pagemap),
 #endif
 #ifdef CONFIG_SECURITY
@@ -2832,6 +2834,7 @@ static const struct pid_entry tid_base_stuff[] = {
 #ifdef CONFIG_PROC_PAGE_MONITOR
 	REG("clear_refs", S_IWUSR, clear_refs),
 	REG("smaps",     S_IRUGO, smaps),
+	REG("smaps_rollup", S_IRUGO, smaps_rollup),
 	REG("pagemap",    S_IRUSR, pagemap),
 #endif
 #ifdef CONFIG_SECURITY
@@ -438,6 +438,90 @@ const struct file_operations proc_smaps_operations = {
 	.release	= seq_release_private,
 };
 
+/*
+ * smaps_rollup: the smaps counters summed over all vmas of the process,
+ * plus Uss, the memory that would be freed if the process exited.  It
+ * takes one pass over the page tables under mmap_sem and formats one
+ * record, which is what memory accounting tools sampling every process
+ * want, rather than a record per vma.
+ */
+static int smaps_rollup_show(struct seq_file *m, void *v)
+{
+	struct inode *inode = m->private;
+	struct task_struct *task;
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	struct mem_size_stats mss;
+	struct mm_walk smaps_walk = {
+		.pmd_entry = smaps_pte_range,
+		.private = &mss,
+	};
+	unsigned long size = 0;
+	int ret = 0;
+
+	task = get_proc_task(inode);
+	if (!task)
+		return -ESRCH;
+	if (maps_protect && !ptrace_may_access(task, PTRACE_MODE_READ)) {
+		ret = -EACCES;
+		goto out;
+	}
+
+	memset(&mss, 0, sizeof mss);
+	mm = get_task_mm(task);
+	if (mm) {
+		smaps_walk.mm = mm;
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			size += vma->vm_end - vma->vm_start;
+			if (is_vm_hugetlb_page(vma))
+				continue;
+			mss.vma = vma;
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&smaps_walk);
+		}
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+
+	seq_printf(m,
+		   "Size:           %8lu kB\n"
+		   "Rss:            %8lu kB\n"
+		   "Pss:            %8lu kB\n"
+		   "Uss:            %8lu kB\n"
+		   "Shared_Clean:   %8lu kB\n"
+		   "Shared_Dirty:   %8lu kB\n"
+		   "Private_Clean:  %8lu kB\n"
+		   "Private_Dirty:  %8lu kB\n"
+		   "Referenced:     %8lu kB\n"
+		   "Swap:           %8lu kB\n",
+		   size >> 10,
+		   mss.resident >> 10,
+		   (unsigned long)(mss.pss >> (10 + PSS_SHIFT)),
+		   (mss.private_clean + mss.private_dirty) >> 10,
+		   mss.shared_clean  >> 10,
+		   mss.shared_dirty  >> 10,
+		   mss.private_clean >> 10,
+		   mss.private_dirty >> 10,
+		   mss.referenced >> 10,
+		   mss.swap >> 10);
+out:
+	put_task_struct(task);
+	return ret;
+}
+
+static int smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, smaps_rollup_show, inode);
+}
+
+const struct file_operations proc_smaps_rollup_operations = {
+	.open		= smaps_rollup_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
 static int clear_refs_pte_range(pmd_t *pmd, unsigned long addr,
 				unsigned long end, struct mm_walk *walk)
 {
@@ -512,6 +596,128 @@ const struct file_operations proc_clear_refs_operations = {
 	.write		= clear_refs_write,
 };
 
+#define RECLAIM_FILE	0x1
+#define RECLAIM_ANON	0x2
+
+struct reclaim_walk {
+	struct vm_area_struct *vma;
+	int type;
+	unsigned long nr_reclaimed;
+};
+
+static int reclaim_pte_range(pmd_t *pmd, unsigned long addr,
+				unsigned long end, struct mm_walk *walk)
+{
+	struct reclaim_walk *rw = walk->private;
+	struct vm_area_struct *vma = rw->vma;
+	pte_t *pte, ptent;
+	spinlock_t *ptl;
+	struct page *page;
+	LIST_HEAD(page_list);
+	int isolated = 0;
+
+	pte = pte_offset_map_lock(vma->vm_mm, pmd, addr, &ptl);
+	for (; addr != end; pte++, addr += PAGE_SIZE) {
+		ptent = *pte;
+		if (!pte_present(ptent))
+			continue;
+
+		page = vm_normal_page(vma, addr, ptent);
+		if (!page)
+			continue;
+
+		if (!(rw->type & (PageSwapBacked(page) ? RECLAIM_ANON :
+							 RECLAIM_FILE)))
+			continue;
+
+		/* Pages shared with other processes are left to kswapd */
+		if (page_mapcount(page) != 1)
+			continue;
+
+		/*
+		 * The process is known not to need the page soon, so its
+		 * own recent references should not keep it in memory.
+		 */
+		ptep_test_and_clear_young(vma, addr, pte);
+		ClearPageReferenced(page);
+		if (!isolate_lru_page(page, &page_list))
+			isolated++;
+	}
+	pte_unmap_unlock(pte - 1, ptl);
+
+	if (isolated)
+		rw->nr_reclaimed += reclaim_pages_from_list(&page_list);
+	cond_resched();
+	return 0;
+}
+
+/*
+ * Writing "file", "anon" or "all" to /proc/<pid>/reclaim frees the
+ * pages of that kind mapped only by the process, so that a background
+ * app can be trimmed instead of killed.  Anonymous pages are reclaimed
+ * only while there is swap to write them to.
+ */
+static ssize_t reclaim_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct task_struct *task;
+	char buffer[16];
+	struct mm_struct *mm;
+	struct vm_area_struct *vma;
+	struct reclaim_walk rw = { .nr_reclaimed = 0 };
+	size_t len;
+
+	memset(buffer, 0, sizeof(buffer));
+	len = min(count, sizeof(buffer) - 1);
+	if (copy_from_user(buffer, buf, len))
+		return -EFAULT;
+
+	if (!strcmp(strstrip(buffer), "file"))
+		rw.type = RECLAIM_FILE;
+	else if (!strcmp(buffer, "anon"))
+		rw.type = RECLAIM_ANON;
+	else if (!strcmp(buffer, "all"))
+		rw.type = RECLAIM_FILE | RECLAIM_ANON;
+	else
+		return -EINVAL;
+
+	if (nr_swap_pages <= 0)
+		rw.type &= ~RECLAIM_ANON;
+	if (!rw.type)
+		return count;
+
+	task = get_proc_task(file->f_path.dentry->d_inode);
+	if (!task)
+		return -ESRCH;
+	mm = get_task_mm(task);
+	if (mm) {
+		struct mm_walk reclaim_walk = {
+			.pmd_entry = reclaim_pte_range,
+			.mm = mm,
+			.private = &rw,
+		};
+
+		lru_add_drain();
+		down_read(&mm->mmap_sem);
+		for (vma = mm->mmap; vma; vma = vma->vm_next) {
+			if (is_vm_hugetlb_page(vma) || (vma->vm_flags & VM_LOCKED))
+				continue;
+			rw.vma = vma;
+			walk_page_range(vma->vm_start, vma->vm_end,
+					&reclaim_walk);
+		}
+		flush_tlb_mm(mm);
+		up_read(&mm->mmap_sem);
+		mmput(mm);
+	}
+	put_task_struct(task);
+	return count;
+}
+
+const struct file_operations proc_reclaim_operations = {
+	.write		= reclaim_write,
+};
+
 struct pagemapread {
 	u64 __user *out, *end;
 };
@@ -41,6 +41,11 @@
 #define HW3D_REVOKE_GPU		_IOW(PMEM_IOCTL_MAGIC, 8, unsigned int)
 #define HW3D_GRANT_GPU		_IOW(PMEM_IOCTL_MAGIC, 9, unsigned int)
 #define HW3D_WAIT_FOR_INTERRUPT	_IOW(PMEM_IOCTL_MAGIC, 10, unsigned int)
+/* Does cache maintenance on the parts of a cached allocation that were
+ * actually touched, instead of all of it.  Pass a pointer to a
+ * pmem_cache_op struct as the argument.
+ */
+#define PMEM_CACHE_OP		_IOW(PMEM_IOCTL_MAGIC, 11, unsigned int)
 
 int get_pmem_file(unsigned int fd, unsigned long *start, unsigned long *vstart,
 		  unsigned long *end, struct file **filp);
@@ -74,6 +79,31 @@ struct pmem_region {
 	unsigned long len;
 };
 
+/* Operations of PMEM_CACHE_OP, by the direction of the coming DMA */
+#define PMEM_CACHE_CLEAN	1	/* to the device: write back */
+#define PMEM_CACHE_INV		2	/* from the device: invalidate */
+#define PMEM_CACHE_FLUSH	3	/* both ways: write back and invalidate */
+#define PMEM_CACHE_NR_OPS	3
+
+#define PMEM_CACHE_MAX_RECTS	64
+
+/* A rectangle of 'height' lines of 'width' bytes, each line starting
+ * 'stride' bytes after the previous one.  A plain range is a rectangle of
+ * height 1, whose stride is ignored.
+ */
+struct pmem_cache_rect {
+	unsigned long offset;	/* first byte, from the start of the file */
+	unsigned long width;
+	unsigned long height;
+	unsigned long stride;
+};
+
+struct pmem_cache_op {
+	unsigned int op;	/* PMEM_CACHE_CLEAN, _INV or _FLUSH */
+	unsigned int nr_rects;	/* at most PMEM_CACHE_MAX_RECTS */
+	struct pmem_cache_rect *rects;
+};
+
 int pmem_setup(struct android_pmem_platform_data *pdata,
 	       long (*ioctl)(struct file *, unsigned int, unsigned long),
 	       int (*release)(struct inode *, struct file *));
@@ -0,0 +1,26 @@
+/*
+ * async.h: running functions asynchronously, in kernel threads
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ */
+#ifndef _LINUX_ASYNC_H
+#define _LINUX_ASYNC_H
+
+#include <linux/types.h>
+
+/*
+ * Each scheduled function gets a cookie; cookies increase in the order the
+ * functions were scheduled, so waiting for one also orders against all
+ * that were scheduled before it.
+ */
+typedef u64 async_cookie_t;
+typedef void (async_func_ptr) (void *data, async_cookie_t cookie);
+
+extern async_cookie_t async_schedule(async_func_ptr *ptr, void *data);
+extern void async_synchronize_full(void);
+extern void async_synchronize_cookie(async_cookie_t cookie);
+
+#endif /* _LINUX_ASYNC_H */
@@ -18,6 +18,7 @@
 
 #ifdef CONFIG_HAS_EARLYSUSPEND
 #include <linux/list.h>
+#include <linux/types.h>
 #endif
 
 /* The early_suspend structure defines suspend and resume hooks to be called
@@ -29,18 +30,34 @@
  * the suspend handlers have already been called without a matching call to the
  * resume handlers, the suspend handler will be called directly from
  * register_early_suspend. This direct call can violate the normal level order.
+ * Handlers that set async do not depend on the others of their level: they
+ * run in parallel with them, and all of a level finish before the next level
+ * starts. They must not register or unregister early suspend handlers.
  */
 enum {
 	EARLY_SUSPEND_LEVEL_BLANK_SCREEN = 50,
 	EARLY_SUSPEND_LEVEL_STOP_DRAWING = 100,
 	EARLY_SUSPEND_LEVEL_DISABLE_FB = 150,
 };
+#ifdef CONFIG_HAS_EARLYSUSPEND
+/* How long a handler took, shown in /sys/power/early_suspend_stats */
+struct early_suspend_stats {
+	unsigned int count;
+	s64 total_ns;
+	s64 max_ns;
+	s64 last_ns;
+};
+#endif
+
 struct early_suspend {
 #ifdef CONFIG_HAS_EARLYSUSPEND
 	struct list_head link;
 	int level;
+	int async;
 	void (*suspend)(struct early_suspend *h);
 	void (*resume)(struct early_suspend *h);
+	struct early_suspend_stats suspend_stats;
+	struct early_suspend_stats resume_stats;
 #endif
 };
 
@@ -140,6 +140,7 @@ extern initcall_t __security_initcall_start[], __security_initcall_end[];
 
 /* Defined in init/main.c */
 extern int do_one_initcall(initcall_t fn);
+extern int async_initcall(initcall_t fn);
 extern char __initdata boot_command_line[];
 extern char *saved_command_line;
 extern unsigned int reset_devices;
@@ -201,6 +202,23 @@ extern void (*late_time_init)(void);
 #define late_initcall(fn)		__define_initcall("7",fn,7)
 #define late_initcall_sync(fn)		__define_initcall("7s",fn,7s)
 
+/*
+ * An asynchronous initcall is started at its place in the sequence but
+ * runs in a thread of its own while the initcalls after it go on.  Use it
+ * only for slow initialization that nothing later in the boot depends on,
+ * such as probes that mostly wait for hardware.  All of them have finished
+ * before the root filesystem is mounted and init is started.
+ */
+#define __define_async_initcall(level,fn,id) \
+	static int __init __async_initcall_##fn##id(void) \
+	{ \
+		return async_initcall(fn); \
+	} \
+	__define_initcall(level,__async_initcall_##fn##id,id)
+
+#define device_initcall_async(fn)	__define_async_initcall("6",fn,6)
+#define late_initcall_async(fn)		__define_async_initcall("7",fn,7)
+
 #define __initcall(fn) device_initcall(fn)
 
 #define __exitcall(fn) \
@@ -258,6 +276,15 @@ void __init parse_early_param(void);
  */
 #define module_init(x)	__initcall(x);
 
+/**
+ * module_init_async() - asynchronous driver initialization entry point
+ * @x: function to be run at kernel boot time or module insertion
+ *
+ * Like module_init(), but when builtin the function runs as an
+ * asynchronous initcall, see device_initcall_async().
+ */
+#define module_init_async(x)	device_initcall_async(x);
+
 /**
  * module_exit() - driver exit entry point
  * @x: function to be run when driver is removed
@@ -280,6 +307,9 @@ void __init parse_early_param(void);
 #define fs_initcall(fn)			module_init(fn)
 #define device_initcall(fn)		module_init(fn)
 #define late_initcall(fn)		module_init(fn)
+#define device_initcall_async(fn)	module_init(fn)
+#define late_initcall_async(fn)		module_init(fn)
+#define module_init_async(fn)		module_init(fn)
 
 #define security_initcall(fn)		module_init(fn)
 
@@ -12,12 +12,53 @@
 
 #define MEM_NOTIFY_FREQ (HZ/5)
 
+/*
+ * Memory pressure levels, in increasing order of urgency.  A reader of
+ * /dev/mem_notify subscribes to one of them by writing its name, and is
+ * then woken when the pressure reaches that level or a higher one.
+ */
+#define MEM_NOTIFY_NONE		0
+#define MEM_NOTIFY_LOW		1	/* working set is being reclaimed */
+#define MEM_NOTIFY_MEDIUM	2	/* reclaim is struggling to free pages */
+#define MEM_NOTIFY_CRITICAL	3	/* nothing left to reclaim: OOM is near */
+#define MEM_NOTIFY_NR_LEVELS	4
+
+/*
+ * Reclaim efficiency is judged over windows of this many scanned pages.
+ * The pressure of a window is the percentage of the scanned pages that
+ * could not be reclaimed.
+ */
+#define MEM_NOTIFY_WINDOW	(SWAP_CLUSTER_MAX * 16)
+#define MEM_NOTIFY_MEDIUM_PRESSURE	60
+#define MEM_NOTIFY_CRITICAL_PRESSURE	95
+/* A level is left once pressure is this far below the level's threshold */
+#define MEM_NOTIFY_HYSTERESIS		10
+
+struct mem_cgroup;
+
 extern atomic_long_t last_mem_notify;
 extern struct file_operations mem_notify_fops;
+extern const char *const mem_notify_level_name[MEM_NOTIFY_NR_LEVELS];
 
-extern void __memory_pressure_notify(struct zone *zone, int pressure);
+extern void __memory_pressure_notify(struct zone *zone, int level);
+extern void mem_notify_reclaim(struct zone *zone, unsigned long scanned,
+			       unsigned long reclaimed);
+extern int mem_notify_window_level(int level, unsigned long scanned,
+				   unsigned long reclaimed);
+extern void mem_notify_memcg_wakeup(struct mem_cgroup *memcg, int level);
 
-static inline void memory_pressure_notify(struct zone *zone, int pressure)
+/**
+ * memory_pressure_notify - report the memory pressure level of a zone
+ * @zone: the zone
+ * @level: MEM_NOTIFY_LOW or higher when @zone is under pressure,
+ *         MEM_NOTIFY_NONE when the pressure has gone
+ *
+ * Raising the level wakes the subscribed readers at once; reporting the
+ * same level again does so at most every MEM_NOTIFY_FREQ.  A lower level
+ * other than MEM_NOTIFY_NONE is ignored: levels drop through hysteresis
+ * in mem_notify_reclaim(), or all at once when the zone is balanced again.
+ */
+static inline void memory_pressure_notify(struct zone *zone, int level)
 {
 	unsigned long target;
 	unsigned long pages_high, pages_free, pages_reserve;
@@ -25,21 +66,37 @@ static inline void memory_pressure_notify(struct zone *zone, int pressure)
 	if (unlikely(zone->mem_notify_status == -1))
 		return;
 
-	if (pressure) {
-		target = atomic_long_read(&last_mem_notify) + MEM_NOTIFY_FREQ;
-		if (likely(time_before(jiffies, target)))
+	if (level) {
+		if (level < zone->mem_notify_status)
 			return;
+		if (level == zone->mem_notify_status) {
+			target = atomic_long_read(&last_mem_notify) +
+				 MEM_NOTIFY_FREQ;
+			if (likely(time_before(jiffies, target)))
+				return;
+		}
 
 		pages_high = zone->pages_high;
 		pages_free = zone_page_state(zone, NR_FREE_PAGES);
 		pages_reserve = zone->lowmem_reserve[MAX_NR_ZONES-1];
-		if (unlikely(pages_free > (pages_high+pages_reserve)*2))
+		if (unlikely(level < MEM_NOTIFY_CRITICAL &&
+			     pages_free > (pages_high+pages_reserve)*2))
 			return;
 
 	} else if (likely(!zone->mem_notify_status))
 		return;
 
-	__memory_pressure_notify(zone, pressure);
+	__memory_pressure_notify(zone, level);
+}
+
+/*
+ * The condition for @level has gone: drop the zone back to no pressure,
+ * unless it has meanwhile been raised to a higher level.
+ */
+static inline void memory_pressure_clear(struct zone *zone, int level)
+{
+	if (unlikely(zone->mem_notify_status == level))
+		__memory_pressure_notify(zone, MEM_NOTIFY_NONE);
 }
 
 #endif /* _LINUX_MEM_NOTIFY_H */
@@ -113,6 +113,7 @@ extern unsigned int kobjsize(const void *objp);
 #define VM_CAN_NONLINEAR 0x08000000	/* Has ->fault & does nonlinear pages */
 #define VM_MIXEDMAP	0x10000000	/* Can contain "struct page" and pure PFN pages */
 #define VM_SAO		0x20000000	/* Strong Access Ordering (powerpc) */
+#define VM_MERGEABLE	0x80000000	/* KSM may merge identical pages */
 
 #ifndef VM_STACK_DEFAULT_FLAGS		/* arch can override this */
 #define VM_STACK_DEFAULT_FLAGS VM_DATA_DEFAULT_FLAGS
@@ -1180,6 +1181,21 @@ void page_cache_async_readahead(struct address_space *mapping,
 
 unsigned long max_sane_readahead(unsigned long nr);
 
+#ifdef CONFIG_READAHEAD_REPLAY
+extern int readahead_recording;
+extern void __readahead_record(struct file *filp, pgoff_t index);
+
+static inline void readahead_record(struct file *filp, pgoff_t index)
+{
+	if (unlikely(readahead_recording))
+		__readahead_record(filp, index);
+}
+#else
+static inline void readahead_record(struct file *filp, pgoff_t index)
+{
+}
+#endif
+
 /* Do stack extension */
 extern int expand_stack(struct vm_area_struct *vma, unsigned long address);
 #ifdef CONFIG_IA64
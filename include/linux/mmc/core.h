@@ -10,6 +10,7 @@
 
 #include <linux/interrupt.h>
 #include <linux/device.h>
+#include <linux/completion.h>
 
 struct request;
 struct mmc_data;
@@ -115,6 +116,7 @@ struct mmc_data {
 
 	unsigned int		sg_len;		/* size of scatter list */
 	struct scatterlist	*sg;		/* I/O scatter list */
+	int			host_cookie;	/* host private, see pre_req */
 };
 
 struct mmc_request {
@@ -129,6 +131,20 @@ struct mmc_request {
 struct mmc_host;
 struct mmc_card;
 
+/*
+ * A request started with mmc_start_req(), which returns while it is on
+ * the bus.  err_check is called once it has completed, before the next
+ * one is started; it returns non-zero if the request failed.
+ */
+struct mmc_async_req {
+	struct mmc_request	*mrq;
+	int			(*err_check)(struct mmc_card *,
+					     struct mmc_async_req *);
+	struct completion	completion;
+};
+
+extern struct mmc_async_req *mmc_start_req(struct mmc_host *,
+					   struct mmc_async_req *, int *);
 extern void mmc_wait_for_req(struct mmc_host *, struct mmc_request *);
 extern int mmc_wait_for_cmd(struct mmc_host *, struct mmc_command *, int);
 extern int mmc_wait_for_app_cmd(struct mmc_host *, struct mmc_card *,
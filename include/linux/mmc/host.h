@@ -51,6 +51,18 @@ struct mmc_ios {
 
 struct mmc_host_ops {
 	void	(*request)(struct mmc_host *host, struct mmc_request *req);
+	/*
+	 * Optional: pre_req prepares the data of a request ahead of
+	 * request(), typically dma_map_sg, and post_req undoes it once the
+	 * request has completed or was dropped (err is non-zero then).
+	 * pre_req may run while another request is still on the bus;
+	 * is_first_req is set when none is.  Both are called from process
+	 * context, with the host claimed.
+	 */
+	void	(*pre_req)(struct mmc_host *host, struct mmc_request *req,
+			   bool is_first_req);
+	void	(*post_req)(struct mmc_host *host, struct mmc_request *req,
+			    int err);
 	/*
 	 * Avoid calling these three functions too often or in a "fast path",
 	 * since underlaying controller might implement them in an expensive
@@ -146,6 +158,8 @@ struct mmc_host {
 
 	struct delayed_work	detect;
 
+	struct mmc_async_req	*areq;		/* request on the bus, if any */
+
 	const struct mmc_bus_ops *bus_ops;	/* current bus driver */
 	unsigned int		bus_refs;	/* reference counter */
 
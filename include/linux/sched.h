@@ -406,6 +406,12 @@ extern int get_dumpable(struct mm_struct *mm);
 #define MMF_DUMP_FILTER_DEFAULT \
 	((1 << MMF_DUMP_ANON_PRIVATE) |	(1 << MMF_DUMP_ANON_SHARED))
 
+#define MMF_VM_MERGEABLE	16	/* KSM may merge identical pages */
+
+/* Only the coredump settings are inherited by a new mm */
+#define MMF_INIT_MASK \
+	(((1 << MMF_DUMPABLE_BITS) - 1) | MMF_DUMP_FILTER_MASK)
+
 struct sighand_struct {
 	atomic_t		count;
 	struct k_sigaction	action[_NSIG];
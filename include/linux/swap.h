@@ -188,12 +188,24 @@ extern void rotate_reclaimable_page(struct page *page);
 extern void swap_setup(void);
 
 /* linux/mm/vmscan.c */
+
+/* LRU Isolation modes. */
+#define ISOLATE_INACTIVE 0	/* Isolate inactive pages. */
+#define ISOLATE_ACTIVE 1	/* Isolate active pages. */
+#define ISOLATE_BOTH 2		/* Isolate both active and inactive pages. */
+
 extern unsigned long try_to_free_pages(struct zonelist *zonelist, int order,
 					gfp_t gfp_mask);
 extern unsigned long try_to_free_mem_cgroup_pages(struct mem_cgroup *mem,
 							gfp_t gfp_mask);
-extern int __isolate_lru_page(struct page *page, int mode);
+extern int __isolate_lru_page(struct page *page, int mode, int file);
+extern int isolate_lru_page(struct page *page, struct list_head *pagelist);
+extern void putback_lru_page(struct page *page);
+extern int putback_lru_pages(struct list_head *l);
+extern unsigned long reclaim_pages_from_list(struct list_head *page_list);
 extern unsigned long shrink_all_memory(unsigned long nr_pages);
+extern unsigned long zone_reclaimable_pages(struct zone *zone);
+extern unsigned long global_reclaimable_pages(void);
 extern int vm_swappiness;
 extern int remove_mapping(struct address_space *mapping, struct page *page);
 extern long vm_total_pages;
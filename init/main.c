@@ -60,6 +60,7 @@
 #include <linux/sched.h>
 #include <linux/signal.h>
 #include <linux/idr.h>
+#include <linux/async.h>
 
 #include <asm/io.h>
 #include <asm/bugs.h>
@@ -71,6 +72,8 @@
 #include <asm/smp.h>
 #endif
 
+#include "timeline.h"
+
 /*
  * This is one of the first .c files built. Error out early if we have compiler
  * trouble.
@@ -733,19 +736,23 @@ __setup("initcall_debug", initcall_debug_setup);
 int do_one_initcall(initcall_t fn)
 {
 	int count = preempt_count();
+	int timeline = boot_timeline_active();
 	ktime_t t0, t1, delta;
 	char msgbuf[64];
 	int result;
 
-	if (initcall_debug) {
+	if (initcall_debug)
 		printk("calling  %pF\n", fn);
+	if (initcall_debug || timeline)
 		t0 = ktime_get();
-	}
 
 	result = fn();
 
-	if (initcall_debug) {
+	if (initcall_debug || timeline)
 		t1 = ktime_get();
+	if (timeline)
+		boot_timeline_add(fn, NULL, t0, t1, result);
+	if (initcall_debug) {
 		delta = ktime_sub(t1, t0);
 
 		printk("initcall %pF returned %d after %Ld msecs\n",
@@ -774,15 +781,36 @@ int do_one_initcall(initcall_t fn)
 }
 
 
+static void __init do_async_initcall(void *data, async_cookie_t cookie)
+{
+	do_one_initcall(data);
+}
+
+/*
+ * Queue an initcall to run in an async thread, for the stubs that
+ * device_initcall_async() and friends generate.
+ */
+int __init async_initcall(initcall_t fn)
+{
+	async_schedule(do_async_initcall, fn);
+	return 0;
+}
+
 extern initcall_t __initcall_start[], __initcall_end[], __early_initcall_end[];
 
 static void __init do_initcalls(void)
 {
 	initcall_t *call;
+	ktime_t t0;
 
 	for (call = __early_initcall_end; call < __initcall_end; call++)
 		do_one_initcall(*call);
 
+	/* Asynchronous initcalls may be what provides the root device */
+	t0 = ktime_get();
+	async_synchronize_full();
+	boot_timeline_add(NULL, "async_synchronize_full", t0, ktime_get(), 0);
+
 	/* Make sure there is no pending stuff from the initcall sequence */
 	flush_scheduled_work();
 }
@@ -840,6 +868,8 @@ static int noinline init_post(void)
 
 	current->signal->flags |= SIGNAL_UNKILLABLE;
 
+	boot_timeline_add(NULL, "init", ktime_get(), ktime_get(), 0);
+
 	if (ramdisk_execute_command) {
 		run_init_process(ramdisk_execute_command);
 		printk(KERN_WARNING "Failed to execute %s\n",
@@ -0,0 +1,130 @@
+/*
+ * init/timeline.c: the boot timeline in /proc/boot_timeline
+ *
+ * Every initcall is recorded with when it started and returned, the
+ * thread it ran in and what it returned, so that the time to starting
+ * init can be measured and whatever holds it up found.  Asynchronous
+ * initcalls show up twice: the call that queued them, in the init
+ * thread, and the initcall itself in an async thread.  The wait for the
+ * asynchronous initcalls and the start of init are recorded as well.
+ *
+ * Times are in microseconds since boot.  One line per event, in the
+ * order they finished:
+ *
+ *	start end pid thread ret name
+ */
+
+#include <linux/kallsyms.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/proc_fs.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+
+#include "timeline.h"
+
+struct boot_timeline_entry {
+	struct list_head	list;
+	initcall_t		fn;
+	const char		*name;	/* if not an initcall */
+	s64			start;
+	s64			end;
+	pid_t			pid;
+	int			ret;
+	char			comm[TASK_COMM_LEN];
+};
+
+static LIST_HEAD(boot_timeline);
+static DEFINE_MUTEX(boot_timeline_mutex);
+
+void boot_timeline_add(initcall_t fn, const char *name, ktime_t start,
+		       ktime_t end, int ret)
+{
+	struct boot_timeline_entry *e;
+
+	e = kmalloc(sizeof(*e), GFP_KERNEL);
+	if (!e)
+		return;
+	e->fn = fn;
+	e->name = name;
+	e->start = ktime_to_us(start);
+	e->end = ktime_to_us(end);
+	e->pid = current->pid;
+	e->ret = ret;
+	get_task_comm(e->comm, current);
+
+	mutex_lock(&boot_timeline_mutex);
+	list_add_tail(&e->list, &boot_timeline);
+	mutex_unlock(&boot_timeline_mutex);
+}
+
+static void *boot_timeline_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&boot_timeline_mutex);
+	return seq_list_start_head(&boot_timeline, *pos);
+}
+
+static void *boot_timeline_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	return seq_list_next(v, &boot_timeline, pos);
+}
+
+static void boot_timeline_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&boot_timeline_mutex);
+}
+
+static int boot_timeline_show(struct seq_file *m, void *v)
+{
+	struct boot_timeline_entry *e;
+	char namebuf[KSYM_NAME_LEN];
+	unsigned long size, offset;
+	const char *name;
+	char *modname;
+
+	if (v == &boot_timeline) {
+		seq_puts(m, "# start_us end_us pid thread ret name\n");
+		return 0;
+	}
+
+	e = list_entry(v, struct boot_timeline_entry, list);
+	name = e->name;
+	if (!name)
+		name = kallsyms_lookup((unsigned long)e->fn, &size, &offset,
+				       &modname, namebuf);
+	seq_printf(m, "%lld %lld %d %s %d ", e->start, e->end, e->pid,
+		   e->comm, e->ret);
+	if (name)
+		seq_printf(m, "%s\n", name);
+	else
+		seq_printf(m, "%p\n", e->fn);
+	return 0;
+}
+
+static const struct seq_operations boot_timeline_op = {
+	.start	= boot_timeline_start,
+	.next	= boot_timeline_next,
+	.stop	= boot_timeline_stop,
+	.show	= boot_timeline_show,
+};
+
+static int boot_timeline_open(struct inode *inode, struct file *file)
+{
+	return seq_open(file, &boot_timeline_op);
+}
+
+static const struct file_operations proc_boot_timeline_operations = {
+	.open		= boot_timeline_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= seq_release,
+};
+
+static int __init boot_timeline_init(void)
+{
+	proc_create("boot_timeline", S_IRUSR, NULL,
+		    &proc_boot_timeline_operations);
+	return 0;
+}
+fs_initcall(boot_timeline_init);
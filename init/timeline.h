@@ -0,0 +1,24 @@
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+
+#ifdef CONFIG_BOOT_TIMELINE
+void boot_timeline_add(initcall_t fn, const char *name, ktime_t start,
+		       ktime_t end, int ret);
+
+/* module initcalls, once init is running, are not recorded */
+static inline int boot_timeline_active(void)
+{
+	return system_state == SYSTEM_BOOTING;
+}
+#else
+static inline int boot_timeline_active(void)
+{
+	return 0;
+}
+
+static inline void boot_timeline_add(initcall_t fn, const char *name,
+				     ktime_t start, ktime_t end, int ret)
+{
+}
+#endif
@@ -0,0 +1,213 @@
+/*
+ * kernel/async.c: running functions asynchronously, in kernel threads
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; version 2
+ * of the License.
+ *
+ * async_schedule() queues a function to run in one of a small pool of
+ * "async/N" threads, started on demand, and returns a cookie for it.
+ * It is meant for slow initialization that mostly sleeps (hardware
+ * resets, firmware downloads, flash scans) and that nothing else needs
+ * right away, so that several of them can wait at the same time instead
+ * of one after the other.
+ *
+ * async_synchronize_cookie() waits for every function scheduled before
+ * the given cookie, async_synchronize_full() for all of them.  Functions
+ * are started in the order they were scheduled, but may finish in any
+ * order.
+ *
+ * Booting with "noasync" runs every function synchronously, in the
+ * caller, which helps to tell whether a problem is an ordering one.
+ */
+
+#include <linux/async.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#define MAX_THREADS	8
+/* An idle thread exits after this long without new work */
+#define THREAD_IDLE	HZ
+
+struct async_entry {
+	struct list_head	list;
+	async_cookie_t		cookie;
+	async_func_ptr		*func;
+	void			*data;
+};
+
+/* Both lists are in cookie order: entries are started in that order */
+static LIST_HEAD(async_pending);
+static LIST_HEAD(async_running);
+static DEFINE_SPINLOCK(async_lock);
+static async_cookie_t next_cookie = 1;
+
+static int nr_async_threads;
+static int nr_async_idle;
+
+static DECLARE_WAIT_QUEUE_HEAD(async_new);
+static DECLARE_WAIT_QUEUE_HEAD(async_done);
+
+static int async_enabled = 1;
+
+static int __init setup_noasync(char *str)
+{
+	async_enabled = 0;
+	return 1;
+}
+__setup("noasync", setup_noasync);
+
+/* The lowest cookie not finished yet */
+static async_cookie_t lowest_in_progress(void)
+{
+	async_cookie_t ret;
+
+	spin_lock_irq(&async_lock);
+	if (!list_empty(&async_running))
+		ret = list_first_entry(&async_running, struct async_entry,
+				       list)->cookie;
+	else if (!list_empty(&async_pending))
+		ret = list_first_entry(&async_pending, struct async_entry,
+				       list)->cookie;
+	else
+		ret = next_cookie;
+	spin_unlock_irq(&async_lock);
+	return ret;
+}
+
+static void run_one_entry(void)
+{
+	struct async_entry *entry;
+
+	/* async_lock is held on entry, and dropped while the function runs */
+	entry = list_first_entry(&async_pending, struct async_entry, list);
+	list_move_tail(&entry->list, &async_running);
+	spin_unlock_irq(&async_lock);
+
+	entry->func(entry->data, entry->cookie);
+
+	spin_lock_irq(&async_lock);
+	list_del(&entry->list);
+	spin_unlock_irq(&async_lock);
+	kfree(entry);
+
+	wake_up_all(&async_done);
+	spin_lock_irq(&async_lock);
+}
+
+static int async_thread(void *unused)
+{
+	spin_lock_irq(&async_lock);
+	for (;;) {
+		if (!list_empty(&async_pending)) {
+			run_one_entry();
+			continue;
+		}
+
+		nr_async_idle++;
+		spin_unlock_irq(&async_lock);
+		wait_event_timeout(async_new, !list_empty(&async_pending),
+				   THREAD_IDLE);
+		spin_lock_irq(&async_lock);
+		nr_async_idle--;
+
+		if (list_empty(&async_pending))
+			break;
+	}
+	nr_async_threads--;
+	spin_unlock_irq(&async_lock);
+	return 0;
+}
+
+/**
+ * async_schedule - run a function asynchronously
+ * @ptr: the function, called as ptr(data, cookie)
+ * @data: its argument
+ *
+ * Returns the cookie of the function.  If it cannot be queued it is run
+ * before async_schedule() returns.  Must be called from process context.
+ */
+async_cookie_t async_schedule(async_func_ptr *ptr, void *data)
+{
+	struct async_entry *entry;
+	struct task_struct *thread;
+	async_cookie_t cookie;
+	int start = -1;
+
+	entry = async_enabled ? kzalloc(sizeof(*entry), GFP_KERNEL) : NULL;
+
+	spin_lock_irq(&async_lock);
+	cookie = next_cookie++;
+	if (!entry) {
+		spin_unlock_irq(&async_lock);
+		ptr(data, cookie);
+		return cookie;
+	}
+	entry->cookie = cookie;
+	entry->func = ptr;
+	entry->data = data;
+	list_add_tail(&entry->list, &async_pending);
+	if (!nr_async_idle && nr_async_threads < MAX_THREADS)
+		start = nr_async_threads++;
+	spin_unlock_irq(&async_lock);
+
+	if (start < 0) {
+		wake_up(&async_new);
+		return cookie;
+	}
+
+	thread = kthread_run(async_thread, NULL, "async/%d", start);
+	if (IS_ERR(thread)) {
+		spin_lock_irq(&async_lock);
+		nr_async_threads--;
+		/* Nobody else to run it: run whatever is queued here */
+		if (!nr_async_threads)
+			while (!list_empty(&async_pending))
+				run_one_entry();
+		spin_unlock_irq(&async_lock);
+	}
+
+	return cookie;
+}
+EXPORT_SYMBOL_GPL(async_schedule);
+
+/**
+ * async_synchronize_cookie - wait for functions scheduled before a cookie
+ * @cookie: the cookie returned by async_schedule()
+ *
+ * Waits until every function scheduled before @cookie has returned.
+ */
+void async_synchronize_cookie(async_cookie_t cookie)
+{
+	wait_event(async_done, lowest_in_progress() >= cookie);
+}
+EXPORT_SYMBOL_GPL(async_synchronize_cookie);
+
+/**
+ * async_synchronize_full - wait for all asynchronous functions
+ *
+ * Includes the ones that asynchronous functions schedule while this
+ * waits.
+ */
+void async_synchronize_full(void)
+{
+	async_cookie_t cookie, done = 0;
+
+	for (;;) {
+		spin_lock_irq(&async_lock);
+		cookie = next_cookie;
+		spin_unlock_irq(&async_lock);
+		if (cookie == done)
+			break;
+		async_synchronize_cookie(cookie);
+		done = cookie;
+	}
+}
+EXPORT_SYMBOL_GPL(async_synchronize_full);
@@ -15,6 +15,7 @@
 #include <linux/random.h>
 #include <linux/interrupt.h>
 #include <linux/kernel_stat.h>
+#include <linux/marker.h>
 
 #include "internals.h"
 
@@ -136,6 +137,7 @@ irqreturn_t handle_IRQ_event(unsigned int irq, struct irqaction *action)
 	if (!(action->flags & IRQF_DISABLED))
 		local_irq_enable_in_hardirq();
 
+	trace_mark(kernel_irq_entry, "irq %u", irq);
 	do {
 		ret = action->handler(irq, action->dev_id);
 		if (ret == IRQ_HANDLED)
@@ -143,6 +145,7 @@ irqreturn_t handle_IRQ_event(unsigned int irq, struct irqaction *action)
 		retval |= ret;
 		action = action->next;
 	} while (action);
+	trace_mark(kernel_irq_exit, "irq %u ret %d", irq, retval);
 
 	if (status & IRQF_SAMPLE_RANDOM)
 		add_interrupt_randomness(irq);
@@ -13,7 +13,11 @@
  *
  */
 
+#include <linux/async.h>
 #include <linux/earlysuspend.h>
+#include <linux/kallsyms.h>
+#include <linux/ktime.h>
+#include <linux/marker.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/rtc.h>
@@ -50,6 +54,9 @@ enum {
 	SUSPEND_REQUESTED_AND_SUSPENDED = SUSPEND_REQUESTED | SUSPENDED,
 };
 static int state;
+/* How long the last early_suspend() and late_resume() took, all handlers */
+static s64 last_suspend_ns;
+static s64 last_resume_ns;
 
 void register_early_suspend(struct early_suspend *handler)
 {
@@ -77,11 +84,78 @@ void unregister_early_suspend(struct early_suspend *handler)
 }
 EXPORT_SYMBOL(unregister_early_suspend);
 
-static void early_suspend(struct work_struct *work)
+static void call_handler(struct early_suspend *h, int resume)
+{
+	void (*fn)(struct early_suspend *h) = resume ? h->resume : h->suspend;
+	struct early_suspend_stats *stats =
+		resume ? &h->resume_stats : &h->suspend_stats;
+	ktime_t start;
+	s64 ns;
+
+	start = ktime_get();
+	fn(h);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	stats->count++;
+	stats->total_ns += ns;
+	stats->last_ns = ns;
+	if (ns > stats->max_ns)
+		stats->max_ns = ns;
+}
+
+static void suspend_handler_async(void *data, async_cookie_t cookie)
+{
+	call_handler(data, 0);
+}
+
+static void resume_handler_async(void *data, async_cookie_t cookie)
 {
+	call_handler(data, 1);
+}
+
+/*
+ * Call the suspend (in level order) or resume (in reverse level order)
+ * handlers whose level is in [min_level, max_level).  Async handlers are
+ * queued, and waited for before moving on to another level.  Called with
+ * early_suspend_lock held, which keeps the list stable while they run.
+ */
+static void call_handlers(int resume, int min_level, int max_level)
+{
+	struct list_head *head = &early_suspend_handlers;
+	struct list_head *p;
 	struct early_suspend *pos;
+	async_cookie_t cookie = 0;
+	int level = 0;
+
+	for (p = resume ? head->prev : head->next; p != head;
+	     p = resume ? p->prev : p->next) {
+		pos = list_entry(p, struct early_suspend, link);
+		if (pos->level < min_level || pos->level >= max_level)
+			continue;
+		if (!(resume ? pos->resume : pos->suspend))
+			continue;
+
+		if (cookie && pos->level != level) {
+			async_synchronize_cookie(cookie + 1);
+			cookie = 0;
+		}
+		level = pos->level;
+
+		if (pos->async)
+			cookie = async_schedule(resume ? resume_handler_async :
+						suspend_handler_async, pos);
+		else
+			call_handler(pos, resume);
+	}
+	if (cookie)
+		async_synchronize_cookie(cookie + 1);
+}
+
+static void early_suspend(struct work_struct *work)
+{
 	unsigned long irqflags;
 	int abort = 0;
+	ktime_t start;
         
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -104,10 +178,11 @@ static void early_suspend(struct work_struct *work)
 	// for LCD
 	lcd_suspend = 1;
 
-	list_for_each_entry(pos, &early_suspend_handlers, link) {
-		if (pos->suspend != NULL)
-			pos->suspend(pos);
-	}
+	start = ktime_get();
+	trace_mark(power_early_suspend, "done %d", 0);
+	call_handlers(0, INT_MIN, INT_MAX);
+	trace_mark(power_early_suspend, "done %d", 1);
+	last_suspend_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 	mutex_unlock(&early_suspend_lock);
 
 	if (debug_mask & DEBUG_SUSPEND)
@@ -124,10 +199,9 @@ abort:
 
 static void late_resume(struct work_struct *work)
 {
-	struct early_suspend *pos;
 	unsigned long irqflags;
 	int abort = 0;
-	int level;
+	ktime_t start;
  
 	mutex_lock(&early_suspend_lock);
 	spin_lock_irqsave(&state_lock, irqflags);
@@ -148,26 +222,17 @@ static void late_resume(struct work_struct *work)
 	// for LCD
 	lcd_suspend = 0;  
 	
-	list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-	    level = pos->level;	    
-	    
-            if (lcd_is_on || bridge_on) {  
-                if (pos->level >= 148 ) {
-                    if (debug_mask & DEBUG_SUSPEND)
-                        printk("skip	lcd_is_on(%d), bridge_on(%d)\n", lcd_is_on, bridge_on);           	
-                }                     
-                else
-                {
-	            if (pos->resume != NULL)
-		        pos->resume(pos);
-	        }	
-            }
-            else 
-            {                      
-	        if (pos->resume != NULL)
-		    pos->resume(pos);
-	    }	
-	}
+	start = ktime_get();
+	trace_mark(power_late_resume, "done %d", 0);
+	/* The LCD levels (>= 148) may have been resumed already */
+	if (lcd_is_on || bridge_on) {
+		if (debug_mask & DEBUG_SUSPEND)
+			printk("skip	lcd_is_on(%d), bridge_on(%d)\n", lcd_is_on, bridge_on);
+		call_handlers(1, INT_MIN, 148);
+	} else
+		call_handlers(1, INT_MIN, INT_MAX);
+	trace_mark(power_late_resume, "done %d", 1);
+	last_resume_ns = ktime_to_ns(ktime_sub(ktime_get(), start));
 	lcd_is_on = 1;	
 	if (debug_mask & DEBUG_SUSPEND)
 		pr_info("late_resume: done\n");
@@ -179,9 +244,6 @@ void request_suspend_state(suspend_state_t new_state)
 {
 	unsigned long irqflags;
 	int old_sleep;
-        
-	struct early_suspend *pos;  
-        int level;                 
 	int abort = 0;             
 
         if (debug_mask & DEBUG_SUSPEND)
@@ -239,14 +301,7 @@ void request_suspend_state(suspend_state_t new_state)
     
 	    // just turn on the LCD. 
 	    lcd_suspend = 0;
-	    list_for_each_entry_reverse(pos, &early_suspend_handlers, link) {
-                level = pos->level;
-                if (level >= 148) {
-  	            if (pos->resume != NULL) {
-	                pos->resume(pos);
-	            }
-	        }	        
-            }
+	    call_handlers(1, 148, INT_MAX);
             lcd_is_on = 1;
 	}
 abort:
@@ -258,3 +313,79 @@ suspend_state_t get_suspend_state(void)
 {
 	return requested_suspend_state;
 }
+
+static unsigned long long ns_to_us(s64 ns)
+{
+	u64 us = ns;
+
+	do_div(us, NSEC_PER_USEC);
+	return us;
+}
+
+static void early_suspend_stats_print(struct early_suspend_stats *stats,
+				      char **buf, char *end)
+{
+	u64 avg = stats->total_ns;
+
+	if (stats->count)
+		do_div(avg, stats->count);
+	*buf += scnprintf(*buf, end - *buf, " %6u %8llu %8llu %8llu",
+			  stats->count, ns_to_us(avg), ns_to_us(stats->max_ns),
+			  ns_to_us(stats->last_ns));
+}
+
+/*
+ * /sys/power/early_suspend_stats: one line per handler, in suspend order,
+ * with the number of calls and the average, longest and last duration in
+ * microseconds of its suspend and resume calls.  Writing "reset" clears
+ * them.
+ */
+ssize_t early_suspend_stats_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf)
+{
+	struct early_suspend *pos;
+	char name[KSYM_NAME_LEN];
+	char *s = buf, *end = buf + PAGE_SIZE;
+	void *fn;
+
+	mutex_lock(&early_suspend_lock);
+	s += scnprintf(s, end - s, "last early_suspend %llu us, "
+		       "late_resume %llu us\n",
+		       ns_to_us(last_suspend_ns), ns_to_us(last_resume_ns));
+	s += scnprintf(s, end - s, "%-32s %5s %5s %6s %8s %8s %8s "
+		       "%6s %8s %8s %8s\n", "handler", "level", "async",
+		       "susp", "avg", "max", "last",
+		       "resume", "avg", "max", "last");
+	list_for_each_entry(pos, &early_suspend_handlers, link) {
+		fn = pos->suspend ? (void *)pos->suspend : (void *)pos->resume;
+		if (!fn || lookup_symbol_name((unsigned long)fn, name))
+			snprintf(name, sizeof(name), "%p", fn);
+		s += scnprintf(s, end - s, "%-32s %5d %5d", name, pos->level,
+			       pos->async);
+		early_suspend_stats_print(&pos->suspend_stats, &s, end);
+		early_suspend_stats_print(&pos->resume_stats, &s, end);
+		s += scnprintf(s, end - s, "\n");
+	}
+	mutex_unlock(&early_suspend_lock);
+	return s - buf;
+}
+
+ssize_t early_suspend_stats_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t n)
+{
+	struct early_suspend *pos;
+
+	if (strncmp(buf, "reset", 5))
+		return -EINVAL;
+
+	mutex_lock(&early_suspend_lock);
+	list_for_each_entry(pos, &early_suspend_handlers, link) {
+		memset(&pos->suspend_stats, 0, sizeof(pos->suspend_stats));
+		memset(&pos->resume_stats, 0, sizeof(pos->resume_stats));
+	}
+	last_suspend_ns = 0;
+	last_resume_ns = 0;
+	mutex_unlock(&early_suspend_lock);
+	return n;
+}
@@ -22,6 +22,7 @@
 #include <linux/vmstat.h>
 #include <linux/syscalls.h>
 #include <linux/ftrace.h>
+#include <linux/marker.h>
 
 #include "power.h"
 
@@ -307,8 +308,10 @@ static int suspend_enter(suspend_state_t state)
 		goto Done;
 	}
 
+	trace_mark(power_suspend_enter, "state %d", state);
 	if (!suspend_test(TEST_CORE))
 		error = suspend_ops->enter(state);
+	trace_mark(power_suspend_exit, "state %d error %d", state, error);
 
 	device_power_up(PMSG_RESUME);
  Done:
@@ -673,6 +676,10 @@ power_attr(wake_lock);
 power_attr(wake_unlock);
 #endif
 
+#ifdef CONFIG_EARLYSUSPEND
+power_attr(early_suspend_stats);
+#endif
+
 static struct attribute * g[] = {
 	&state_attr.attr,
 #ifdef CONFIG_PM_TRACE
@@ -684,6 +691,9 @@ static struct attribute * g[] = {
 #ifdef CONFIG_USER_WAKELOCK
 	&wake_lock_attr.attr,
 	&wake_unlock_attr.attr,
+#endif
+#ifdef CONFIG_EARLYSUSPEND
+	&early_suspend_stats_attr.attr,
 #endif
 	&ftm_sleep_attr.attr,
 	NULL,
@@ -246,4 +246,9 @@ ssize_t  wake_unlock_store(struct kobject *kobj, struct kobj_attribute *attr,
 /* kernel/power/earlysuspend.c */
 void request_suspend_state(suspend_state_t state);
 suspend_state_t get_suspend_state(void);
+ssize_t early_suspend_stats_show(struct kobject *kobj,
+				 struct kobj_attribute *attr, char *buf);
+ssize_t early_suspend_stats_store(struct kobject *kobj,
+				  struct kobj_attribute *attr,
+				  const char *buf, size_t n);
 #endif
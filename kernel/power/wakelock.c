@@ -14,6 +14,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/marker.h>
 #include <linux/platform_device.h>
 #include <linux/rtc.h>
 #include <linux/suspend.h>
@@ -438,6 +439,8 @@ static void wake_lock_internal(
 		lock->flags &= ~WAKE_LOCK_AUTO_EXPIRE;
 		list_add(&lock->link, &active_wake_locks[type]);
 	}
+	trace_mark(power_wake_lock, "name %s type %d timeout %ld",
+		   lock->name, type, has_timeout ? timeout : -1);
 	if (type == WAKE_LOCK_SUSPEND) {
 		if (lock == &main_wake_lock)
 			current_event_num++;
@@ -491,6 +494,7 @@ void wake_unlock(struct wake_lock *lock)
 #endif
 	if (debug_mask & DEBUG_WAKE_LOCK)
 		pr_info("wake_unlock: %s\n", lock->name);
+	trace_mark(power_wake_unlock, "name %s type %d", lock->name, type);
 	lock->flags &= ~(WAKE_LOCK_ACTIVE | WAKE_LOCK_AUTO_EXPIRE);
 	list_del(&lock->link);
 	list_add(&lock->link, &inactive_locks);
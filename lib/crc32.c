@@ -27,13 +27,19 @@
 #include <linux/types.h>
 #include <linux/slab.h>
 #include <linux/init.h>
+#include <linux/hrtimer.h>
+#include <linux/cache.h>
 #include <asm/atomic.h>
+#include <asm/div64.h>
 #include "crc32defs.h"
-#if CRC_LE_BITS == 8
+#if CRC_LE_BITS >= 8
 #define tole(x) __constant_cpu_to_le32(x)
-#define tobe(x) __constant_cpu_to_be32(x)
 #else
 #define tole(x) (x)
+#endif
+#if CRC_BE_BITS >= 8
+#define tobe(x) __constant_cpu_to_be32(x)
+#else
 #define tobe(x) (x)
 #endif
 #include "crc32table.h"
@@ -42,6 +48,82 @@ MODULE_AUTHOR("Matt Domsch <Matt_Domsch@dell.com>");
 MODULE_DESCRIPTION("Ethernet CRC32 calculations");
 MODULE_LICENSE("GPL");
 
+#if CRC_LE_BITS > 8 || CRC_BE_BITS > 8
+#if CRC_BE_BITS > 8 && CRC_BE_BITS != CRC_LE_BITS
+# error Slicing CRC_BE_BITS must match CRC_LE_BITS
+#endif
+/*
+ * Slicing by 4 or 8: xor the crc into the next 32-bit word and look
+ * each of its bytes up in its own table, which already accounts for
+ * the bytes still to follow in this step.  The tables and the crc are
+ * kept in the byte order of the data, as in the byte-at-a-time code.
+ */
+static inline u32
+crc32_body(u32 crc, unsigned char const *buf, size_t len, const u32 (*tab)[256])
+{
+# ifdef __LITTLE_ENDIAN
+#  define DO_CRC(x) crc = t0[(crc ^ (x)) & 255] ^ (crc >> 8)
+#  define DO_CRC4 (t3[(q) & 255] ^ t2[(q >> 8) & 255] ^ \
+		   t1[(q >> 16) & 255] ^ t0[(q >> 24) & 255])
+#  define DO_CRC8 (t7[(q) & 255] ^ t6[(q >> 8) & 255] ^ \
+		   t5[(q >> 16) & 255] ^ t4[(q >> 24) & 255])
+# else
+#  define DO_CRC(x) crc = t0[((crc >> 24) ^ (x)) & 255] ^ (crc << 8)
+#  define DO_CRC4 (t0[(q) & 255] ^ t1[(q >> 8) & 255] ^ \
+		   t2[(q >> 16) & 255] ^ t3[(q >> 24) & 255])
+#  define DO_CRC8 (t4[(q) & 255] ^ t5[(q >> 8) & 255] ^ \
+		   t6[(q >> 16) & 255] ^ t7[(q >> 24) & 255])
+# endif
+	const u32 *b;
+	size_t rem_len;
+	const u32 *t0 = tab[0], *t1 = tab[1], *t2 = tab[2], *t3 = tab[3];
+# if CRC_LE_BITS == 64
+	const u32 *t4 = tab[4], *t5 = tab[5], *t6 = tab[6], *t7 = tab[7];
+# endif
+	u32 q;
+
+	/* Align it */
+	if (unlikely((long)buf & 3 && len)) {
+		do {
+			DO_CRC(*buf++);
+		} while ((--len) && ((long)buf) & 3);
+	}
+
+# if CRC_LE_BITS == 32
+	rem_len = len & 3;
+	len = len >> 2;
+# else
+	rem_len = len & 7;
+	len = len >> 3;
+# endif
+
+	b = (const u32 *)buf;
+	for (--b; len; --len) {
+		q = crc ^ *++b; /* use pre increment for speed */
+# if CRC_LE_BITS == 32
+		crc = DO_CRC4;
+# else
+		crc = DO_CRC8;
+		q = *++b;
+		crc ^= DO_CRC4;
+# endif
+	}
+
+	/* And the last few bytes */
+	len = rem_len;
+	if (len) {
+		const u8 *p = (const u8 *)(b + 1) - 1;
+		do {
+			DO_CRC(*++p); /* use pre increment for speed */
+		} while (--len);
+	}
+	return crc;
+#undef DO_CRC
+#undef DO_CRC4
+#undef DO_CRC8
+}
+#endif
+
 /**
  * crc32_le() - Calculate bitwise little-endian Ethernet AUTODIN II CRC32
  * @crc: seed value for computation.  ~0 for Ethernet, sometimes 0 for
@@ -71,9 +153,13 @@ u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 
 u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 {
-# if CRC_LE_BITS == 8
+# if CRC_LE_BITS > 8
+	crc = __cpu_to_le32(crc);
+	crc = crc32_body(crc, p, len, crc32table_le);
+	return __le32_to_cpu(crc);
+# elif CRC_LE_BITS == 8
 	const u32      *b =(u32 *)p;
-	const u32      *tab = crc32table_le;
+	const u32      *tab = crc32table_le[0];
 
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[ (crc ^ (x)) & 255 ] ^ (crc>>8)
@@ -121,17 +207,17 @@ u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 # elif CRC_LE_BITS == 4
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
-		crc = (crc >> 4) ^ crc32table_le[crc & 15];
+		crc = (crc >> 4) ^ crc32table_le[0][crc & 15];
+		crc = (crc >> 4) ^ crc32table_le[0][crc & 15];
 	}
 	return crc;
 # elif CRC_LE_BITS == 2
 	while (len--) {
 		crc ^= *p++;
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
-		crc = (crc >> 2) ^ crc32table_le[crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
+		crc = (crc >> 2) ^ crc32table_le[0][crc & 3];
 	}
 	return crc;
 # endif
@@ -169,9 +255,13 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 #else				/* Table-based approach */
 u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 {
-# if CRC_BE_BITS == 8
+# if CRC_BE_BITS > 8
+	crc = __cpu_to_be32(crc);
+	crc = crc32_body(crc, p, len, crc32table_be);
+	return __be32_to_cpu(crc);
+# elif CRC_BE_BITS == 8
 	const u32      *b =(u32 *)p;
-	const u32      *tab = crc32table_be;
+	const u32      *tab = crc32table_be[0];
 
 # ifdef __LITTLE_ENDIAN
 #  define DO_CRC(x) crc = tab[ (crc ^ (x)) & 255 ] ^ (crc>>8)
@@ -218,17 +308,17 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 # elif CRC_BE_BITS == 4
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
-		crc = (crc << 4) ^ crc32table_be[crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
+		crc = (crc << 4) ^ crc32table_be[0][crc >> 28];
 	}
 	return crc;
 # elif CRC_BE_BITS == 2
 	while (len--) {
 		crc ^= *p++ << 24;
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
-		crc = (crc << 2) ^ crc32table_be[crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
+		crc = (crc << 2) ^ crc32table_be[0][crc >> 30];
 	}
 	return crc;
 # endif
@@ -238,6 +328,65 @@ u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
 EXPORT_SYMBOL(crc32_le);
 EXPORT_SYMBOL(crc32_be);
 
+#ifdef CONFIG_CRC32_SELFTEST
+/*
+ * Check crc32_le/crc32_be against the bit-at-a-time CRCs that
+ * gen_crc32table computed for slices of the same pseudo-random
+ * buffer, and report how fast they went.
+ */
+static int __init crc32_selftest(void)
+{
+	unsigned char *buf;
+	u32 x = CRC32_TEST_SEED;
+	int i, errors = 0, bytes = 0;
+	unsigned long flags;
+	ktime_t start;
+	s64 nsec;
+	u64 rate;
+
+	buf = kmalloc(CRC32_TEST_BUFSIZE, GFP_KERNEL);
+	if (!buf) {
+		printk(KERN_WARNING "crc32: no memory for self test\n");
+		return 0;
+	}
+	for (i = 0; i < CRC32_TEST_BUFSIZE; i++) {
+		x = CRC32_TEST_NEXT(x);
+		buf[i] = x >> 24;
+	}
+
+	local_irq_save(flags);
+	start = ktime_get();
+	for (i = 0; i < CRC32_TEST_COUNT; i++) {
+		const struct crc32_test *t = &crc32_test[i];
+
+		if (crc32_le(t->init, buf + t->start, t->length) != t->crc_le)
+			errors++;
+		if (crc32_be(t->init, buf + t->start, t->length) != t->crc_be)
+			errors++;
+		bytes += 2 * t->length;
+	}
+	nsec = ktime_to_ns(ktime_sub(ktime_get(), start));
+	local_irq_restore(flags);
+
+	kfree(buf);
+
+	printk(KERN_INFO "crc32: CRC_LE_BITS = %d, CRC_BE_BITS = %d\n",
+	       CRC_LE_BITS, CRC_BE_BITS);
+	if (errors) {
+		printk(KERN_WARNING "crc32: %d self tests failed\n", errors);
+	} else {
+		rate = (u64)bytes * 1000;
+		do_div(rate, (u32)max_t(s64, nsec, 1));
+		printk(KERN_INFO "crc32: self tests passed, processed %d bytes "
+		       "in %lld nsec (%llu MB/s)\n", bytes, nsec, rate);
+	}
+
+	return 0;
+}
+
+module_init(crc32_selftest);
+#endif
+
 /*
  * A brief CRC tutorial.
  *
@@ -1,14 +1,12 @@
 #include <stdio.h>
+#include "../include/linux/autoconf.h"
 #include "crc32defs.h"
 #include <inttypes.h>
 
 #define ENTRIES_PER_LINE 4
 
-#define LE_TABLE_SIZE (1 << CRC_LE_BITS)
-#define BE_TABLE_SIZE (1 << CRC_BE_BITS)
-
-static uint32_t crc32table_le[LE_TABLE_SIZE];
-static uint32_t crc32table_be[BE_TABLE_SIZE];
+static uint32_t crc32table_le[LE_TABLE_ROWS][256];
+static uint32_t crc32table_be[BE_TABLE_ROWS][256];
 
 /**
  * crc32init_le() - allocate and initialize LE table data
@@ -16,18 +14,27 @@ static uint32_t crc32table_be[BE_TABLE_SIZE];
  * crc is the crc of the byte i; other entries are filled in based on the
  * fact that crctable[i^j] = crctable[i] ^ crctable[j].
  *
+ * Row j of a slicing table is the crc of byte i followed by j zero
+ * bytes, so the rows can be applied to j+1 bytes in one step.
  */
 static void crc32init_le(void)
 {
 	unsigned i, j;
 	uint32_t crc = 1;
 
-	crc32table_le[0] = 0;
+	crc32table_le[0][0] = 0;
 
-	for (i = 1 << (CRC_LE_BITS - 1); i; i >>= 1) {
+	for (i = LE_TABLE_SIZE >> 1; i; i >>= 1) {
 		crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
 		for (j = 0; j < LE_TABLE_SIZE; j += 2 * i)
-			crc32table_le[i + j] = crc ^ crc32table_le[j];
+			crc32table_le[0][i + j] = crc ^ crc32table_le[0][j];
+	}
+	for (i = 0; i < LE_TABLE_SIZE; i++) {
+		crc = crc32table_le[0][i];
+		for (j = 1; j < LE_TABLE_ROWS; j++) {
+			crc = crc32table_le[0][crc & 0xff] ^ (crc >> 8);
+			crc32table_le[j][i] = crc;
+		}
 	}
 }
 
@@ -39,12 +46,19 @@ static void crc32init_be(void)
 	unsigned i, j;
 	uint32_t crc = 0x80000000;
 
-	crc32table_be[0] = 0;
+	crc32table_be[0][0] = 0;
 
 	for (i = 1; i < BE_TABLE_SIZE; i <<= 1) {
 		crc = (crc << 1) ^ ((crc & 0x80000000) ? CRCPOLY_BE : 0);
 		for (j = 0; j < i; j++)
-			crc32table_be[i + j] = crc ^ crc32table_be[j];
+			crc32table_be[0][i + j] = crc ^ crc32table_be[0][j];
+	}
+	for (i = 0; i < BE_TABLE_SIZE; i++) {
+		crc = crc32table_be[0][i];
+		for (j = 1; j < BE_TABLE_ROWS; j++) {
+			crc = crc32table_be[0][(crc >> 24) & 0xff] ^ (crc << 8);
+			crc32table_be[j][i] = crc;
+		}
 	}
 }
 
@@ -57,26 +71,108 @@ static void output_table(uint32_t table[], int len, char *trans)
 			printf("\n");
 		printf("%s(0x%8.8xL), ", trans, table[i]);
 	}
-	printf("%s(0x%8.8xL)\n", trans, table[len - 1]);
+	printf("%s(0x%8.8xL)", trans, table[len - 1]);
+}
+
+static void output_rows(uint32_t (*table)[256], int rows, int len, char *trans)
+{
+	int j;
+
+	for (j = 0; j < rows; j++) {
+		printf("{");
+		output_table(table[j], len, trans);
+		printf("}%s\n", (j < rows - 1) ? "," : "");
+	}
+}
+
+#ifdef CONFIG_CRC32_SELFTEST
+/*
+ * Reference CRCs for the boot-time self-test, computed a bit at a
+ * time so they don't depend on the tables above.
+ */
+static uint32_t crc32_bit_le(uint32_t crc, const unsigned char *p, size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRCPOLY_LE : 0);
+	}
+	return crc;
 }
 
+static uint32_t crc32_bit_be(uint32_t crc, const unsigned char *p, size_t len)
+{
+	int i;
+
+	while (len--) {
+		crc ^= (uint32_t)*p++ << 24;
+		for (i = 0; i < 8; i++)
+			crc = (crc << 1) ^ ((crc & 0x80000000) ? CRCPOLY_BE : 0);
+	}
+	return crc;
+}
+
+static void output_tests(void)
+{
+	static unsigned char buf[CRC32_TEST_BUFSIZE];
+	uint32_t x = CRC32_TEST_SEED;
+	uint32_t init, start, length;
+	int i;
+
+	for (i = 0; i < CRC32_TEST_BUFSIZE; i++) {
+		x = CRC32_TEST_NEXT(x);
+		buf[i] = x >> 24;
+	}
+
+	printf("static const struct crc32_test {\n");
+	printf("\tu32 init, start, length, crc_le, crc_be;\n");
+	printf("} crc32_test[CRC32_TEST_COUNT] __initdata = {\n");
+	for (i = 0; i < CRC32_TEST_COUNT; i++) {
+		x = CRC32_TEST_NEXT(x);
+		init = x;
+		x = CRC32_TEST_NEXT(x);
+		start = (x >> 16) & 63;
+		x = CRC32_TEST_NEXT(x);
+		length = (x >> 8) % (CRC32_TEST_BUFSIZE - start + 1);
+		/* Cover the short and unaligned cases as well */
+		if (i < 32)
+			length = i;
+		printf("\t{ 0x%8.8x, %4u, %4u, 0x%8.8x, 0x%8.8x },\n",
+		       init, start, length,
+		       crc32_bit_le(init, buf + start, length),
+		       crc32_bit_be(init, buf + start, length));
+	}
+	printf("};\n");
+}
+#endif
+
 int main(int argc, char** argv)
 {
 	printf("/* this file is generated - do not edit */\n\n");
 
 	if (CRC_LE_BITS > 1) {
 		crc32init_le();
-		printf("static const u32 crc32table_le[] = {");
-		output_table(crc32table_le, LE_TABLE_SIZE, "tole");
+		printf("static const u32 ____cacheline_aligned "
+		       "crc32table_le[%d][%d] = {\n",
+		       LE_TABLE_ROWS, LE_TABLE_SIZE);
+		output_rows(crc32table_le, LE_TABLE_ROWS, LE_TABLE_SIZE, "tole");
 		printf("};\n");
 	}
 
 	if (CRC_BE_BITS > 1) {
 		crc32init_be();
-		printf("static const u32 crc32table_be[] = {");
-		output_table(crc32table_be, BE_TABLE_SIZE, "tobe");
+		printf("static const u32 ____cacheline_aligned "
+		       "crc32table_be[%d][%d] = {\n",
+		       BE_TABLE_ROWS, BE_TABLE_SIZE);
+		output_rows(crc32table_be, BE_TABLE_ROWS, BE_TABLE_SIZE, "tobe");
 		printf("};\n");
 	}
 
+#ifdef CONFIG_CRC32_SELFTEST
+	output_tests();
+#endif
+
 	return 0;
 }
@@ -0,0 +1,266 @@
+/*
+ *  linux/lib/inflate_bench.c
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ *  Times zlib_inflate() the way squashfs and cramfs use it: a corpus is
+ *  cut into independent blocks, each block is deflated on its own, and
+ *  the blocks are inflated again one zlib_inflate(Z_FINISH) call each.
+ *  The result of the first pass is compared with the corpus, then MB/s
+ *  of uncompressed data is printed for each block size.
+ *
+ *	insmod inflate_bench.ko [file=/system/lib/libwebcore.so] [level=9]
+ *
+ *  Without file= the kernel's own text and read-only data are used,
+ *  which compress much like the binaries on /system.  Loading always
+ *  fails with -EAGAIN, so the module need not be removed.
+ */
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/err.h>
+#include <linux/vmalloc.h>
+#include <linux/hrtimer.h>
+#include <linux/zlib.h>
+
+#include <asm/div64.h>
+#include <asm/sections.h>
+#include <asm/uaccess.h>
+
+#define BENCH_BYTES	(16 << 20)	/* Bytes inflated per measurement */
+
+static char *file;
+module_param(file, charp, 0);
+MODULE_PARM_DESC(file, "Corpus file (default: kernel text and rodata)");
+
+static unsigned int max_kb = 4096;
+module_param(max_kb, uint, 0);
+MODULE_PARM_DESC(max_kb, "Largest corpus to use, in KB");
+
+static int level = Z_BEST_COMPRESSION;
+module_param(level, int, 0);
+MODULE_PARM_DESC(level, "Deflate level used to build the test blocks");
+
+/* cramfs pages, squashfs 2.x/3.x block sizes */
+static const unsigned int block_sizes[] = { 4096, 32768, 65536, 131072 };
+
+static u8 *corpus, *packed, *unpacked;
+static unsigned int corpus_len;
+static unsigned int *packed_len;
+static z_stream stream;
+
+/* MB/s (10^6 bytes) for bytes processed in ns */
+static unsigned long bench_rate(u64 bytes, s64 ns)
+{
+	bytes *= 1000;
+	if (ns <= 0)
+		return 0;
+	do_div(bytes, (u32)max_t(s64, ns / 1000, 1));
+	return (unsigned long)bytes / 1000;
+}
+
+static int bench_read_file(void)
+{
+	struct file *filp;
+	mm_segment_t old_fs;
+	loff_t pos = 0;
+	ssize_t n;
+
+	filp = filp_open(file, O_RDONLY | O_LARGEFILE, 0);
+	if (IS_ERR(filp)) {
+		printk(KERN_ERR "inflate_bench: cannot open %s\n", file);
+		return PTR_ERR(filp);
+	}
+
+	corpus_len = min_t(loff_t, i_size_read(filp->f_path.dentry->d_inode),
+			   max_kb << 10);
+	corpus = vmalloc(corpus_len);
+	if (!corpus) {
+		filp_close(filp, NULL);
+		return -ENOMEM;
+	}
+
+	old_fs = get_fs();
+	set_fs(KERNEL_DS);
+	n = vfs_read(filp, (char __user *)corpus, corpus_len, &pos);
+	set_fs(old_fs);
+	filp_close(filp, NULL);
+
+	if (n <= 0)
+		return n ? n : -ENODATA;
+	corpus_len = n;
+	return 0;
+}
+
+static int bench_corpus(void)
+{
+	unsigned int text = _etext - _text;
+	unsigned int rodata = 0;
+
+	if (file)
+		return bench_read_file();
+
+	/* Some architectures place rodata inside _text.._etext */
+	if ((unsigned long)__start_rodata >= (unsigned long)_etext)
+		rodata = __end_rodata - __start_rodata;
+
+	corpus_len = min(text + rodata, max_kb << 10);
+	corpus = vmalloc(corpus_len);
+	if (!corpus)
+		return -ENOMEM;
+
+	text = min(text, corpus_len);
+	memcpy(corpus, _text, text);
+	memcpy(corpus + text, __start_rodata, corpus_len - text);
+	return 0;
+}
+
+/* Deflate every block of the corpus separately, as mksquashfs does */
+static int bench_pack(unsigned int bs, unsigned int nblocks,
+		      unsigned int *total)
+{
+	z_stream def;
+	unsigned int i, len;
+	int err = 0;
+
+	memset(&def, 0, sizeof(def));
+	def.workspace = vmalloc(zlib_deflate_workspacesize());
+	if (!def.workspace)
+		return -ENOMEM;
+	if (zlib_deflateInit(&def, level) != Z_OK) {
+		err = -EINVAL;
+		goto out;
+	}
+
+	*total = 0;
+	for (i = 0; i < nblocks; i++) {
+		len = min(bs, corpus_len - i * bs);
+		zlib_deflateReset(&def);
+		def.next_in = corpus + i * bs;
+		def.avail_in = len;
+		def.next_out = packed + i * 2 * bs;
+		def.avail_out = 2 * bs;
+		if (zlib_deflate(&def, Z_FINISH) != Z_STREAM_END) {
+			err = -EIO;
+			break;
+		}
+		packed_len[i] = def.total_out;
+		*total += def.total_out;
+	}
+	zlib_deflateEnd(&def);
+out:
+	vfree(def.workspace);
+	return err;
+}
+
+static int bench_unpack(unsigned int bs, unsigned int nblocks, int check)
+{
+	unsigned int i, len;
+
+	for (i = 0; i < nblocks; i++) {
+		len = min(bs, corpus_len - i * bs);
+		zlib_inflateReset(&stream);
+		stream.next_in = packed + i * 2 * bs;
+		stream.avail_in = packed_len[i];
+		stream.next_out = unpacked;
+		stream.avail_out = bs;
+		if (zlib_inflate(&stream, Z_FINISH) != Z_STREAM_END ||
+		    stream.total_out != len)
+			return -EIO;
+		if (check && memcmp(unpacked, corpus + i * bs, len))
+			return -EIO;
+	}
+	return 0;
+}
+
+static int bench_block_size(unsigned int bs)
+{
+	unsigned int nblocks = DIV_ROUND_UP(corpus_len, bs);
+	unsigned int total, passes, i;
+	ktime_t t;
+	s64 ns;
+	int err;
+
+	packed = vmalloc(nblocks * 2 * bs);
+	packed_len = vmalloc(nblocks * sizeof(*packed_len));
+	err = -ENOMEM;
+	if (!packed || !packed_len)
+		goto out;
+
+	err = bench_pack(bs, nblocks, &total);
+	if (err)
+		goto out;
+
+	err = bench_unpack(bs, nblocks, 1);
+	if (err) {
+		printk(KERN_ERR "inflate_bench: %u byte blocks do not "
+		       "inflate to the original data\n", bs);
+		goto out;
+	}
+
+	passes = max(BENCH_BYTES / corpus_len, 1U);
+	t = ktime_get();
+	for (i = 0; i < passes; i++)
+		bench_unpack(bs, nblocks, 0);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), t));
+
+	printk(KERN_INFO "inflate_bench: %6u byte blocks: %3u%% of original, "
+	       "%4lu MB/s\n", bs, total / max(corpus_len / 100, 1U),
+	       bench_rate((u64)passes * corpus_len, ns));
+out:
+	vfree(packed_len);
+	vfree(packed);
+	return err;
+}
+
+static int __init inflate_bench_init(void)
+{
+	int i, err;
+
+	err = bench_corpus();
+	if (err)
+		goto out;
+
+	unpacked = vmalloc(block_sizes[ARRAY_SIZE(block_sizes) - 1]);
+	stream.workspace = vmalloc(zlib_inflate_workspacesize());
+	err = -ENOMEM;
+	if (!unpacked || !stream.workspace)
+		goto out;
+	stream.next_in = NULL;
+	stream.avail_in = 0;
+	zlib_inflateInit(&stream);
+
+	printk(KERN_INFO "inflate_bench: %u bytes of %s, level %d, %s "
+	       "inflate_fast\n", corpus_len, file ? file : "kernel text/rodata",
+	       level,
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+	       "word-at-a-time"
+#else
+	       "byte-at-a-time"
+#endif
+	       );
+
+	for (i = 0; i < ARRAY_SIZE(block_sizes); i++) {
+		err = bench_block_size(block_sizes[i]);
+		if (err)
+			break;
+	}
+	zlib_inflateEnd(&stream);
+	if (!err)
+		err = -EAGAIN;
+
+out:
+	vfree(stream.workspace);
+	vfree(unpacked);
+	vfree(corpus);
+	return err;
+}
+
+module_init(inflate_bench_init);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("zlib inflate benchmark");
@@ -4,6 +4,9 @@
  */
 
 #include <linux/zutil.h>
+#include <linux/prefetch.h>
+#include <asm/byteorder.h>
+#include <asm/unaligned.h>
 #include "inftrees.h"
 #include "inflate.h"
 #include "inffast.h"
@@ -29,6 +32,249 @@
 #  define PUP(a) *++(a)
 #endif
 
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+
+/*
+   Word-at-a-time variant of inflate_fast() for CPUs that can load and
+   store unaligned words cheaply (e.g. x86).  It differs from the
+   byte version below in three ways:
+
+    - The bit buffer is refilled with one unaligned 32-bit load, topping
+      it up to 24..31 bits, instead of one or two byte loads.  Only the
+      whole bytes that fit are consumed; the rest of the word is left
+      above bits and is simply loaded again by the next refill, which
+      is why hold is or'ed rather than added to.
+
+    - Matches are copied a word at a time when the distance allows it,
+      and distance one matches (runs) are filled with memset().
+
+    - The window line a back-reference copies from is prefetched while
+      the window bookkeeping is done.
+
+   A refill reads up to three bytes past what it consumes and one pass
+   through the loop consumes at most nine bytes, so the loop keeps
+   INFLATE_WORDS_SLOP bytes of input in reserve rather than five.
+   Copies are exact, so the output side is the same as inflate_fast().
+ */
+#define INFLATE_WORDS_SLOP 12
+
+#define REFILL() \
+    do { \
+        hold |= (unsigned long)get_unaligned_le32(in) << bits; \
+        in += (31 - bits) >> 3; \
+        bits |= 24; \
+    } while (0)
+
+static inline unsigned char *copy_words(unsigned char *out,
+                                        const unsigned char *from,
+                                        unsigned len)
+{
+    while (len >= 4) {
+        put_unaligned(get_unaligned((const u32 *)from), (u32 *)out);
+        out += 4;
+        from += 4;
+        len -= 4;
+    }
+    while (len--)
+        *out++ = *from++;
+    return out;
+}
+
+/* Copy len (>= 1) bytes from dist back in the output */
+static inline unsigned char *copy_match(unsigned char *out, unsigned dist,
+                                        unsigned len)
+{
+    const unsigned char *from = out - dist;
+
+    if (dist >= 4)
+        return copy_words(out, from, len);
+    if (dist == 1) {
+        memset(out, out[-1], len);
+        return out + len;
+    }
+    do {
+        *out++ = *from++;
+    } while (--len);
+    return out;
+}
+
+static void inflate_fast_words(z_streamp strm, unsigned start)
+{
+    struct inflate_state *state;
+    const unsigned char *in;    /* local strm->next_in */
+    const unsigned char *last;  /* while in < last, enough input available */
+    unsigned char *out;         /* local strm->next_out */
+    unsigned char *beg;         /* inflate()'s initial strm->next_out */
+    unsigned char *end;         /* while out < end, enough space available */
+#ifdef INFLATE_STRICT
+    unsigned dmax;              /* maximum distance from zlib header */
+#endif
+    unsigned wsize;             /* window size or zero if not using window */
+    unsigned whave;             /* valid bytes in the window */
+    unsigned write;             /* window write index */
+    unsigned char *window;      /* allocated sliding window, if wsize != 0 */
+    unsigned long hold;         /* local strm->hold */
+    unsigned bits;              /* local strm->bits */
+    code const *lcode;          /* local strm->lencode */
+    code const *dcode;          /* local strm->distcode */
+    unsigned lmask;             /* mask for first level of length codes */
+    unsigned dmask;             /* mask for first level of distance codes */
+    code this;                  /* retrieved table entry */
+    unsigned op;                /* code bits, operation, extra bits, or */
+                                /*  window position, window bytes to copy */
+    unsigned len;               /* match length, unused bytes */
+    unsigned dist;              /* match distance */
+    const unsigned char *from;  /* where to copy match from */
+
+    /* copy state to local variables */
+    state = (struct inflate_state *)strm->state;
+    in = strm->next_in;
+    last = in + (strm->avail_in - INFLATE_WORDS_SLOP);
+    out = strm->next_out;
+    beg = out - (start - strm->avail_out);
+    end = out + (strm->avail_out - 257);
+#ifdef INFLATE_STRICT
+    dmax = state->dmax;
+#endif
+    wsize = state->wsize;
+    whave = state->whave;
+    write = state->write;
+    window = state->window;
+    hold = state->hold;
+    bits = state->bits;
+    lcode = state->lencode;
+    dcode = state->distcode;
+    lmask = (1U << state->lenbits) - 1;
+    dmask = (1U << state->distbits) - 1;
+
+    /* decode literals and length/distances until end-of-block or not enough
+       input data or output space */
+    do {
+        if (bits < 15)
+            REFILL();
+        this = lcode[hold & lmask];
+      dolen:
+        op = (unsigned)(this.bits);
+        hold >>= op;
+        bits -= op;
+        op = (unsigned)(this.op);
+        if (op == 0) {                          /* literal */
+            *out++ = (unsigned char)(this.val);
+        }
+        else if (op & 16) {                     /* length base */
+            len = (unsigned)(this.val);
+            op &= 15;                           /* number of extra bits */
+            if (op) {
+                if (bits < op)
+                    REFILL();
+                len += (unsigned)hold & ((1U << op) - 1);
+                hold >>= op;
+                bits -= op;
+            }
+            if (bits < 15)
+                REFILL();
+            this = dcode[hold & dmask];
+          dodist:
+            op = (unsigned)(this.bits);
+            hold >>= op;
+            bits -= op;
+            op = (unsigned)(this.op);
+            if (op & 16) {                      /* distance base */
+                dist = (unsigned)(this.val);
+                op &= 15;                       /* number of extra bits */
+                if (bits < op)
+                    REFILL();
+                dist += (unsigned)hold & ((1U << op) - 1);
+#ifdef INFLATE_STRICT
+                if (dist > dmax) {
+                    strm->msg = (char *)"invalid distance too far back";
+                    state->mode = BAD;
+                    break;
+                }
+#endif
+                hold >>= op;
+                bits -= op;
+                op = (unsigned)(out - beg);     /* max distance in output */
+                if (dist <= op) {               /* copy direct from output */
+                    out = copy_match(out, dist, len);
+                    continue;
+                }
+                op = dist - op;                 /* distance back in window */
+                if (op > whave) {
+                    strm->msg = (char *)"invalid distance too far back";
+                    state->mode = BAD;
+                    break;
+                }
+                if (write == 0)                 /* very common case */
+                    from = window + wsize - op;
+                else if (write < op)            /* wrap around window */
+                    from = window + wsize + write - op;
+                else                            /* contiguous in window */
+                    from = window + write - op;
+                prefetch(from);
+                if (write != 0 && write < op) {
+                    op -= write;
+                    if (op < len) {             /* some from end of window */
+                        len -= op;
+                        out = copy_words(out, from, op);
+                        from = window;
+                        op = write;
+                    }
+                }
+                if (op < len) {                 /* some from window */
+                    len -= op;
+                    out = copy_words(out, from, op);
+                    out = copy_match(out, dist, len);   /* rest from output */
+                }
+                else
+                    out = copy_words(out, from, len);
+            }
+            else if ((op & 64) == 0) {          /* 2nd level distance code */
+                this = dcode[this.val + (hold & ((1U << op) - 1))];
+                goto dodist;
+            }
+            else {
+                strm->msg = (char *)"invalid distance code";
+                state->mode = BAD;
+                break;
+            }
+        }
+        else if ((op & 64) == 0) {              /* 2nd level length code */
+            this = lcode[this.val + (hold & ((1U << op) - 1))];
+            goto dolen;
+        }
+        else if (op & 32) {                     /* end-of-block */
+            state->mode = TYPE;
+            break;
+        }
+        else {
+            strm->msg = (char *)"invalid literal/length code";
+            state->mode = BAD;
+            break;
+        }
+    } while (in < last && out < end);
+
+    /* return unused bytes and drop the read-ahead above bits */
+    len = bits >> 3;
+    in -= len;
+    bits -= len << 3;
+    hold &= (1U << bits) - 1;
+
+    /* update state and return */
+    strm->next_in = (unsigned char *)in;
+    strm->next_out = out;
+    strm->avail_in = (unsigned)(in < last ? INFLATE_WORDS_SLOP + (last - in) :
+                                INFLATE_WORDS_SLOP - (in - last));
+    strm->avail_out = (unsigned)(out < end ?
+                                 257 + (end - out) : 257 - (out - end));
+    state->hold = hold;
+    state->bits = bits;
+}
+
+#undef REFILL
+
+#endif /* CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS */
+
 /*
    Decode literal, length, and distance codes and write out the resulting
    literal and match bytes until either not enough input or output is
@@ -94,6 +340,13 @@ void inflate_fast(z_streamp strm, unsigned start)
     unsigned dist;              /* match distance */
     unsigned char *from;        /* where to copy match from */
 
+#ifdef CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS
+    if (strm->avail_in > INFLATE_WORDS_SLOP) {
+        inflate_fast_words(strm, start);
+        return;
+    }
+#endif
+
     /* copy state to local variables */
     state = (struct inflate_state *)strm->state;
     in = strm->next_in - OFF;
@@ -1008,6 +1008,7 @@ static void do_generic_file_read(struct file *filp, loff_t *ppos,
 		unsigned long nr, ret;
 
 		cond_resched();
+		readahead_record(filp, index);
 find_page:
 		page = find_get_page(mapping, index);
 		if (!page) {
@@ -1444,6 +1445,8 @@ int filemap_fault(struct vm_area_struct *vma, struct vm_fault *vmf)
 	if (vmf->pgoff >= size)
 		return VM_FAULT_SIGBUS;
 
+	readahead_record(file, vmf->pgoff);
+
 	/* If we don't want any read-ahead, don't bother */
 	if (VM_RandomReadHint(vma))
 		goto no_cached_page;
@@ -1489,6 +1492,8 @@ retry_find:
 		if (!did_readaround) {
 			ret = VM_FAULT_MAJOR;
 			count_vm_event(PGMAJFAULT);
+			if (vma->vm_flags & VM_EXEC)
+				count_vm_event(PGMAJFAULT_EXEC);
 		}
 		did_readaround = 1;
 		ra_pages = max_sane_readahead(file->f_ra.ra_pages);
@@ -1559,6 +1564,8 @@ page_not_uptodate:
 	if (!did_readaround) {
 		ret = VM_FAULT_MAJOR;
 		count_vm_event(PGMAJFAULT);
+		if (vma->vm_flags & VM_EXEC)
+			count_vm_event(PGMAJFAULT_EXEC);
 	}
 
 	/*
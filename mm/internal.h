@@ -41,6 +41,7 @@ static inline void __put_page(struct page *page)
 }
 
 extern void __free_pages_bootmem(struct page *page, unsigned int order);
+extern int split_free_page(struct page *page);
 
 /*
  * function for dealing with page's order in buddy system.
@@ -17,9 +17,12 @@
 #include <linux/vmstat.h>
 #include <linux/percpu.h>
 #include <linux/timer.h>
+#include <linux/swap.h>
+#include <linux/memcontrol.h>
 #include <linux/mem_notify.h>
 
 #include <asm/atomic.h>
+#include <asm/uaccess.h>
 
 #define MAX_PROC_WAKEUP_GUARD  (10*HZ)
 #define MAX_WAKEUP_TASKS (100)
@@ -27,6 +30,9 @@
 struct mem_notify_file_info {
 	unsigned long     last_proc_notify;
 	struct file      *file;
+	int               level;	/* subscribed level */
+	int               last_level;	/* level at the last notification */
+	struct mem_cgroup *memcg;	/* or NULL for the whole system */
 
 	/* for fasync */
 	struct list_head  fa_list;
@@ -34,7 +40,8 @@ struct mem_notify_file_info {
 };
 
 static DECLARE_WAIT_QUEUE_HEAD(mem_wait);
-static atomic_long_t nr_under_memory_pressure_zones = ATOMIC_LONG_INIT(0);
+/* Number of zones at each level of pressure (none is not counted) */
+static atomic_t nr_zones_at_level[MEM_NOTIFY_NR_LEVELS];
 static atomic_t nr_watcher_task = ATOMIC_INIT(0);
 static LIST_HEAD(mem_notify_fasync_list);
 static DEFINE_SPINLOCK(mem_notify_fasync_lock);
@@ -42,7 +49,44 @@ static atomic_t nr_fasync_task = ATOMIC_INIT(0);
 
 atomic_long_t last_mem_notify = ATOMIC_LONG_INIT(INITIAL_JIFFIES);
 
-static void mem_notify_kill_fasync_nr(int nr)
+const char *const mem_notify_level_name[MEM_NOTIFY_NR_LEVELS] = {
+	[MEM_NOTIFY_NONE]	= "none",
+	[MEM_NOTIFY_LOW]	= "low",
+	[MEM_NOTIFY_MEDIUM]	= "medium",
+	[MEM_NOTIFY_CRITICAL]	= "critical",
+};
+
+/* The system level is that of the zone under the most pressure */
+static int mem_notify_level(void)
+{
+	int level;
+
+	for (level = MEM_NOTIFY_NR_LEVELS - 1; level > MEM_NOTIFY_NONE; level--)
+		if (atomic_read(&nr_zones_at_level[level]))
+			break;
+	return level;
+}
+
+/* The level a reader is watching: its memory cgroup's, or the system's */
+static int mem_notify_file_level(struct mem_notify_file_info *info)
+{
+	int level;
+
+	spin_lock(&mem_notify_fasync_lock);
+	if (info->memcg)
+		level = mem_cgroup_pressure_level(info->memcg);
+	else
+		level = mem_notify_level();
+	spin_unlock(&mem_notify_fasync_lock);
+	return level;
+}
+
+/*
+ * Send SIGIO to at most @nr of the fasync readers watching @memcg (NULL
+ * for the system) that subscribed to @level or a lower one.
+ */
+static void mem_notify_kill_fasync_nr(int nr, struct mem_cgroup *memcg,
+				      int level)
 {
 	struct mem_notify_file_info *iter, *saved_iter;
 	LIST_HEAD(l_fired);
@@ -57,6 +101,9 @@ static void mem_notify_kill_fasync_nr(int nr)
 			fa_list) {
 		struct fown_struct *fown;
 
+		if (iter->memcg != memcg || iter->level > level)
+			continue;
+
 		fown = &iter->file->f_owner;
 		send_sigio(fown, iter->fa_fd, POLL_IN);
 
@@ -72,22 +119,27 @@ static void mem_notify_kill_fasync_nr(int nr)
 	spin_unlock(&mem_notify_fasync_lock);
 }
 
-void __memory_pressure_notify(struct zone *zone, int pressure)
+void __memory_pressure_notify(struct zone *zone, int level)
 {
 	int nr_wakeup;
-	int flags;
+	unsigned long flags;
+	int old;
 	int nr_poll_wakeup = 0;
 	int nr_fasync_wakeup = 0;
 
 	spin_lock_irqsave(&mem_wait.lock, flags);
 
-	if (pressure != zone->mem_notify_status) {
-		long val = pressure ? 1 : -1;
-		atomic_long_add(val, &nr_under_memory_pressure_zones);
-		zone->mem_notify_status = pressure;
+	old = zone->mem_notify_status;
+	if (level != old) {
+		if (old > MEM_NOTIFY_NONE)
+			atomic_dec(&nr_zones_at_level[old]);
+		if (level > MEM_NOTIFY_NONE)
+			atomic_inc(&nr_zones_at_level[level]);
+		zone->mem_notify_status = level;
 	}
 
-	if (pressure) {
+	/* Only a new or repeated level is notified, never a lower one */
+	if (level && level >= old) {
 		int nr_watcher = atomic_read(&nr_watcher_task);
 		int nr_fasync_wait_tasks = atomic_read(&nr_fasync_task);
 		int nr_poll_wait_tasks = nr_watcher - nr_fasync_wait_tasks;
@@ -96,6 +148,18 @@ void __memory_pressure_notify(struct zone *zone, int pressure)
 		if (!nr_watcher)
 			goto out;
 
+		/*
+		 * When the pressure rises, every reader subscribed to the
+		 * new level must hear of it.  Repeated notifications of the
+		 * same level only wake a few readers at a time.
+		 */
+		if (level > old) {
+			nr_poll_wakeup = nr_poll_wait_tasks;
+			nr_fasync_wakeup = nr_fasync_wait_tasks;
+			wake_up_locked_nr(&mem_wait, nr_poll_wakeup);
+			goto out;
+		}
+
 		nr_wakeup = (nr_watcher >> 4) + 1;
 		if (unlikely(nr_wakeup > MAX_WAKEUP_TASKS))
 			nr_wakeup = MAX_WAKEUP_TASKS;
@@ -120,7 +184,110 @@ out:
 	spin_unlock_irqrestore(&mem_wait.lock, flags);
 
 	if (nr_fasync_wakeup)
-		mem_notify_kill_fasync_nr(nr_fasync_wakeup);
+		mem_notify_kill_fasync_nr(nr_fasync_wakeup, NULL, level);
+}
+
+/**
+ * mem_notify_window_level - pressure level for a window of reclaim
+ * @level: the current level
+ * @scanned: pages scanned in the window
+ * @reclaimed: pages reclaimed in the window
+ *
+ * A level is entered as soon as the pressure of a window reaches its
+ * threshold, but only left when the pressure falls MEM_NOTIFY_HYSTERESIS
+ * points below it, so that a load hovering around a threshold does not
+ * make the readers flap between two levels.
+ */
+int mem_notify_window_level(int level, unsigned long scanned,
+			    unsigned long reclaimed)
+{
+	unsigned long pressure = 0;
+	unsigned long threshold;
+	int new;
+
+	if (reclaimed < scanned)
+		pressure = 100 - reclaimed * 100 / scanned;
+
+	if (pressure >= MEM_NOTIFY_CRITICAL_PRESSURE)
+		new = MEM_NOTIFY_CRITICAL;
+	else if (pressure >= MEM_NOTIFY_MEDIUM_PRESSURE)
+		new = MEM_NOTIFY_MEDIUM;
+	else
+		new = MEM_NOTIFY_NONE;
+
+	if (new < level) {
+		if (level == MEM_NOTIFY_CRITICAL)
+			threshold = MEM_NOTIFY_CRITICAL_PRESSURE;
+		else if (level == MEM_NOTIFY_MEDIUM)
+			threshold = MEM_NOTIFY_MEDIUM_PRESSURE;
+		else
+			threshold = 0;
+		if (pressure + MEM_NOTIFY_HYSTERESIS > threshold)
+			new = level;
+	}
+	return new;
+}
+
+/**
+ * mem_notify_reclaim - account a round of page reclaim in a zone
+ * @zone: the zone reclaimed from
+ * @scanned: inactive pages scanned
+ * @reclaimed: pages reclaimed
+ *
+ * Every MEM_NOTIFY_WINDOW scanned pages, the efficiency of reclaim and
+ * what is left of the free and file pages of @zone decide whether it
+ * moves to the medium or critical level, or back down to low.  The
+ * window counters are not locked: a lost update only stretches a window.
+ */
+void mem_notify_reclaim(struct zone *zone, unsigned long scanned,
+			unsigned long reclaimed)
+{
+	unsigned long file, free;
+	int status = zone->mem_notify_status;
+	int level;
+
+	if (status == -1 || !scanned)
+		return;
+
+	zone->mem_notify_scanned += scanned;
+	zone->mem_notify_reclaimed += reclaimed;
+	if (zone->mem_notify_scanned < MEM_NOTIFY_WINDOW)
+		return;
+
+	level = mem_notify_window_level(status, zone->mem_notify_scanned,
+					zone->mem_notify_reclaimed);
+	zone->mem_notify_scanned = 0;
+	zone->mem_notify_reclaimed = 0;
+
+	/*
+	 * However well reclaim does, a zone that is out of page cache is
+	 * about to thrash; once it is also into its reserves, OOM is next.
+	 */
+	file = zone_page_state(zone, NR_ACTIVE_FILE) +
+	       zone_page_state(zone, NR_INACTIVE_FILE);
+	free = zone_page_state(zone, NR_FREE_PAGES);
+	if (file < zone->pages_high) {
+		if (free < zone->pages_min)
+			level = MEM_NOTIFY_CRITICAL;
+		else if (level < MEM_NOTIFY_MEDIUM)
+			level = MEM_NOTIFY_MEDIUM;
+	}
+
+	if (level > status)
+		memory_pressure_notify(zone, level);
+	else if (level < status && status > MEM_NOTIFY_LOW)
+		__memory_pressure_notify(zone, max(level, MEM_NOTIFY_LOW));
+}
+
+/**
+ * mem_notify_memcg_wakeup - the pressure in a memory cgroup has risen
+ * @memcg: the memory cgroup
+ * @level: its new level
+ */
+void mem_notify_memcg_wakeup(struct mem_cgroup *memcg, int level)
+{
+	wake_up_all(&mem_wait);
+	mem_notify_kill_fasync_nr(atomic_read(&nr_fasync_task), memcg, level);
 }
 
 static int mem_notify_open(struct inode *inode, struct file *file)
@@ -135,6 +302,9 @@ static int mem_notify_open(struct inode *inode, struct file *file)
 	}
 
 	info->last_proc_notify = INITIAL_JIFFIES;
+	info->level = MEM_NOTIFY_LOW;
+	info->last_level = MEM_NOTIFY_NONE;
+	info->memcg = NULL;
 	INIT_LIST_HEAD(&info->fa_list);
 	info->file = file;
 	info->fa_fd = -1;
@@ -155,11 +325,84 @@ static int mem_notify_release(struct inode *inode, struct file *file)
 	}
 	spin_unlock(&mem_notify_fasync_lock);
 
+	if (info->memcg)
+		mem_cgroup_notify_put(info->memcg);
 	kfree(info);
 	atomic_dec(&nr_watcher_task);
 	return 0;
 }
 
+/*
+ * Reading returns the current level of the pressure watched, as a name
+ * followed by a newline.
+ */
+static ssize_t mem_notify_read(struct file *file, char __user *buf,
+			       size_t count, loff_t *ppos)
+{
+	struct mem_notify_file_info *info = file->private_data;
+	char tmp[16];
+	int len;
+
+	len = snprintf(tmp, sizeof(tmp), "%s\n",
+		       mem_notify_level_name[mem_notify_file_level(info)]);
+	if (count < len)
+		return -EINVAL;
+	if (copy_to_user(buf, tmp, len))
+		return -EFAULT;
+	return len;
+}
+
+/*
+ * Writing "low", "medium" or "critical" subscribes this file to that
+ * level of pressure and above.  A following " memcg" makes it watch the
+ * memory cgroup of the writer instead of the whole system.
+ */
+static ssize_t mem_notify_write(struct file *file, const char __user *buf,
+				size_t count, loff_t *ppos)
+{
+	struct mem_notify_file_info *info = file->private_data;
+	struct mem_cgroup *memcg = NULL, *old;
+	char tmp[32], *p;
+	int level, len = 0;
+
+	if (count >= sizeof(tmp))
+		return -EINVAL;
+	if (copy_from_user(tmp, buf, count))
+		return -EFAULT;
+	tmp[count] = '\0';
+	p = strstrip(tmp);
+
+	for (level = MEM_NOTIFY_LOW; level < MEM_NOTIFY_NR_LEVELS; level++) {
+		len = strlen(mem_notify_level_name[level]);
+		if (!strncmp(p, mem_notify_level_name[level], len) &&
+		    (p[len] == '\0' || p[len] == ' '))
+			break;
+	}
+	if (level == MEM_NOTIFY_NR_LEVELS)
+		return -EINVAL;
+
+	p += len;
+	while (*p == ' ')
+		p++;
+	if (!strcmp(p, "memcg")) {
+		memcg = mem_cgroup_notify_get(current);
+		if (!memcg)
+			return -EINVAL;
+	} else if (*p)
+		return -EINVAL;
+
+	spin_lock(&mem_notify_fasync_lock);
+	old = info->memcg;
+	info->memcg = memcg;
+	info->level = level;
+	info->last_level = MEM_NOTIFY_NONE;
+	spin_unlock(&mem_notify_fasync_lock);
+
+	if (old)
+		mem_cgroup_notify_put(old);
+	return count;
+}
+
 static unsigned int mem_notify_poll(struct file *file, poll_table *wait)
 {
 	struct mem_notify_file_info *info = file->private_data;
@@ -167,21 +410,33 @@ static unsigned int mem_notify_poll(struct file *file, poll_table *wait)
 	unsigned long timeout;
 	unsigned int retval = 0;
 	unsigned long guard_time;
+	int level;
 
 	poll_wait_exclusive(file, &mem_wait, wait);
 
-	guard_time = min_t(unsigned long,
-			   MEM_NOTIFY_FREQ * atomic_read(&nr_watcher_task),
-			   MAX_PROC_WAKEUP_GUARD);
-	timeout = info->last_proc_notify + guard_time;
-	if (time_before(now, timeout))
+	level = mem_notify_file_level(info);
+	if (level < info->level) {
+		info->last_level = level;
 		goto out;
+	}
 
-	if (atomic_long_read(&nr_under_memory_pressure_zones) != 0) {
-		info->last_proc_notify = now;
-		retval = POLLIN;
+	/*
+	 * A rise in the level is reported at once; the same level is
+	 * reported again only after the guard time.
+	 */
+	if (level <= info->last_level) {
+		guard_time = min_t(unsigned long,
+			MEM_NOTIFY_FREQ * atomic_read(&nr_watcher_task),
+			MAX_PROC_WAKEUP_GUARD);
+		timeout = info->last_proc_notify + guard_time;
+		if (time_before(now, timeout))
+			goto out;
 	}
 
+	info->last_proc_notify = now;
+	info->last_level = level;
+	retval = POLLIN;
+
 out:
 	return retval;
 }
@@ -216,6 +471,8 @@ static int mem_notify_fasync(int fd, struct file *filp, int on)
 struct file_operations mem_notify_fops = {
 	.open = mem_notify_open,
 	.release = mem_notify_release,
+	.read = mem_notify_read,
+	.write = mem_notify_write,
 	.poll = mem_notify_poll,
 	.fasync  = mem_notify_fasync,
 };
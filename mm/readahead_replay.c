@@ -0,0 +1,498 @@
+/*
+ * mm/readahead_replay.c - record the page cache reads of a boot and
+ * replay them as large sorted readahead on the next one
+ *
+ * Released under the GPL, see the file COPYING for details.
+ *
+ * Cold boot reads libraries, dex files and APKs 4K at a time, in the
+ * order the faults happen to come in.  While recording, every page read
+ * or faulted through the page cache is noted per file.  The list can
+ * then be read back from /proc/readahead_replay, sorted by file and
+ * offset with nearby ranges merged, and written to the same file early
+ * in the next boot, which reads each range in with
+ * do_page_cache_readahead().
+ *
+ * Commands written to /proc/readahead_replay:
+ *
+ *	record		forget the old list and start recording
+ *	stop		stop recording, sort and merge the list
+ *	clear		forget the list
+ *	<start> <nr> <path>
+ *			read pages start..start+nr-1 of path
+ *	# ...		ignored
+ *
+ * A typical init.rc does
+ *
+ *	copy /data/system/readahead /proc/readahead_replay
+ *	write /proc/readahead_replay record
+ *
+ * before zygote starts, and "stop" followed by a copy of the proc file
+ * back to /data/system/readahead once sys.boot_completed is set.
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/err.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/sort.h>
+#include <linux/hash.h>
+#include <linux/ctype.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/backing-dev.h>
+
+#include <asm/uaccess.h>
+
+#define RA_HASH_BITS	8
+#define RA_PATH_MAX	256
+#define RA_LINE_MAX	(RA_PATH_MAX + 48)
+#define RA_MAX_RANGES	(1 << 16)	/* over all files */
+#define RA_MERGE_GAP	4		/* pages read to join two ranges */
+#define RA_CHUNK	256		/* pages per do_page_cache_readahead */
+
+struct ra_range {
+	pgoff_t start;
+	unsigned long nr;
+};
+
+struct ra_file {
+	struct hlist_node hash;
+	struct list_head list;
+	dev_t dev;
+	unsigned long ino;
+	unsigned int nr, max;		/* ranges used, allocated */
+	struct ra_range *ranges;
+	char path[0];
+};
+
+/* One per open of the proc file, to carry partial lines between writes */
+struct ra_writer {
+	char line[RA_LINE_MAX];
+	unsigned int len;
+	struct file *filp;		/* last file replayed */
+	char path[RA_PATH_MAX];		/* and its name */
+};
+
+int readahead_recording __read_mostly;
+
+/* ra_lock protects the list while recording, ra_mutex everything else */
+static DEFINE_SPINLOCK(ra_lock);
+static DEFINE_MUTEX(ra_mutex);
+static struct hlist_head ra_hash[1 << RA_HASH_BITS];
+static LIST_HEAD(ra_files);
+static char ra_path_buf[RA_PATH_MAX];
+
+static unsigned int ra_nr_files, ra_nr_ranges;
+static unsigned long ra_nr_dropped;
+static unsigned long ra_replayed, ra_replay_failed;
+static int ra_sorted;
+
+static inline struct hlist_head *ra_hash_head(dev_t dev, unsigned long ino)
+{
+	return &ra_hash[hash_long(ino ^ dev, RA_HASH_BITS)];
+}
+
+static struct ra_file *ra_find(dev_t dev, unsigned long ino)
+{
+	struct hlist_node *node;
+	struct ra_file *f;
+
+	hlist_for_each_entry(f, node, ra_hash_head(dev, ino), hash)
+		if (f->ino == ino && f->dev == dev)
+			return f;
+	return NULL;
+}
+
+static struct ra_file *ra_add_file(struct file *filp, struct inode *inode)
+{
+	struct ra_file *f;
+	char *path;
+	int len;
+
+	path = d_path(&filp->f_path, ra_path_buf, sizeof(ra_path_buf));
+	if (IS_ERR(path))
+		return NULL;
+	len = strlen(path);
+
+	f = kmalloc(sizeof(*f) + len + 1, GFP_ATOMIC);
+	if (!f)
+		return NULL;
+	f->dev = inode->i_sb->s_dev;
+	f->ino = inode->i_ino;
+	f->nr = 0;
+	f->max = 0;
+	f->ranges = NULL;
+	memcpy(f->path, path, len + 1);
+
+	hlist_add_head(&f->hash, ra_hash_head(f->dev, f->ino));
+	list_add_tail(&f->list, &ra_files);
+	ra_nr_files++;
+	return f;
+}
+
+static int ra_add_page(struct ra_file *f, pgoff_t index)
+{
+	struct ra_range *r;
+
+	if (f->nr) {
+		r = &f->ranges[f->nr - 1];
+		if (index >= r->start && index < r->start + r->nr)
+			return 0;
+		if (index == r->start + r->nr) {
+			r->nr++;
+			return 0;
+		}
+	}
+
+	if (ra_nr_ranges >= RA_MAX_RANGES)
+		return -ENOSPC;
+	if (f->nr == f->max) {
+		unsigned int max = f->max ? 2 * f->max : 4;
+
+		r = krealloc(f->ranges, max * sizeof(*r), GFP_ATOMIC);
+		if (!r)
+			return -ENOMEM;
+		f->ranges = r;
+		f->max = max;
+	}
+	f->ranges[f->nr].start = index;
+	f->ranges[f->nr].nr = 1;
+	f->nr++;
+	ra_nr_ranges++;
+	return 0;
+}
+
+/*
+ * Called for every page do_generic_file_read() and filemap_fault() look
+ * up while recording, whether or not it was cached already.
+ */
+void __readahead_record(struct file *filp, pgoff_t index)
+{
+	struct address_space *mapping = filp->f_mapping;
+	struct inode *inode = mapping->host;
+	struct ra_file *f;
+
+	/* Nothing to gain for tmpfs/ramfs, or for files being deleted */
+	if (!S_ISREG(inode->i_mode) || !inode->i_nlink ||
+	    !mapping_cap_account_dirty(mapping))
+		return;
+
+	spin_lock(&ra_lock);
+	if (!readahead_recording)
+		goto out;
+
+	f = ra_find(inode->i_sb->s_dev, inode->i_ino);
+	if (!f)
+		f = ra_add_file(filp, inode);
+	if (!f || ra_add_page(f, index))
+		ra_nr_dropped++;
+out:
+	spin_unlock(&ra_lock);
+}
+
+static void ra_clear(void)
+{
+	struct ra_file *f, *next;
+	int i;
+
+	list_for_each_entry_safe(f, next, &ra_files, list) {
+		kfree(f->ranges);
+		kfree(f);
+	}
+	INIT_LIST_HEAD(&ra_files);
+	for (i = 0; i < ARRAY_SIZE(ra_hash); i++)
+		INIT_HLIST_HEAD(&ra_hash[i]);
+	ra_nr_files = 0;
+	ra_nr_ranges = 0;
+	ra_nr_dropped = 0;
+	ra_sorted = 0;
+}
+
+static int ra_cmp_range(const void *a, const void *b)
+{
+	const struct ra_range *x = a, *y = b;
+
+	if (x->start != y->start)
+		return x->start < y->start ? -1 : 1;
+	return 0;
+}
+
+static int ra_cmp_file(const void *a, const void *b)
+{
+	const struct ra_file *x = *(struct ra_file **)a;
+	const struct ra_file *y = *(struct ra_file **)b;
+
+	if (x->dev != y->dev)
+		return x->dev < y->dev ? -1 : 1;
+	if (x->ino != y->ino)
+		return x->ino < y->ino ? -1 : 1;
+	return 0;
+}
+
+/* Sort one file's ranges by offset and join those close together */
+static void ra_merge_ranges(struct ra_file *f)
+{
+	struct ra_range *r = f->ranges, *last;
+	unsigned int i;
+
+	if (!f->nr)
+		return;
+
+	sort(r, f->nr, sizeof(*r), ra_cmp_range, NULL);
+	last = r;
+	for (i = 1; i < f->nr; i++) {
+		if (r[i].start <= last->start + last->nr + RA_MERGE_GAP) {
+			last->nr = max(last->nr, r[i].start + r[i].nr -
+				       last->start);
+			continue;
+		}
+		*++last = r[i];
+	}
+	ra_nr_ranges -= f->nr - (last - r + 1);
+	f->nr = last - r + 1;
+}
+
+/*
+ * Order the files by device and inode number, which on squashfs and
+ * yaffs2 roughly follows where they are on flash.  Recording must be
+ * off.
+ */
+static void ra_sort(void)
+{
+	struct ra_file **files, *f;
+	unsigned int i = 0;
+
+	if (ra_sorted)
+		return;
+
+	list_for_each_entry(f, &ra_files, list)
+		ra_merge_ranges(f);
+
+	files = ra_nr_files ? vmalloc(ra_nr_files * sizeof(*files)) : NULL;
+	if (files) {
+		list_for_each_entry(f, &ra_files, list)
+			files[i++] = f;
+		sort(files, ra_nr_files, sizeof(*files), ra_cmp_file, NULL);
+		INIT_LIST_HEAD(&ra_files);
+		for (i = 0; i < ra_nr_files; i++)
+			list_add_tail(&files[i]->list, &ra_files);
+		vfree(files);
+	}
+	ra_sorted = 1;
+}
+
+static void ra_set_recording(int on)
+{
+	spin_lock(&ra_lock);
+	if (on && !readahead_recording)
+		ra_clear();
+	readahead_recording = on;
+	spin_unlock(&ra_lock);
+}
+
+static void ra_replay(struct ra_writer *w, pgoff_t start, unsigned long nr,
+		      const char *path)
+{
+	struct file *filp = w->filp;
+	unsigned long chunk;
+
+	if (!filp || strcmp(path, w->path)) {
+		if (filp)
+			filp_close(filp, NULL);
+		w->filp = NULL;
+		filp = filp_open(path, O_RDONLY | O_LARGEFILE, 0);
+		if (IS_ERR(filp)) {
+			ra_replay_failed++;
+			return;
+		}
+		w->filp = filp;
+		strlcpy(w->path, path, sizeof(w->path));
+	}
+
+	while (nr) {
+		chunk = min_t(unsigned long, nr, RA_CHUNK);
+		/* Only refused while the queue is congested: wait and retry */
+		if (do_page_cache_readahead(filp->f_mapping, filp, start,
+					    chunk) < 0) {
+			congestion_wait(READ, HZ / 50);
+			continue;
+		}
+		ra_replayed += chunk;
+		start += chunk;
+		nr -= chunk;
+	}
+}
+
+static void ra_do_line(struct ra_writer *w)
+{
+	char *line = strstrip(w->line);
+	unsigned long start, nr;
+	char *p;
+
+	if (!*line || *line == '#')
+		return;
+
+	if (!strcmp(line, "record")) {
+		ra_set_recording(1);
+	} else if (!strcmp(line, "stop")) {
+		ra_set_recording(0);
+		ra_sort();
+	} else if (!strcmp(line, "clear")) {
+		ra_set_recording(0);
+		spin_lock(&ra_lock);
+		ra_clear();
+		spin_unlock(&ra_lock);
+	} else {
+		start = simple_strtoul(line, &p, 10);
+		if (p == line || !isspace(*p))
+			goto bad;
+		line = p;
+		nr = simple_strtoul(line, &p, 10);
+		if (p == line || !isspace(*p))
+			goto bad;
+		while (isspace(*p))
+			p++;
+		if (*p != '/')
+			goto bad;
+		ra_replay(w, start, nr, p);
+	}
+	return;
+bad:
+	ra_replay_failed++;
+}
+
+static ssize_t ra_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	struct ra_writer *w = ((struct seq_file *)file->private_data)->private;
+	size_t done;
+	char c;
+
+	mutex_lock(&ra_mutex);
+	for (done = 0; done < count; done++) {
+		if (get_user(c, buf + done)) {
+			mutex_unlock(&ra_mutex);
+			return done ? done : -EFAULT;
+		}
+		if (c == '\n') {
+			w->line[w->len] = '\0';
+			ra_do_line(w);
+			w->len = 0;
+		} else if (w->len < RA_LINE_MAX - 1) {
+			w->line[w->len++] = c;
+		}
+	}
+	mutex_unlock(&ra_mutex);
+	return count;
+}
+
+static void *ra_seq_start(struct seq_file *m, loff_t *pos)
+{
+	mutex_lock(&ra_mutex);
+	if (readahead_recording)
+		return *pos ? NULL : SEQ_START_TOKEN;
+	ra_sort();
+	return seq_list_start_head(&ra_files, *pos);
+}
+
+static void *ra_seq_next(struct seq_file *m, void *v, loff_t *pos)
+{
+	if (v == SEQ_START_TOKEN) {
+		++*pos;
+		return NULL;
+	}
+	return seq_list_next(v, &ra_files, pos);
+}
+
+static void ra_seq_stop(struct seq_file *m, void *v)
+{
+	mutex_unlock(&ra_mutex);
+}
+
+static int ra_seq_show(struct seq_file *m, void *v)
+{
+	struct ra_file *f;
+	unsigned int i;
+
+	if (v == SEQ_START_TOKEN || v == &ra_files) {
+		seq_printf(m, "# %s: %u files, %u ranges, %lu dropped; "
+			   "replayed %lu pages, %lu failed\n",
+			   readahead_recording ? "recording" : "stopped",
+			   ra_nr_files, ra_nr_ranges, ra_nr_dropped,
+			   ra_replayed, ra_replay_failed);
+		return 0;
+	}
+
+	f = list_entry(v, struct ra_file, list);
+	for (i = 0; i < f->nr; i++)
+		seq_printf(m, "%lu %lu %s\n", (unsigned long)f->ranges[i].start,
+			   f->ranges[i].nr, f->path);
+	return 0;
+}
+
+static const struct seq_operations ra_seq_ops = {
+	.start	= ra_seq_start,
+	.next	= ra_seq_next,
+	.stop	= ra_seq_stop,
+	.show	= ra_seq_show,
+};
+
+static int ra_open(struct inode *inode, struct file *file)
+{
+	struct ra_writer *w;
+	int err;
+
+	w = kzalloc(sizeof(*w), GFP_KERNEL);
+	if (!w)
+		return -ENOMEM;
+	err = seq_open(file, &ra_seq_ops);
+	if (err) {
+		kfree(w);
+		return err;
+	}
+	((struct seq_file *)file->private_data)->private = w;
+	return 0;
+}
+
+static int ra_release(struct inode *inode, struct file *file)
+{
+	struct ra_writer *w = ((struct seq_file *)file->private_data)->private;
+
+	/* A last line without a newline still counts */
+	mutex_lock(&ra_mutex);
+	if (w->len) {
+		w->line[w->len] = '\0';
+		ra_do_line(w);
+	}
+	mutex_unlock(&ra_mutex);
+
+	if (w->filp)
+		filp_close(w->filp, NULL);
+	kfree(w);
+	return seq_release(inode, file);
+}
+
+static const struct file_operations ra_fops = {
+	.open		= ra_open,
+	.read		= seq_read,
+	.write		= ra_write,
+	.llseek		= seq_lseek,
+	.release	= ra_release,
+};
+
+static int __init readahead_replay_init(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(ra_hash); i++)
+		INIT_HLIST_HEAD(&ra_hash[i]);
+	proc_create("readahead_replay", S_IRUSR | S_IWUSR, NULL, &ra_fops);
+	return 0;
+}
+module_init(readahead_replay_init);